@@ -0,0 +1,45 @@
+#ifndef CONTROL_BOX_QP_H
+#define CONTROL_BOX_QP_H
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Dense quadratic program with box constraints
+//   minimise 0.5 u'Hu + f'u  subject to  lower <= u <= upper
+// solved by projected Gauss-Seidel (coordinate descent), which converges for
+// any positive definite H. Everything lives in fixed size arrays, so it can
+// sit inside a controller and never allocate.
+template <int N> struct BoxQP {
+  float H[N][N];
+  float f[N];
+  float lower[N];
+  float upper[N];
+  float u[N]; // the starting guess going in, the solution coming out
+
+  // returns the number of sweeps it took, maxSweeps if it never settled
+  int solve(int maxSweeps, float tolerance) {
+    for (int i = 0; i < N; i++) {
+      u[i] = std::clamp(u[i], lower[i], upper[i]);
+    }
+    for (int sweep = 1; sweep <= maxSweeps; sweep++) {
+      float largestStep = 0.0f;
+      for (int i = 0; i < N; i++) {
+        float gradient = f[i];
+        for (int j = 0; j < N; j++) {
+          gradient += H[i][j] * u[j];
+        }
+        float next = std::clamp(u[i] - gradient / H[i][i], lower[i], upper[i]);
+        largestStep = std::max(largestStep, std::abs(next - u[i]));
+        u[i] = next;
+      }
+      if (largestStep < tolerance) {
+        return sweep;
+      }
+    }
+    return maxSweeps;
+  }
+};
+
+#endif // CONTROL_BOX_QP_H
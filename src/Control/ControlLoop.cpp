@@ -0,0 +1,69 @@
+#include "ControlLoop.h"
+#include <chrono>
+
+ControlLoop::ControlLoop(const Car &car, double rate)
+    : rate(rate), wheelbase(car.wheelbase),
+      maxSteer(glm::radians(Car::maxSteeringDegrees)) {}
+
+void ControlLoop::setController(Controller *controller) {
+  if (controller != this->controller && controller) {
+    controller->reset();
+  }
+  this->controller = controller;
+}
+
+void ControlLoop::setPath(const std::vector<glm::vec2> &path,
+                          glm::vec2 position, float heading) {
+  this->path.assign(path.begin(), path.end());
+  state.position = position;
+  state.heading = heading;
+}
+
+float ControlLoop::step(double deltaTime, float speed) {
+  const double period = 1.0 / rate;
+  accumulator += deltaTime;
+  int due = 0;
+  while (accumulator >= period && due < maxTicksPerStep) {
+    accumulator -= period;
+    state.speed = speed;
+    tick((float)period);
+    due++;
+  }
+  if (due == maxTicksPerStep) {
+    accumulator = 0.0; // don't try to catch up on a stall
+  }
+  return command;
+}
+
+void ControlLoop::tick(float dt) {
+  state.position += state.speed * dt *
+                    glm::vec2(std::cos(state.heading), std::sin(state.heading));
+  state.heading += state.speed * dt * std::tan(command) / wheelbase;
+
+  if (!controller) {
+    return;
+  }
+  auto begin = std::chrono::steady_clock::now();
+  float steer = controller->steer(state, path);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  command = std::clamp(steer, -maxSteer, maxSteer);
+
+  ticks++;
+  computeSeconds += seconds;
+  maxComputeSeconds = std::max(maxComputeSeconds, seconds);
+  float crossTrack = ProjectOntoPath(path, state.position).crossTrack;
+  crossTrackSquared += crossTrack * crossTrack;
+}
+
+float ControlLoop::getCrossTrackRMS() const {
+  return ticks ? (float)std::sqrt(crossTrackSquared / ticks) : 0.0f;
+}
+
+void ControlLoop::resetStats() {
+  ticks = 0;
+  computeSeconds = 0.0;
+  maxComputeSeconds = 0.0;
+  crossTrackSquared = 0.0;
+}
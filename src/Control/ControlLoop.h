@@ -0,0 +1,62 @@
+#ifndef CONTROL_CONTROL_LOOP_H
+#define CONTROL_CONTROL_LOOP_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "Controller.h"
+#include <cstdint>
+#include <vector>
+
+// Runs a Controller at a fixed rate of its own, however often step() gets
+// called. Between paths the car's pose is dead reckoned with a kinematic
+// bicycle from the speed and the steering being held, so a controller
+// ticking faster than the planner still sees the car move along the path.
+//
+// Keeps how long the controller takes and how far off the path the car was,
+// so control laws can be compared on quality against compute cost.
+class ControlLoop {
+public:
+  explicit ControlLoop(const Car &car, double rate = 100.0);
+
+  void setController(Controller *controller);
+  // a new path, in the frame of the car it was planned from. position and
+  // heading are where the car is now in that frame, radians counter-clockwise
+  // from its x, for a path planned a while ago
+  void setPath(const std::vector<glm::vec2> &path,
+               glm::vec2 position = glm::vec2(0.0f), float heading = 0.0f);
+
+  // runs every controller tick due in deltaTime and returns the steering
+  // angle to hold until the next call, radians positive to the left
+  float step(double deltaTime, float speed);
+
+  uint32_t getTicks() const { return ticks; }
+  double getAverageComputeSeconds() const {
+    return ticks ? computeSeconds / ticks : 0.0;
+  }
+  double getMaxComputeSeconds() const { return maxComputeSeconds; }
+  // root mean square distance off the path at each tick, metres
+  float getCrossTrackRMS() const;
+  void resetStats();
+
+  double rate;             // controller ticks per second
+  int maxTicksPerStep = 8; // after a long frame, drop ticks past this
+
+private:
+  Controller *controller = nullptr;
+  float wheelbase;
+  float maxSteer;
+  std::vector<glm::vec2> path;
+  ControlState state;
+  float command = 0.0f;
+  double accumulator = 0.0;
+
+  uint32_t ticks = 0;
+  double computeSeconds = 0.0;
+  double maxComputeSeconds = 0.0;
+  double crossTrackSquared = 0.0;
+
+  void tick(float dt);
+};
+
+#endif // CONTROL_CONTROL_LOOP_H
@@ -0,0 +1,68 @@
+#include "Controller.h"
+#include <algorithm>
+#include <glm/geometric.hpp>
+
+PathProjection ProjectOntoPath(const std::vector<glm::vec2> &path,
+                               glm::vec2 position) {
+  PathProjection best;
+  if (path.size() < 2) {
+    if (!path.empty()) {
+      best.crossTrack = glm::length(position - path[0]);
+    }
+    return best;
+  }
+
+  float bestDistance = INFINITY;
+  float along = 0.0f;
+  for (size_t i = 0; i + 1 < path.size(); i++) {
+    glm::vec2 segment = path[i + 1] - path[i];
+    float length = glm::length(segment);
+    if (length < 1e-6f) {
+      continue;
+    }
+    glm::vec2 direction = segment / length;
+    float t = std::clamp(glm::dot(position - path[i], direction), 0.0f, length);
+    glm::vec2 offset = position - (path[i] + direction * t);
+    float distance = glm::dot(offset, offset);
+    if (distance < bestDistance) {
+      bestDistance = distance;
+      best.segment = (int)i;
+      best.along = along + t;
+      best.crossTrack = direction.x * offset.y - direction.y * offset.x;
+      best.heading = std::atan2(direction.y, direction.x);
+    }
+    along += length;
+  }
+  return best;
+}
+
+glm::vec2 PointAlongPath(const std::vector<glm::vec2> &path, float distance,
+                         float *heading) {
+  if (path.size() < 2) {
+    if (heading) {
+      *heading = 0.0f;
+    }
+    return path.empty() ? glm::vec2(0.0f) : path[0];
+  }
+
+  distance = std::max(distance, 0.0f);
+  glm::vec2 segment(1.0f, 0.0f);
+  for (size_t i = 0; i + 1 < path.size(); i++) {
+    segment = path[i + 1] - path[i];
+    float length = glm::length(segment);
+    if (length < 1e-6f) {
+      continue;
+    }
+    if (distance <= length || i + 2 == path.size()) {
+      if (heading) {
+        *heading = std::atan2(segment.y, segment.x);
+      }
+      return path[i] + segment * (std::min(distance, length) / length);
+    }
+    distance -= length;
+  }
+  if (heading) {
+    *heading = std::atan2(segment.y, segment.x);
+  }
+  return path.back();
+}
@@ -0,0 +1,58 @@
+#ifndef CONTROL_CONTROLLER_H
+#define CONTROL_CONTROLLER_H
+
+#pragma once
+
+#include <cmath>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// Everything in Control works in the frame the path was planned in, in
+// metres: x forward from where the car was, y to its left, headings
+// counter-clockwise from x. Steering is the front wheel angle in radians,
+// positive to the left.
+
+// where the car thinks it is on the path
+struct ControlState {
+  glm::vec2 position{0.0f, 0.0f};
+  float heading = 0.0f;
+  float speed = 0.0f; // m/s
+};
+
+// closest point on a path to some position
+struct PathProjection {
+  int segment = 0;         // path[segment] to path[segment + 1]
+  float along = 0.0f;      // arc length from path[0]
+  float crossTrack = 0.0f; // distance off the path, positive when left of it
+  float heading = 0.0f;    // heading of the path there
+};
+
+// angle in [-pi, pi)
+inline float WrapAngle(float angle) {
+  angle = std::fmod(angle + (float)M_PI, 2.0f * (float)M_PI);
+  return angle < 0.0f ? angle + (float)M_PI : angle - (float)M_PI;
+}
+
+PathProjection ProjectOntoPath(const std::vector<glm::vec2> &path,
+                               glm::vec2 position);
+
+// point distance metres of arc length along the path, clamped to its ends.
+// heading is optional
+glm::vec2 PointAlongPath(const std::vector<glm::vec2> &path, float distance,
+                         float *heading);
+
+// a path tracking control law. Implementations keep whatever state they need
+// between calls, but must not allocate in steer()
+class Controller {
+public:
+  virtual ~Controller() = default;
+
+  // steering angle to follow path from state, in radians
+  virtual float steer(const ControlState &state,
+                      const std::vector<glm::vec2> &path) = 0;
+  // forget anything carried over from earlier calls
+  virtual void reset() {}
+  virtual const char *getName() const = 0;
+};
+
+#endif // CONTROL_CONTROLLER_H
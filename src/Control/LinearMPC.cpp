@@ -0,0 +1,100 @@
+#include "LinearMPC.h"
+
+namespace {
+const float CURVATURE_SPAN = 0.1f; // metres of path the curvature is taken over
+} // namespace
+
+LinearMPC::LinearMPC(const Car &car)
+    : wheelbase(car.wheelbase),
+      maxSteer(glm::radians(Car::maxSteeringDegrees)) {
+  reset();
+}
+
+void LinearMPC::reset() {
+  previous = 0.0f;
+  sweeps = 0;
+  for (int i = 0; i < HORIZON; i++) {
+    qp.u[i] = 0.0f;
+  }
+}
+
+// errors e = (lateral, heading) follow
+//   e[k + 1] = A e[k] + B u[k] + d[k]
+// with A = [1 v*dt; 0 1], B = [0; v*dt/L] and d[k] = [0; -v*dt*curvature[k]]
+float LinearMPC::steer(const ControlState &state,
+                       const std::vector<glm::vec2> &path) {
+  if (path.size() < 2) {
+    return 0.0f;
+  }
+
+  PathProjection projection = ProjectOntoPath(path, state.position);
+  float v = std::max(std::abs(state.speed), minSpeed);
+  float vdt = v * stepSeconds;
+
+  for (int k = 0; k < HORIZON; k++) {
+    float here;
+    float ahead;
+    float distance = projection.along + vdt * k;
+    PointAlongPath(path, distance, &here);
+    PointAlongPath(path, distance + CURVATURE_SPAN, &ahead);
+    curvature[k] = WrapAngle(ahead - here) / CURVATURE_SPAN;
+    reference[k] = std::clamp(std::atan(wheelbase * curvature[k]), -maxSteer,
+                              maxSteer);
+  }
+
+  float lateral = projection.crossTrack;
+  float heading = WrapAngle(state.heading - projection.heading);
+  for (int k = 0; k < HORIZON; k++) {
+    lateral += vdt * heading;
+    heading -= vdt * curvature[k];
+    freeResponse[k][0] = lateral;
+    freeResponse[k][1] = heading;
+  }
+
+  for (int j = 0; j < HORIZON; j++) {
+    float effect[2] = {0.0f, vdt / wheelbase};
+    for (int k = j; k < HORIZON; k++) {
+      sensitivity[k][j][0] = effect[0];
+      sensitivity[k][j][1] = effect[1];
+      effect[0] += vdt * effect[1];
+    }
+  }
+
+  // condense to 0.5 u'Hu + f'u (everything is doubled, which doesn't move
+  // the minimum)
+  for (int i = 0; i < HORIZON; i++) {
+    for (int j = i; j < HORIZON; j++) {
+      float h = 0.0f;
+      for (int k = j; k < HORIZON; k++) {
+        h += lateralWeight * sensitivity[k][i][0] * sensitivity[k][j][0] +
+             headingWeight * sensitivity[k][i][1] * sensitivity[k][j][1];
+      }
+      qp.H[i][j] = h;
+      qp.H[j][i] = h;
+    }
+
+    float f = 0.0f;
+    for (int k = i; k < HORIZON; k++) {
+      f += lateralWeight * sensitivity[k][i][0] * freeResponse[k][0] +
+           headingWeight * sensitivity[k][i][1] * freeResponse[k][1];
+    }
+    qp.f[i] = f - steerWeight * reference[i];
+    qp.H[i][i] += steerWeight + steerRateWeight;
+    if (i + 1 < HORIZON) {
+      qp.H[i][i] += steerRateWeight;
+      qp.H[i][i + 1] -= steerRateWeight;
+      qp.H[i + 1][i] -= steerRateWeight;
+    }
+    qp.lower[i] = -maxSteer;
+    qp.upper[i] = maxSteer;
+  }
+  qp.f[0] -= steerRateWeight * previous;
+
+  // warm start from the last plan, one step on
+  for (int i = 0; i + 1 < HORIZON; i++) {
+    qp.u[i] = qp.u[i + 1];
+  }
+  sweeps = qp.solve(maxSweeps, 1e-5f);
+  previous = qp.u[0];
+  return previous;
+}
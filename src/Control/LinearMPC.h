@@ -0,0 +1,55 @@
+#ifndef CONTROL_LINEAR_MPC_H
+#define CONTROL_LINEAR_MPC_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "BoxQP.h"
+#include "Controller.h"
+
+// Linear model predictive control on the kinematic bicycle Car::update()
+// steps, yaw rate speed * tan(steering) / wheelbase.
+//
+// The model is linearised about the path, taking tan(steering) as steering:
+// the state is the lateral and heading error, the input is the steering
+// angle, and the path's curvature over the horizon goes in as a known
+// disturbance (with its steady state steering as the reference). The horizon
+// is condensed into a HORIZON sized BoxQP with the steering lock as the
+// bounds, warm started from the last solution shifted by one step. Nothing is
+// allocated, so a solve is a few microseconds.
+class LinearMPC : public Controller {
+public:
+  static const int HORIZON = 12;
+
+  explicit LinearMPC(const Car &car);
+
+  float steer(const ControlState &state,
+              const std::vector<glm::vec2> &path) override;
+  void reset() override;
+  const char *getName() const override { return "linear mpc"; }
+
+  // Gauss-Seidel sweeps the last solve took
+  int getSweeps() const { return sweeps; }
+
+  float wheelbase;              // metres
+  float maxSteer;               // radians
+  float stepSeconds = 0.05f;    // model step, horizon is HORIZON of these
+  float minSpeed = 0.1f;        // m/s, the model can't steer when stopped
+  float lateralWeight = 10.0f;  // per m^2 of cross track error
+  float headingWeight = 1.0f;   // per rad^2 of heading error
+  float steerWeight = 0.1f;     // per rad^2 away from the path's steering
+  float steerRateWeight = 1.0f; // per rad^2 of change between steps
+  int maxSweeps = 50;
+
+private:
+  BoxQP<HORIZON> qp;
+  float curvature[HORIZON];
+  float reference[HORIZON]; // steering that holds the path's curvature
+  float freeResponse[HORIZON][2]; // errors after each step with no steering
+  // effect of steering at step j on the errors after step k, k >= j
+  float sensitivity[HORIZON][HORIZON][2];
+  float previous = 0.0f; // steering sent last time
+  int sweeps = 0;
+};
+
+#endif // CONTROL_LINEAR_MPC_H
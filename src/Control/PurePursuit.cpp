@@ -0,0 +1,24 @@
+#include "PurePursuit.h"
+#include <algorithm>
+#include <glm/geometric.hpp>
+
+float PurePursuit::steer(const ControlState &state,
+                         const std::vector<glm::vec2> &path) {
+  if (path.size() < 2) {
+    return 0.0f;
+  }
+
+  PathProjection projection = ProjectOntoPath(path, state.position);
+  float lookahead =
+      std::max(minLookahead, lookaheadGain * std::abs(state.speed));
+  glm::vec2 target =
+      PointAlongPath(path, projection.along + lookahead, nullptr);
+
+  glm::vec2 toTarget = target - state.position;
+  float distance = glm::length(toTarget);
+  if (distance < 1e-4f) {
+    return 0.0f;
+  }
+  float alpha = std::atan2(toTarget.y, toTarget.x) - state.heading;
+  return std::atan(2.0f * wheelbase * std::sin(alpha) / distance);
+}
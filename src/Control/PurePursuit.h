@@ -0,0 +1,25 @@
+#ifndef CONTROL_PURE_PURSUIT_H
+#define CONTROL_PURE_PURSUIT_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "Controller.h"
+
+// Pure pursuit: steer onto the circle through the rear axle and a point one
+// lookahead distance further along the path. The lookahead grows with speed
+// so it doesn't weave when going fast.
+class PurePursuit : public Controller {
+public:
+  explicit PurePursuit(const Car &car) : wheelbase(car.wheelbase) {}
+
+  float steer(const ControlState &state,
+              const std::vector<glm::vec2> &path) override;
+  const char *getName() const override { return "pure pursuit"; }
+
+  float wheelbase;            // metres
+  float minLookahead = 0.3f;  // metres
+  float lookaheadGain = 1.0f; // seconds of travel
+};
+
+#endif // CONTROL_PURE_PURSUIT_H
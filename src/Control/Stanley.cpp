@@ -0,0 +1,17 @@
+#include "Stanley.h"
+
+float Stanley::steer(const ControlState &state,
+                     const std::vector<glm::vec2> &path) {
+  if (path.size() < 2) {
+    return 0.0f;
+  }
+
+  glm::vec2 frontAxle =
+      state.position + wheelbase * glm::vec2(std::cos(state.heading),
+                                             std::sin(state.heading));
+  PathProjection projection = ProjectOntoPath(path, frontAxle);
+  float headingError = WrapAngle(projection.heading - state.heading);
+  // left of the path means steering right to get back on it
+  return headingError + std::atan2(-gain * projection.crossTrack,
+                                   softening + std::abs(state.speed));
+}
@@ -0,0 +1,25 @@
+#ifndef CONTROL_STANLEY_H
+#define CONTROL_STANLEY_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "Controller.h"
+
+// Stanley (Hoffmann et al. 2007): line the front wheels up with the path and
+// add a correction for how far the front axle is off it, which shrinks as
+// speed goes up.
+class Stanley : public Controller {
+public:
+  explicit Stanley(const Car &car) : wheelbase(car.wheelbase) {}
+
+  float steer(const ControlState &state,
+              const std::vector<glm::vec2> &path) override;
+  const char *getName() const override { return "stanley"; }
+
+  float wheelbase;        // metres
+  float gain = 2.0f;      // 1 / s
+  float softening = 0.1f; // m/s, keeps the correction finite when stopped
+};
+
+#endif // CONTROL_STANLEY_H
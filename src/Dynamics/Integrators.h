@@ -0,0 +1,54 @@
+#ifndef DYNAMICS_INTEGRATORS_H
+#define DYNAMICS_INTEGRATORS_H
+
+#pragma once
+
+#include "VehicleModels.h"
+
+// Fixed step integrators for the models in VehicleModels.h, picked as a
+// template parameter so each model/integrator pair compiles to its own
+// straight line step.
+
+// classic fourth order Runge-Kutta, four derivative evaluations a step
+struct RK4 {
+  template <typename Model>
+  static void step(typename Model::State &s, const VehicleInput &u,
+                   const VehicleParams &p, float dt) {
+    typedef typename Model::State State;
+    auto offset = [&s](const State &d, float h) {
+      State out;
+      for (size_t i = 0; i < out.size(); i++) {
+        out[i] = s[i] + h * d[i];
+      }
+      return out;
+    };
+
+    State k1 = Model::derivative(s, u, p);
+    State k2 = Model::derivative(offset(k1, dt * 0.5f), u, p);
+    State k3 = Model::derivative(offset(k2, dt * 0.5f), u, p);
+    State k4 = Model::derivative(offset(k3, dt), u, p);
+    for (size_t i = 0; i < s.size(); i++) {
+      s[i] += dt / 6.0f * (k1[i] + 2.0f * k2[i] + 2.0f * k3[i] + k4[i]);
+    }
+  }
+};
+
+// symplectic Euler: the velocities step first, then the pose steps with the
+// new velocities. Two derivative evaluations a step and, unlike plain Euler,
+// it doesn't pump energy into the yaw oscillation at large steps
+struct SemiImplicitEuler {
+  template <typename Model>
+  static void step(typename Model::State &s, const VehicleInput &u,
+                   const VehicleParams &p, float dt) {
+    typename Model::State d = Model::derivative(s, u, p);
+    for (size_t i = Model::POSITIONS; i < s.size(); i++) {
+      s[i] += dt * d[i];
+    }
+    d = Model::derivative(s, u, p);
+    for (int i = 0; i < Model::POSITIONS; i++) {
+      s[i] += dt * d[i];
+    }
+  }
+};
+
+#endif // DYNAMICS_INTEGRATORS_H
@@ -0,0 +1,40 @@
+#ifndef DYNAMICS_VEHICLE_H
+#define DYNAMICS_VEHICLE_H
+
+#pragma once
+
+#include "Integrators.h"
+#include "VehicleModels.h"
+#include "VehicleParams.h"
+#include <algorithm>
+#include <glm/ext/vector_float2.hpp>
+
+// A model, an integrator and its parameters, e.g.
+//   Vehicle<DynamicBicycle<PacejkaTire>, RK4> car(LoadVehicleParams(path));
+//   car.step(input, 0.001f);
+template <typename Model, typename Integrator = RK4> class Vehicle {
+public:
+  typedef typename Model::State State;
+
+  explicit Vehicle(const VehicleParams &params = VehicleParams())
+      : params(params) {
+    state.fill(0.0f);
+  }
+
+  // input is clamped to the steering lock and acceleration limit
+  inline void step(VehicleInput input, float dt) {
+    input.steer = std::clamp(input.steer, -params.maxSteer, params.maxSteer);
+    input.accel = std::clamp(input.accel, -params.maxAccel, params.maxAccel);
+    Integrator::template step<Model>(state, input, params, dt);
+  }
+
+  glm::vec2 getPosition() const {
+    return glm::vec2(state[Model::X], state[Model::Y]);
+  }
+  float getHeading() const { return state[Model::YAW]; }
+
+  State state;
+  VehicleParams params;
+};
+
+#endif // DYNAMICS_VEHICLE_H
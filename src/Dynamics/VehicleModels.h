@@ -0,0 +1,112 @@
+#ifndef DYNAMICS_VEHICLE_MODELS_H
+#define DYNAMICS_VEHICLE_MODELS_H
+
+#pragma once
+
+#include "VehicleParams.h"
+#include <array>
+#include <cmath>
+
+// Continuous time vehicle models for the integrators in Integrators.h. Each
+// model has a fixed size State, with the pose (x, y, yaw) first, followed by
+// the velocities it is driven by, and a derivative() that gives d/dt of the
+// state. Everything is SI, in the world frame, with yaw counter-clockwise
+// from x.
+
+struct VehicleInput {
+  float steer = 0.0f; // front wheel angle, rad, positive to the left
+  float accel = 0.0f; // longitudinal, m/s^2
+};
+
+// Kinematic bicycle about the centre of gravity: the wheels go exactly where
+// they point, so there is no slip. Fine at low speed and for planning.
+struct KinematicBicycle {
+  enum { X, Y, YAW, SPEED, SIZE };
+  static const int POSITIONS = 3;
+  typedef std::array<float, SIZE> State;
+
+  static State derivative(const State &s, const VehicleInput &u,
+                          const VehicleParams &p) {
+    float tanSteer = std::tan(u.steer);
+    float slip = std::atan(p.rearAxle * tanSteer / p.wheelbase());
+    State d;
+    d[X] = s[SPEED] * std::cos(s[YAW] + slip);
+    d[Y] = s[SPEED] * std::sin(s[YAW] + slip);
+    d[YAW] = s[SPEED] * std::cos(slip) * tanSteer / p.wheelbase();
+    d[SPEED] = u.accel;
+    return d;
+  }
+};
+
+// lateral tyre force is friction * cornering stiffness * load * slip angle,
+// only good for small slip angles
+struct LinearTire {
+  static float lateralForce(float slipAngle, float load, float cornering,
+                            const VehicleParams &p) {
+    return p.friction * cornering * load * slipAngle;
+  }
+};
+
+// Pacejka's magic formula with D = friction * load, so the force saturates
+// once the tyre starts sliding
+struct PacejkaTire {
+  static float lateralForce(float slipAngle, float load, float,
+                            const VehicleParams &p) {
+    float b = p.pacejkaB * slipAngle;
+    return p.friction * load *
+           std::sin(p.pacejkaC *
+                    std::atan(b - p.pacejkaE * (b - std::atan(b))));
+  }
+};
+
+// Single track (dynamic bicycle) model with one tyre per axle, static axle
+// loads and the tyre model as a template parameter. Below kinematicBelow the
+// slip angles are meaningless, so the velocities are pulled onto what the
+// kinematic model would give instead.
+template <typename Tire> struct DynamicBicycle {
+  enum { X, Y, YAW, VX, VY, YAW_RATE, SIZE };
+  static const int POSITIONS = 3;
+  typedef std::array<float, SIZE> State;
+
+  static State derivative(const State &s, const VehicleInput &u,
+                          const VehicleParams &p) {
+    const float g = 9.81f;
+    const float settle = 0.05f; // s, low speed blend time constant
+    float cosYaw = std::cos(s[YAW]);
+    float sinYaw = std::sin(s[YAW]);
+
+    State d;
+    d[X] = s[VX] * cosYaw - s[VY] * sinYaw;
+    d[Y] = s[VX] * sinYaw + s[VY] * cosYaw;
+    d[YAW] = s[YAW_RATE];
+
+    if (std::abs(s[VX]) < p.kinematicBelow) {
+      float tanSteer = std::tan(u.steer);
+      float yawRate = s[VX] * tanSteer / p.wheelbase();
+      float vy = yawRate * p.rearAxle;
+      d[VX] = u.accel;
+      d[VY] = (vy - s[VY]) / settle;
+      d[YAW_RATE] = (yawRate - s[YAW_RATE]) / settle;
+      return d;
+    }
+
+    float frontLoad = p.mass * g * p.rearAxle / p.wheelbase();
+    float rearLoad = p.mass * g * p.frontAxle / p.wheelbase();
+    float frontSlip =
+        u.steer - std::atan2(s[VY] + p.frontAxle * s[YAW_RATE], s[VX]);
+    float rearSlip = -std::atan2(s[VY] - p.rearAxle * s[YAW_RATE], s[VX]);
+    float front =
+        Tire::lateralForce(frontSlip, frontLoad, p.frontCornering, p);
+    float rear = Tire::lateralForce(rearSlip, rearLoad, p.rearCornering, p);
+
+    float cosSteer = std::cos(u.steer);
+    d[VX] = u.accel - front * std::sin(u.steer) / p.mass +
+            s[YAW_RATE] * s[VY];
+    d[VY] = (front * cosSteer + rear) / p.mass - s[YAW_RATE] * s[VX];
+    d[YAW_RATE] =
+        (p.frontAxle * front * cosSteer - p.rearAxle * rear) / p.yawInertia;
+    return d;
+  }
+};
+
+#endif // DYNAMICS_VEHICLE_MODELS_H
@@ -0,0 +1,71 @@
+#include "VehicleParams.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+struct Field {
+  const char *name;
+  float VehicleParams::*member;
+};
+
+const Field FIELDS[] = {
+    {"mass", &VehicleParams::mass},
+    {"yaw_inertia", &VehicleParams::yawInertia},
+    {"front_axle", &VehicleParams::frontAxle},
+    {"rear_axle", &VehicleParams::rearAxle},
+    {"max_steer", &VehicleParams::maxSteer},
+    {"max_accel", &VehicleParams::maxAccel},
+    {"max_speed", &VehicleParams::maxSpeed},
+    {"friction", &VehicleParams::friction},
+    {"front_cornering", &VehicleParams::frontCornering},
+    {"rear_cornering", &VehicleParams::rearCornering},
+    {"pacejka_b", &VehicleParams::pacejkaB},
+    {"pacejka_c", &VehicleParams::pacejkaC},
+    {"pacejka_e", &VehicleParams::pacejkaE},
+    {"kinematic_below", &VehicleParams::kinematicBelow},
+};
+} // namespace
+
+VehicleParams LoadVehicleParams(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  VehicleParams params;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    line = line.substr(0, line.find('#'));
+    size_t equals = line.find('=');
+    std::istringstream key(line.substr(0, equals));
+    std::string name;
+    if (!(key >> name)) {
+      continue; // blank or only a comment
+    }
+
+    std::istringstream value(equals == std::string::npos
+                                 ? std::string()
+                                 : line.substr(equals + 1));
+    float number;
+    bool known = false;
+    for (const Field &field : FIELDS) {
+      if (name == field.name) {
+        known = true;
+        if (!(value >> number)) {
+          throw std::runtime_error(filename + ":" +
+                                   std::to_string(lineNumber) +
+                                   ": expected a number for " + name);
+        }
+        params.*field.member = number;
+      }
+    }
+    if (!known) {
+      throw std::runtime_error(filename + ":" + std::to_string(lineNumber) +
+                               ": unknown vehicle parameter " + name);
+    }
+  }
+  return params;
+}
@@ -0,0 +1,40 @@
+#ifndef DYNAMICS_VEHICLE_PARAMS_H
+#define DYNAMICS_VEHICLE_PARAMS_H
+
+#pragma once
+
+#include <string>
+
+// Physical parameters of the car for the models in VehicleModels.h. The
+// defaults are a 1/10th scale F1TENTH car, with its axles stretched to the
+// Car's 0.4 m wheelbase so the controllers predict the models right.
+struct VehicleParams {
+  float mass = 3.74f;          // kg
+  float yawInertia = 0.04712f; // kg m^2 about the centre of gravity
+  float frontAxle = 0.1923f;   // m, centre of gravity to the front axle
+  float rearAxle = 0.2077f;    // m, centre of gravity to the rear axle
+  float maxSteer = 0.349f;     // rad, the Car's 20 degree lock
+  float maxAccel = 9.51f;      // m/s^2, either way
+  float maxSpeed = 0.6f;       // m/s, the Car's limit, past it the drive cuts
+
+  // tyres
+  float friction = 1.0489f;       // mu
+  float frontCornering = 4.718f;  // 1 / rad, per newton of load
+  float rearCornering = 5.4562f;  // 1 / rad, per newton of load
+  float pacejkaB = 4.0f;          // stiffness factor
+  float pacejkaC = 1.3f;          // shape factor
+  float pacejkaE = 0.0f;          // curvature factor
+
+  // below this the dynamic model hands over to the kinematic one, whose slip
+  // angles don't blow up as speed goes to 0. Half of maxSpeed, so a car at
+  // speed does run on the tyres
+  float kinematicBelow = 0.3f; // m/s
+
+  float wheelbase() const { return frontAxle + rearAxle; }
+};
+
+// reads "name = value" lines (# starts a comment) over the defaults. Throws
+// std::runtime_error if the file can't be read or has a line it doesn't know
+VehicleParams LoadVehicleParams(const std::string &filename);
+
+#endif // DYNAMICS_VEHICLE_PARAMS_H
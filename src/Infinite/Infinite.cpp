@@ -8,6 +8,7 @@
 #include "frontend/Camera.h"
 #include "util/VulkanUtils.h"
 #include "util/constants.h"
+#include "../Profiling/Trace.h"
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -349,6 +350,7 @@ void recreateSwapChain() { // named wrong
 }
 
 void renderFrame() {
+  TRACE_ZONE("renderFrame");
   // Compute submission
   renderPasses.front()->waitForFences();
   for (const auto &r : renderPasses) {
@@ -634,6 +636,7 @@ VkSampleCountFlagBits getMaxUsableSampleCount() {
 }
 
 void saveScreenshot(const char *filename, ScreenShotFormat screenshotFormat) {
+  TRACE_ZONE("saveScreenshot");
   bool supportsBlit = true;
 
   // Check blit support for source and destination
@@ -0,0 +1,692 @@
+#include "Mesh.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#define TINYOBJLOADER_USE_MAPBOX_EARCUT
+#include "tiny_obj_loader.h"
+
+namespace Infinite {
+namespace {
+const size_t OBJ_CHUNK_BYTES = 4 << 20; // of the OBJ parsed by one thread
+
+const char MESH_CACHE_MAGIC[8] = "F1TMESH";
+const uint32_t MESH_CACHE_VERSION = 1;
+const size_t MESH_CACHE_ALIGNMENT = 64;
+
+// The cache LoadMesh() keeps next to an OBJ: this header, then the positions,
+// texture coordinates and indices, each on a 64 byte boundary
+struct MeshCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t objSize;     // bytes
+  int64_t objModified;  // the OBJ's last write time, in its clock's ticks
+  uint64_t positionCount; // and texture coordinates
+  uint64_t indexCount;
+  uint64_t unused[2];
+};
+
+static_assert(sizeof(MeshCacheHeader) == 64 && sizeof(glm::vec3) == 12 &&
+                  sizeof(glm::vec2) == 8,
+              "the mesh cache's layout must not depend on the compiler");
+
+struct MeshCacheLayout {
+  size_t positions, texCoords, indices, size; // byte offsets, then the total
+
+  MeshCacheLayout(uint64_t positionCount, uint64_t indexCount) {
+    positions = sizeof(MeshCacheHeader);
+    texCoords = Align(positions + positionCount * sizeof(glm::vec3));
+    indices = Align(texCoords + positionCount * sizeof(glm::vec2));
+    size = indices + indexCount * sizeof(uint32_t);
+  }
+
+  static size_t Align(size_t bytes) {
+    return (bytes + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+  }
+};
+
+// a whole file, read only. Mapped where there is mmap(), read in otherwise
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename) {
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      throw std::runtime_error("failed to open file: " + filename);
+    }
+    fallback.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read(fallback.data(), fallback.size());
+    bytes = fallback.data();
+    length = fallback.size();
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      throw std::runtime_error("failed to open file: " + filename);
+    }
+    length = (size_t)info.st_size;
+    if (length > 0) {
+      void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("failed to open file: " + filename);
+      }
+      bytes = (const char *)mapped;
+    }
+    ::close(fd);
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (bytes) {
+      munmap((void *)bytes, length);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  const char *bytes = nullptr;
+  size_t length = 0;
+  std::vector<char> fallback; // the file, where there is no mmap()
+};
+
+struct Corner {
+  glm::vec3 pos;
+  glm::vec2 texCoord;
+};
+
+// a face's corner as the OBJ gives it, 0 based
+struct ObjCorner {
+  uint32_t position;
+  int32_t texCoord; // -1 for none
+};
+
+// 0 and -0 compare equal, so they have to hash alike
+uint32_t FloatBits(float value) {
+  if (value == 0.0f) {
+    value = 0.0f;
+  }
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// murmur3's finaliser
+uint64_t Mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  return h ^ (h >> 33);
+}
+
+uint32_t HashCorner(const Corner &corner) {
+  uint64_t h = Mix(FloatBits(corner.pos.x) |
+                   (uint64_t)FloatBits(corner.pos.y) << 32);
+  h = Mix(h ^ (FloatBits(corner.pos.z) |
+               (uint64_t)FloatBits(corner.texCoord.x) << 32));
+  return (uint32_t)(Mix(h ^ FloatBits(corner.texCoord.y)) >> 32);
+}
+
+// Merges corners with the same position and texture coordinate into one of
+// mesh's vertices, numbering them in the order they're first seen. Open
+// addressing with linear probing, sized up front from how many vertices the
+// OBJ says it has, so it seldom grows
+class CornerTable {
+public:
+  explicit CornerTable(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < 2 * expected) {
+      capacity *= 2;
+    }
+    slots.assign(capacity, Slot{0, EMPTY});
+  }
+
+  uint32_t insert(const Corner &corner, Mesh &mesh) {
+    if (2 * (used + 1) > slots.size()) {
+      grow();
+    }
+    uint32_t hash = HashCorner(corner);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      Slot &slot = slots[i];
+      if (slot.vertex == EMPTY) {
+        slot = {hash, (uint32_t)mesh.positions.size()};
+        used++;
+        mesh.positions.push_back(corner.pos);
+        mesh.texCoords.push_back(corner.texCoord);
+        return slot.vertex;
+      }
+      if (slot.hash == hash && mesh.positions[slot.vertex] == corner.pos &&
+          mesh.texCoords[slot.vertex] == corner.texCoord) {
+        return slot.vertex;
+      }
+    }
+  }
+
+private:
+  static const uint32_t EMPTY = UINT32_MAX;
+
+  struct Slot {
+    uint32_t hash;
+    uint32_t vertex;
+  };
+
+  std::vector<Slot> slots;
+  size_t used = 0;
+
+  void grow() {
+    std::vector<Slot> old(slots.size() * 2, Slot{0, EMPTY});
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const Slot &slot : old) {
+      if (slot.vertex != EMPTY) {
+        size_t i = slot.hash & mask;
+        while (slots[i].vertex != EMPTY) {
+          i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+      }
+    }
+  }
+};
+
+// positions three floats and texCoords two a piece, as tinyobj reads them
+Corner MakeCorner(const ObjCorner &index, const std::vector<float> &positions,
+                  const std::vector<float> &texCoords) {
+  Corner corner;
+  corner.pos = {positions[3 * index.position + 0],
+                positions[3 * index.position + 1],
+                positions[3 * index.position + 2]};
+  corner.texCoord = glm::vec2(0.0f);
+  if (index.texCoord >= 0) {
+    corner.texCoord = {texCoords[2 * index.texCoord + 0],
+                       1.0f - texCoords[2 * index.texCoord + 1]};
+  }
+  return corner;
+}
+} // namespace
+
+Mesh LoadMeshWithTinyObj(const std::string &filename) {
+  tinyobj::ObjReader reader;
+
+  if (!reader.ParseFromFile(filename)) {
+    if (!reader.Error().empty()) {
+      throw std::runtime_error("TinyObjReader: " + reader.Error());
+    }
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  if (!reader.Warning().empty()) {
+    std::cout << "TinyObjReader: " << reader.Warning();
+  }
+
+  auto &attrib = reader.GetAttrib();
+  auto &shapes = reader.GetShapes();
+
+  Mesh mesh;
+  CornerTable uniqueCorners(attrib.vertices.size() / 3);
+  for (const auto &shape : shapes) {
+    for (const auto &index : shape.mesh.indices) {
+      ObjCorner corner{(uint32_t)index.vertex_index, index.texcoord_index};
+      mesh.indices.push_back(uniqueCorners.insert(
+          MakeCorner(corner, attrib.vertices, attrib.texcoords), mesh));
+    }
+  }
+  return mesh;
+}
+
+namespace {
+// The parallel OBJ parser. It reads the v, vt and f lines LoadMesh() uses
+// exactly as tinyobj does, and gives up on anything it would have to do more
+// than that for: polygons past quads, bad or zero indices
+enum ObjLine { OBJ_OTHER, OBJ_POSITION, OBJ_TEX_COORD, OBJ_NORMAL, OBJ_FACE };
+
+struct ObjCounts {
+  size_t positions = 0, texCoords = 0, normals = 0; // v, vt and vn lines
+};
+
+struct ObjChunk {
+  ObjChunk(const char *begin, const char *end) : begin(begin), end(end) {}
+
+  const char *begin, *end;
+  ObjCounts lines; // the chunk's, then those in the chunks before it
+  std::vector<ObjCorner> corners;  // every face's, in order
+  std::vector<uint8_t> faceSizes;  // 3 or 4 corners
+  std::vector<ObjCorner> triangles; // three corners each
+  bool supported = true;
+};
+
+bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+
+// calls line(begin, end) for each line in [begin, end), without its newline
+template <typename Line>
+void ForEachLine(const char *begin, const char *end, Line line) {
+  while (begin < end) {
+    const char *stop = begin;
+    while (stop < end && *stop != '\n' && *stop != '\r') {
+      stop++;
+    }
+    line(begin, stop);
+    begin = stop + 1;
+  }
+}
+
+// what the line at token is, with token moved past its keyword
+ObjLine ClassifyLine(const char *&token, const char *end) {
+  while (token < end && IsSpace(*token)) {
+    token++;
+  }
+  if (end - token < 2) {
+    return OBJ_OTHER;
+  }
+  if (token[0] == 'f' && IsSpace(token[1])) {
+    token += 2;
+    return OBJ_FACE;
+  }
+  if (token[0] != 'v') {
+    return OBJ_OTHER;
+  }
+  if (IsSpace(token[1])) {
+    token += 2;
+    return OBJ_POSITION;
+  }
+  if (end - token >= 3 && IsSpace(token[2])) {
+    if (token[1] == 't') {
+      token += 3;
+      return OBJ_TEX_COORD;
+    }
+    if (token[1] == 'n') {
+      token += 3;
+      return OBJ_NORMAL;
+    }
+  }
+  return OBJ_OTHER;
+}
+
+// tinyobj's parseReal(), 0 if the number doesn't parse
+float ParseFloat(const char *&token, const char *end) {
+  while (token < end && IsSpace(*token)) {
+    token++;
+  }
+  const char *stop = token;
+  while (stop < end && !IsSpace(*stop)) {
+    stop++;
+  }
+  double value = 0.0;
+  tinyobj::tryParseDouble(token, stop, &value);
+  token = stop;
+  return static_cast<float>(value);
+}
+
+// one index of a face corner, resolved the way tinyobj's fixIndex() does
+// against read of them before it and total in the file. False for an index
+// tinyobj would warn about or reject
+bool ParseIndex(const char *&token, const char *end, size_t read, size_t total,
+                uint32_t &index) {
+  bool negative = false;
+  if (token < end && (*token == '-' || *token == '+')) {
+    negative = *token == '-';
+    token++;
+  }
+  const char *digits = token;
+  uint64_t value = 0;
+  while (token < end && *token >= '0' && *token <= '9' && value <= total) {
+    value = value * 10 + (*token - '0');
+    token++;
+  }
+  bool parsed = token > digits;
+  // like parseTriple(), skip anything else up to the next / or space
+  while (token < end && *token != '/' && !IsSpace(*token)) {
+    token++;
+  }
+  if (!parsed || value == 0) {
+    return false;
+  }
+  if (negative) {
+    if (value > read) {
+      return false;
+    }
+    index = (uint32_t)(read - value);
+  } else {
+    if (value > total) {
+      return false;
+    }
+    index = (uint32_t)(value - 1);
+  }
+  return true;
+}
+
+void CountLines(ObjChunk &chunk) {
+  ForEachLine(chunk.begin, chunk.end, [&](const char *token, const char *end) {
+    switch (ClassifyLine(token, end)) {
+    case OBJ_POSITION:
+      chunk.lines.positions++;
+      break;
+    case OBJ_TEX_COORD:
+      chunk.lines.texCoords++;
+      break;
+    case OBJ_NORMAL:
+      chunk.lines.normals++;
+      break;
+    default:
+      break;
+    }
+  });
+}
+
+// reads the chunk's positions and texture coordinates into theirs, from where
+// its counts say, and its faces into chunk.corners
+void ParseChunk(ObjChunk &chunk, const ObjCounts &totals,
+                std::vector<float> &positions, std::vector<float> &texCoords) {
+  size_t position = chunk.lines.positions, texCoord = chunk.lines.texCoords,
+         normal = chunk.lines.normals;
+  ForEachLine(chunk.begin, chunk.end, [&](const char *token, const char *end) {
+    if (!chunk.supported) {
+      return;
+    }
+    switch (ClassifyLine(token, end)) {
+    case OBJ_POSITION:
+      for (int i = 0; i < 3; i++) {
+        positions[3 * position + i] = ParseFloat(token, end);
+      }
+      position++;
+      break;
+    case OBJ_TEX_COORD:
+      for (int i = 0; i < 2; i++) {
+        texCoords[2 * texCoord + i] = ParseFloat(token, end);
+      }
+      texCoord++;
+      break;
+    case OBJ_NORMAL:
+      normal++;
+      break;
+    case OBJ_FACE: {
+      while (token < end && IsSpace(*token)) {
+        token++;
+      }
+      size_t size = 0;
+      while (token < end && chunk.supported) {
+        ObjCorner corner{0, -1};
+        uint32_t index;
+        chunk.supported =
+            ParseIndex(token, end, position, totals.positions, corner.position);
+        if (chunk.supported && token < end && *token == '/') {
+          token++;
+          if (token < end && *token == '/') { // i//k
+            token++;
+            chunk.supported =
+                ParseIndex(token, end, normal, totals.normals, index);
+          } else { // i/j or i/j/k
+            chunk.supported =
+                ParseIndex(token, end, texCoord, totals.texCoords, index);
+            corner.texCoord = (int32_t)index;
+            if (chunk.supported && token < end && *token == '/') {
+              token++;
+              chunk.supported =
+                  ParseIndex(token, end, normal, totals.normals, index);
+            }
+          }
+        }
+        chunk.corners.push_back(corner);
+        size++;
+        while (token < end && IsSpace(*token)) {
+          token++;
+        }
+      }
+      chunk.supported = chunk.supported && size >= 3 && size <= 4;
+      chunk.faceSizes.push_back((uint8_t)size);
+      break;
+    }
+    default:
+      break;
+    }
+  });
+}
+
+// splits the chunk's quads along their shorter diagonal, as tinyobj does
+void Triangulate(ObjChunk &chunk, const std::vector<float> &positions) {
+  chunk.triangles.reserve(chunk.corners.size() * 3 / 2);
+  const ObjCorner *corner = chunk.corners.data();
+  for (uint8_t size : chunk.faceSizes) {
+    if (size == 3) {
+      chunk.triangles.insert(chunk.triangles.end(), corner, corner + 3);
+    } else {
+      const float *v0 = &positions[3 * corner[0].position];
+      const float *v1 = &positions[3 * corner[1].position];
+      const float *v2 = &positions[3 * corner[2].position];
+      const float *v3 = &positions[3 * corner[3].position];
+      float e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+      float e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+      float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+      float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+      static const int SPLIT_02[6] = {0, 1, 2, 0, 2, 3};
+      static const int SPLIT_13[6] = {0, 1, 3, 1, 2, 3};
+      const int *order = sqr02 < sqr13 ? SPLIT_02 : SPLIT_13;
+      for (int i = 0; i < 6; i++) {
+        chunk.triangles.push_back(corner[order[i]]);
+      }
+    }
+    corner += size;
+  }
+  std::vector<ObjCorner>().swap(chunk.corners);
+}
+
+// parses the OBJ in data into mesh, a chunk of lines per thread. False if
+// it's something only tinyobj can read
+bool ParseObj(const char *data, size_t size, Mesh &mesh) {
+  // a last line without a newline is copied out, so tinyobj's number parsing
+  // never reads past the end of the mapping
+  size_t body = size;
+  while (body > 0 && data[body - 1] != '\n' && data[body - 1] != '\r') {
+    body--;
+  }
+  std::string tail(data + body, data + size);
+
+  std::vector<ObjChunk> chunks;
+  for (const char *begin = data, *end = data + body; begin < end;) {
+    const char *stop =
+        begin + std::min(OBJ_CHUNK_BYTES, (size_t)(end - begin));
+    while (stop < end && stop[-1] != '\n' && stop[-1] != '\r') {
+      stop++;
+    }
+    chunks.emplace_back(begin, stop);
+    begin = stop;
+  }
+  if (!tail.empty()) {
+    chunks.emplace_back(tail.data(), tail.data() + tail.size());
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < (int)chunks.size(); i++) {
+    CountLines(chunks[i]);
+  }
+  ObjCounts totals;
+  for (ObjChunk &chunk : chunks) {
+    ObjCounts lines = chunk.lines;
+    chunk.lines = totals;
+    totals.positions += lines.positions;
+    totals.texCoords += lines.texCoords;
+    totals.normals += lines.normals;
+  }
+  if (totals.positions >= UINT32_MAX || totals.texCoords >= INT32_MAX) {
+    return false;
+  }
+
+  std::vector<float> positions(3 * totals.positions);
+  std::vector<float> texCoords(2 * totals.texCoords);
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < (int)chunks.size(); i++) {
+    ParseChunk(chunks[i], totals, positions, texCoords);
+    if (chunks[i].supported) {
+      Triangulate(chunks[i], positions);
+    }
+  }
+
+  size_t cornerCount = 0;
+  for (const ObjChunk &chunk : chunks) {
+    if (!chunk.supported) {
+      return false;
+    }
+    cornerCount += chunk.triangles.size();
+  }
+
+  // the first corner to have each position and texture coordinate makes its
+  // vertex, so this pass has to go in order
+  size_t expected =
+      std::min(cornerCount, std::max(totals.positions, totals.texCoords));
+  CornerTable uniqueCorners(expected);
+  mesh.positions.reserve(expected);
+  mesh.texCoords.reserve(expected);
+  mesh.indices.reserve(cornerCount);
+  for (ObjChunk &chunk : chunks) {
+    for (const ObjCorner &corner : chunk.triangles) {
+      mesh.indices.push_back(uniqueCorners.insert(
+          MakeCorner(corner, positions, texCoords), mesh));
+    }
+    std::vector<ObjCorner>().swap(chunk.triangles);
+  }
+  return true;
+}
+
+bool ReadMeshCache(const std::string &filename, uint64_t objSize,
+                   int64_t objModified, Mesh &mesh) {
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(filename);
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+
+  MeshCacheHeader header;
+  if (file->size() < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, file->data(), sizeof(header));
+  if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+      header.version != MESH_CACHE_VERSION || header.objSize != objSize ||
+      header.objModified != objModified ||
+      header.positionCount >= UINT32_MAX ||
+      header.indexCount > file->size() / sizeof(uint32_t)) {
+    return false;
+  }
+  MeshCacheLayout layout(header.positionCount, header.indexCount);
+  if (layout.size != file->size()) {
+    return false;
+  }
+
+  const char *data = file->data();
+  mesh.positions.resize(header.positionCount);
+  mesh.texCoords.resize(header.positionCount);
+  mesh.indices.resize(header.indexCount);
+  memcpy(mesh.positions.data(), data + layout.positions,
+         header.positionCount * sizeof(glm::vec3));
+  memcpy(mesh.texCoords.data(), data + layout.texCoords,
+         header.positionCount * sizeof(glm::vec2));
+  memcpy(mesh.indices.data(), data + layout.indices,
+         header.indexCount * sizeof(uint32_t));
+  return true;
+}
+
+// writes the cache under a temporary name and renames it into place, so a
+// process loading the same OBJ at the same time never sees half of it. A
+// cache that can't be written is skipped
+void WriteMeshCache(const std::string &filename, uint64_t objSize,
+                    int64_t objModified, const Mesh &mesh) {
+  MeshCacheHeader header = {};
+  memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+  header.version = MESH_CACHE_VERSION;
+  header.objSize = objSize;
+  header.objModified = objModified;
+  header.positionCount = mesh.positions.size();
+  header.indexCount = mesh.indices.size();
+  MeshCacheLayout layout(header.positionCount, header.indexCount);
+
+  std::string temporary =
+      filename + "." + std::to_string(std::random_device{}()) + ".tmp";
+  FILE *file = fopen(temporary.c_str(), "wb");
+  if (!file) {
+    return;
+  }
+  const char zeros[MESH_CACHE_ALIGNMENT] = {};
+  auto pad = [&](size_t offset) {
+    long padding = (long)offset - ftell(file);
+    return fwrite(zeros, 1, padding, file) == (size_t)padding;
+  };
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(mesh.positions.data(), sizeof(glm::vec3), mesh.positions.size(),
+             file) == mesh.positions.size() &&
+      pad(layout.texCoords) &&
+      fwrite(mesh.texCoords.data(), sizeof(glm::vec2), mesh.texCoords.size(),
+             file) == mesh.texCoords.size() &&
+      pad(layout.indices) &&
+      fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(),
+             file) == mesh.indices.size();
+  if (fclose(file) != 0 || !written ||
+      std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+  }
+}
+} // namespace
+
+Mesh ParseMesh(const std::string &filename) {
+  Mesh mesh;
+  {
+    MappedFile file(filename);
+    if (ParseObj(file.data(), file.size(), mesh)) {
+      return mesh;
+    }
+  }
+  return LoadMeshWithTinyObj(filename);
+}
+
+Mesh LoadMesh(const std::string &filename) {
+  std::error_code error;
+  uint64_t objSize = std::filesystem::file_size(filename, error);
+  if (error) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  int64_t objModified = (int64_t)std::filesystem::last_write_time(filename, error)
+                            .time_since_epoch()
+                            .count();
+  if (error) {
+    return ParseMesh(filename);
+  }
+
+  std::string cacheFilename = filename + ".mesh";
+  Mesh mesh;
+  if (ReadMeshCache(cacheFilename, objSize, objModified, mesh)) {
+    return mesh;
+  }
+  mesh = ParseMesh(filename);
+  WriteMeshCache(cacheFilename, objSize, objModified, mesh);
+  return mesh;
+}
+} // namespace Infinite
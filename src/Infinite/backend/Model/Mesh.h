@@ -0,0 +1,42 @@
+#ifndef INFINITE_MESH_H
+#define INFINITE_MESH_H
+
+#pragma once
+
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <string>
+#include <vector>
+
+namespace Infinite {
+// A triangle mesh in plain CPU memory, with nothing uploaded anywhere. The
+// BVH and the headless simulator only need this, Model builds its GPU buffers
+// from it.
+struct Mesh {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords; // one per position, v flipped for Vulkan
+  std::vector<uint32_t> indices;    // three per triangle
+
+  size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// parses an OBJ, merging corners with the same position and texture
+// coordinate into one vertex. Throws std::runtime_error if it can't be read.
+//
+// The mesh is cached in filename + ".mesh", which is written the first time
+// and read back, with no parsing, while the OBJ's size and modification time
+// are the same as when it was written. Caches that can't be written are
+// skipped.
+Mesh LoadMesh(const std::string &filename);
+// LoadMesh() without the cache. Large OBJs are split into chunks of lines that
+// are parsed on every core; the few things that parser leaves to tinyobj
+// (polygons with more than four corners, zero or out of range indices) send
+// the whole file through tinyobj instead
+Mesh ParseMesh(const std::string &filename);
+// ParseMesh() by tinyobj alone, on one thread. Its fallback, and what it has
+// to come out the same as
+Mesh LoadMeshWithTinyObj(const std::string &filename);
+} // namespace Infinite
+
+#endif // INFINITE_MESH_H
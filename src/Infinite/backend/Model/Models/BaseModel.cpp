@@ -6,23 +6,11 @@
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/fwd.hpp>
-#include <glm/gtx/hash.hpp>
 #include <glm/gtx/transform.hpp>
 #include <iostream>
 #include <ostream>
-#include <unordered_map>
 #include <vulkan/vulkan_core.h>
-#include "../tiny_obj_loader.h"
-
-
-namespace std {
-template <> struct hash<Infinite::Vertex> {
-  size_t operator()(Infinite::Vertex const &vertex) const {
-    return (hash<glm::vec3>()(vertex.pos) ^
-            (hash<glm::vec2>()(vertex.texCoord) << 1));
-  }
-};
-} // namespace std
+#include "../Mesh.h"
 
 namespace Infinite {
 
@@ -64,39 +52,13 @@ void BaseModel::loadModel(std::vector<Vertex> &vertices,
                           std::vector<uint32_t> &indices,
                           const std::string &model_path) {
 
-  tinyobj::ObjReader reader;
-
-  if (!reader.ParseFromFile(model_path)) {
-    if (!reader.Error().empty()) {
-      throw std::runtime_error("TinyObjReader: " + reader.Error());
-    }
-  }
-
-  if (!reader.Warning().empty()) {
-    std::cout << "TinyObjReader: " << reader.Warning();
-  }
-
-  auto &attrib = reader.GetAttrib();
-  auto &shapes = reader.GetShapes();
-
-  std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-  for (const auto &shape : shapes) {
-    for (const auto &index : shape.mesh.indices) {
-      Vertex vertex({attrib.vertices[3 * index.vertex_index + 0],
-                     attrib.vertices[3 * index.vertex_index + 1],
-                     attrib.vertices[3 * index.vertex_index + 2]},
-                    {attrib.texcoords[2 * index.texcoord_index + 0],
-                     1.0f - attrib.texcoords[2 * index.texcoord_index + 1]});
-
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-        vertices.push_back(vertex);
-      }
+  Mesh mesh = LoadMesh(model_path);
 
-      indices.push_back(uniqueVertices[vertex]);
-    }
+  vertices.reserve(vertices.size() + mesh.positions.size());
+  for (size_t i = 0; i < mesh.positions.size(); i++) {
+    vertices.push_back(Vertex(mesh.positions[i], mesh.texCoords[i]));
   }
+  indices = std::move(mesh.indices);
 }
 
 void BaseModel::updateUniformBuffer(uint32_t index, Camera camera,
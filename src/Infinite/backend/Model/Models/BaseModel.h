@@ -5,14 +5,6 @@
 #define MAX_MODELS 128
 #endif
 
-#ifndef TINYOBJLOADER_IMPLEMENTATION
-#define TINYOBJLOADER_IMPLEMENTATION
-#endif
-
-#ifndef TINYOBJLOADER_USE_MAPBOX_EARCUT
-#define TINYOBJLOADER_USE_MAPBOX_EARCUT
-#endif
-
 #include "DescriptorSet.h"
 #include <cstdint>
 #include <vulkan/vulkan_core.h>
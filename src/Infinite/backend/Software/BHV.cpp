@@ -25,6 +25,7 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <ctime>
 #include <glm/common.hpp>
 #include <glm/detail/qualifier.hpp>
@@ -37,6 +38,9 @@
 #include <sys/types.h>
 #include <vector>
 
+#include "../../../Profiling/Metrics.h"
+#include "../../../Profiling/Trace.h"
+#include "../../frontend/Camera.h"
 #include "BVH.h"
 
 using namespace std;
@@ -54,16 +58,19 @@ using namespace std;
 unsigned g_reportCounter = 0;
 
 unsigned g_trianglesNo;
-Triangle g_triangles[1290] = {};
+std::vector<Triangle> g_triangles;
 
 // The BVH
 BVHNode *g_pSceneBVH = NULL;
-std::vector<Infinite::Vertex> vertices;
+std::vector<glm::vec3> vertices;
 // the cache-friendly version of the BVH, to be stored in a file
 unsigned g_triIndexListNo = 0;
 int *g_triIndexList = NULL;
 unsigned g_pCFBVH_No = 0;
 CacheFriendlyBVHNode *g_pCFBVH = NULL;
+// false while they point into someone else's memory, see
+// UseBoundingVolumeHierarchy()
+bool g_ownsCFBVH = false;
 
 // Work item for creation of BVH:
 struct BBoxTmp {
@@ -350,21 +357,22 @@ BVHNode *Recurse(BBoxEntries &work, REPORTPRM(float pct = 0.) int depth = 0) {
 } // end of Recurse() function, returns the rootnode (when all recursion calls
   // have finished)
 
-void loadTri(Infinite::Model mainModel) {
-  vertices = mainModel.vertices;
+void loadTri(const Infinite::Mesh &mesh) {
+  vertices = mesh.positions;
 
-  g_trianglesNo = 1290;
+  g_trianglesNo = mesh.triangleCount();
+  g_triangles.resize(g_trianglesNo);
   uint32_t index = 0;
-  for (uint32_t i = 0; i < mainModel.indices.size(); i += 3) {
-    g_triangles[index]._idx1 = mainModel.indices[i];
-    g_triangles[index]._idx2 = mainModel.indices[i + 1];
-    g_triangles[index]._idx3 = mainModel.indices[i + 2];
+  for (uint32_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    g_triangles[index]._idx1 = mesh.indices[i];
+    g_triangles[index]._idx2 = mesh.indices[i + 1];
+    g_triangles[index]._idx3 = mesh.indices[i + 2];
 
     index++;
   }
 }
 
-BVHNode *CreateBVH(Infinite::Model mainModel) {
+BVHNode *CreateBVH(const Infinite::Mesh &mesh) {
   /* Summary:
   1. Create work BBox
   2. Create BBox for every triangle and compute bounds
@@ -373,7 +381,7 @@ BVHNode *CreateBVH(Infinite::Model mainModel) {
   5. Build BVH tree with Recurse()
   6. Return root node
   */
-  loadTri(mainModel);
+  loadTri(mesh);
 
   std::vector<BBoxTmp> work;
   glm::vec3 bottom(FLT_MAX, FLT_MAX, FLT_MAX);
@@ -390,15 +398,15 @@ BVHNode *CreateBVH(Infinite::Model mainModel) {
     // loop over triangle vertices and pick smallest vertex for bottom of
     // triangle bbox
 
-    b._bottom = vertices[triangle._idx1].pos; // index of vertex
-    b._bottom = glm::min(b._bottom, vertices[triangle._idx2].pos);
-    b._bottom = glm::min(b._bottom, vertices[triangle._idx3].pos);
+    b._bottom = vertices[triangle._idx1]; // index of vertex
+    b._bottom = glm::min(b._bottom, vertices[triangle._idx2]);
+    b._bottom = glm::min(b._bottom, vertices[triangle._idx3]);
 
     // loop over triangle vertices and pick largest vertex for top of triangle
     // bbox
-    b._top = vertices[triangle._idx1].pos;
-    b._top = glm::max(b._top, vertices[triangle._idx2].pos);
-    b._top = glm::max(b._top, vertices[triangle._idx3].pos);
+    b._top = vertices[triangle._idx1];
+    b._top = glm::max(b._top, vertices[triangle._idx2]);
+    b._top = glm::max(b._top, vertices[triangle._idx3]);
 
     // expand working list bbox by largest and smallest triangle bbox bounds
     bottom = glm::min(bottom, b._bottom);
@@ -511,6 +519,7 @@ void CreateCFBVH() {
 
   g_pCFBVH_No = CountBoxes(g_pSceneBVH);
   g_pCFBVH = new CacheFriendlyBVHNode[g_pCFBVH_No];
+  g_ownsCFBVH = true;
   // array
 
   PopulateCacheFriendlyBVH(&g_triangles[0], g_pSceneBVH, idxBoxes, idxTriList);
@@ -606,9 +615,9 @@ bool IntersectAABB(const Ray &ray, const glm::vec3 bmin, const glm::vec3 bmax) {
 std::optional<float> rayTriangleIntersection(Ray &ray, Triangle &triangle) {
   const float EPSILON = 1e-8;
 
-  glm::vec3 v0 = vertices[triangle._idx1].pos;
-  glm::vec3 v1 = vertices[triangle._idx2].pos;
-  glm::vec3 v2 = vertices[triangle._idx3].pos;
+  glm::vec3 v0 = vertices[triangle._idx1];
+  glm::vec3 v1 = vertices[triangle._idx2];
+  glm::vec3 v2 = vertices[triangle._idx3];
   // Edges of the triangle
   glm::vec3 edge1 = v1 - v0;
   glm::vec3 edge2 = v2 - v0;
@@ -648,11 +657,12 @@ std::optional<float> rayTriangleIntersection(Ray &ray, Triangle &triangle) {
   return std::nullopt;
 }
 
-void Intersect(Ray *ray, uint32_t index) {
+void Intersect(Ray *ray, uint32_t index, uint64_t &visited) {
   //<<Follow ray through BVH nodes to find primitive intersections>>
   // int toVisitOffset = 0, currentNodeIndex = 0;
   // BVHNode *nodesToVisit[64];
   CacheFriendlyBVHNode *node = &g_pCFBVH[index];
+  visited++;
   //<<Check ray against BVH node>>
 
   // std::cout << "(" << node->_bottom.x << ", " << node->_bottom.y << ", "
@@ -684,8 +694,8 @@ void Intersect(Ray *ray, uint32_t index) {
       //<<Put far BVH node on nodesToVisit stack, advance to near node>>
       // std::cout << index << " -> " << node->u.inner._idxLeft << ", "
       //           << node->u.inner._idxRight << std::endl;
-      Intersect(ray, node->u.inner._idxLeft);
-      Intersect(ray, node->u.inner._idxRight);
+      Intersect(ray, node->u.inner._idxLeft, visited);
+      Intersect(ray, node->u.inner._idxRight, visited);
       return;
     }
   } else {
@@ -722,12 +732,12 @@ void Intersect(Ray *ray, uint32_t index) {
 //   }
 // }
 
-std::vector<Ray> generateRaysAroundPoint(const glm::vec3 &origin) {
+void generateRaysAroundPoint(const glm::vec3 &origin, std::vector<Ray> &rays) {
   float angleStep =
       0.5f * glm::pi<float>() / 180.0f; // Convert degrees to radians
-  std::vector<Ray> rays;
+  rays.clear();
   float angle = 0.0f;
-  for (int i = 0; i < 720; ++i) {
+  for (int i = 0; i < LIDAR_RAYS; ++i) {
     float x = std::cos(angle);
     float y = std::sin(angle);
     glm::vec3 direction =
@@ -736,25 +746,19 @@ std::vector<Ray> generateRaysAroundPoint(const glm::vec3 &origin) {
     rays.push_back(r);
     angle += angleStep;
   }
-
-  return rays;
 }
 
 // The gateway - creates the "pure" BVH, and then copies the results in the
 // cache-friendly one
 void UpdateBoundingVolumeHierarchy(const char *filename,
-                                   Infinite::Model mainModel) {
+                                   const Infinite::Mesh &mesh) {
   if (!g_pSceneBVH) {
     std::string BVHcacheFilename(filename);
     BVHcacheFilename += ".bvh";
     FILE *fp = fopen(BVHcacheFilename.c_str(), "rb");
     if (!fp) {
       // No cached BVH data - we need to calculate them
-      g_pSceneBVH = CreateBVH(mainModel);
-      // Now that the BVH has been created, copy its data into a more
-      // cache-friendly format (CacheFriendlyBVHNode occupies exactly 32 bytes,
-      // i.e. a cache-line)
-      CreateCFBVH();
+      BuildBoundingVolumeHierarchy(mesh);
 
       // Now store the results, if possible...
       fp = fopen(BVHcacheFilename.c_str(), "wb");
@@ -780,6 +784,7 @@ void UpdateBoundingVolumeHierarchy(const char *filename,
         return;
       g_pCFBVH = new CacheFriendlyBVHNode[g_pCFBVH_No];
       g_triIndexList = new int[g_triIndexListNo];
+      g_ownsCFBVH = true;
       if (g_pCFBVH_No !=
           fread(g_pCFBVH, sizeof(CacheFriendlyBVHNode), g_pCFBVH_No, fp))
         return;
@@ -787,22 +792,91 @@ void UpdateBoundingVolumeHierarchy(const char *filename,
           fread(g_triIndexList, sizeof(int), g_triIndexListNo, fp))
         return;
       fclose(fp);
-      loadTri(mainModel);
+      loadTri(mesh);
     }
   }
 }
 
+void BuildBoundingVolumeHierarchy(const Infinite::Mesh &mesh) {
+  g_pSceneBVH = CreateBVH(mesh);
+  // Now that the BVH has been created, copy its data into a more
+  // cache-friendly format (CacheFriendlyBVHNode occupies exactly 32 bytes,
+  // i.e. a cache-line)
+  CreateCFBVH();
+}
+
+void GetBoundingVolumeHierarchy(const CacheFriendlyBVHNode *&nodes,
+                                unsigned &nodeCount,
+                                const int *&triangleIndices,
+                                unsigned &triangleIndexCount) {
+  nodes = g_pCFBVH;
+  nodeCount = g_pCFBVH_No;
+  triangleIndices = g_triIndexList;
+  triangleIndexCount = g_triIndexListNo;
+}
+
+void UseBoundingVolumeHierarchy(const CacheFriendlyBVHNode *nodes,
+                                unsigned nodeCount,
+                                const int *triangleIndices,
+                                unsigned triangleIndexCount,
+                                const glm::vec3 *positions,
+                                size_t positionCount, const uint32_t *indices,
+                                size_t indexCount) {
+  destroyBVH();
+  // only ever read once built
+  g_pCFBVH = const_cast<CacheFriendlyBVHNode *>(nodes);
+  g_pCFBVH_No = nodeCount;
+  g_triIndexList = const_cast<int *>(triangleIndices);
+  g_triIndexListNo = triangleIndexCount;
+  g_ownsCFBVH = false;
+
+  vertices.assign(positions, positions + positionCount);
+  g_trianglesNo = indexCount / 3;
+  g_triangles.resize(g_trianglesNo);
+  static_assert(sizeof(Triangle) == 3 * sizeof(uint32_t),
+                "a Triangle is three indices");
+  memcpy(g_triangles.data(), indices, g_trianglesNo * sizeof(Triangle));
+}
+
 std::vector<Ray> LIDAR;
 
+void TraceLidar(const glm::vec3 &origin, std::vector<Ray> &rays) {
+  TRACE_ZONE("TraceLidar");
+  LATENCY_SCOPE(LIDAR_LATENCY);
+  generateRaysAroundPoint(origin, rays);
+
+  // a zone per thread for its share of the rays, and the nodes they visited
+  // counted once per thread rather than once per node
+#pragma omp parallel
+  {
+    TRACE_ZONE("Intersect batch");
+    uint64_t visited = 0;
+#pragma omp for
+    for (uint32_t i = 0; i < rays.size(); i++) {
+      Intersect(&rays[i], 0, visited);
+    }
+    CountMetric(BVH_NODES_VISITED, visited);
+  }
+  CountMetric(RAYS_TRACED, rays.size());
+}
+
+void TraceRays(std::vector<Ray> &rays) {
+  uint64_t visited = 0;
+  for (Ray &ray : rays) {
+    Intersect(&ray, 0, visited);
+  }
+  CountMetric(BVH_NODES_VISITED, visited);
+  CountMetric(RAYS_TRACED, rays.size());
+}
+
 bool update() {
+  TRACE_ZONE("update");
   bool ahhh = false;
-  LIDAR = generateRaysAroundPoint(glm::vec3(Infinite::cameras.getPosition().x, Infinite::cameras.getPosition().y, 0.05f));
+  TraceLidar(glm::vec3(Infinite::cameras.getPosition().x, Infinite::cameras.getPosition().y, 0.05f), LIDAR);
   // std::cout << Infinite::cameras.getPosition().z << std::endl;
 
-#pragma omp parallel for
   for (uint32_t i = 0; i < LIDAR.size(); i++) {
-    Intersect(&LIDAR[i], 0);
-    if (LIDAR[i].t < 0.04) {
+    if (LIDAR[i].t < LIDAR_CRASH_DISTANCE) {
       ahhh = true;
     }
   }
@@ -813,8 +887,13 @@ bool update() {
 }
 
 void destroyBVH() {
-      delete g_triIndexList;
-      delete g_pCFBVH;
+  if (g_ownsCFBVH) {
+    delete[] g_triIndexList;
+    delete[] g_pCFBVH;
+  }
+  g_triIndexList = NULL;
+  g_pCFBVH = NULL;
+  g_ownsCFBVH = false;
   // for(uint32_t i = 0; i < 1290; i++) {
   // }
 }
@@ -20,7 +20,7 @@
 #ifndef __BVH_H_
 #define __BVH_H_
 
-#include "../Model/Models/Model.h"
+#include "../Model/Mesh.h"
 #include <cmath>
 #include <glm/ext/vector_float3.hpp>
 #include <list>
@@ -84,8 +84,39 @@ void CreateCFBVH(); // CacheFriendlyBVH
 
 // The single-point entrance to the BVH - call only this
 void UpdateBoundingVolumeHierarchy(const char *filename,
-                                   Infinite::Model mainModel);
+                                   const Infinite::Mesh &mesh);
 
+// builds the BVH of mesh without looking for or writing a cache file
+void BuildBoundingVolumeHierarchy(const Infinite::Mesh &mesh);
+// the cache-friendly BVH that was built or loaded, to store it elsewhere
+void GetBoundingVolumeHierarchy(const CacheFriendlyBVHNode *&nodes,
+                                unsigned &nodeCount,
+                                const int *&triangleIndices,
+                                unsigned &triangleIndexCount);
+// traces against a BVH stored elsewhere (see Scenario.h) in place of the one
+// there was. nodes and triangleIndices are used where they are and have to
+// outlive it, the triangles are copied
+void UseBoundingVolumeHierarchy(const CacheFriendlyBVHNode *nodes,
+                                unsigned nodeCount,
+                                const int *triangleIndices,
+                                unsigned triangleIndexCount,
+                                const glm::vec3 *positions,
+                                size_t positionCount, const uint32_t *indices,
+                                size_t indexCount);
+
+// a LIDAR scan closer than this to anything is a crash
+const float LIDAR_CRASH_DISTANCE = 0.04f;
+// rays in a scan, one every half degree counter-clockwise from x
+const int LIDAR_RAYS = 720;
+
+// traces a full scan from origin into rays. It only reads the BVH, so any
+// number of threads can trace their own scans at once
+void TraceLidar(const glm::vec3 &origin, std::vector<Ray> &rays);
+// traces rays someone else aimed, on the calling thread only, for callers
+// that already spread their own work over the cores
+void TraceRays(std::vector<Ray> &rays);
+
+// traces LIDAR from the camera, returns true if the car hit something
 bool update();
 
 extern std::vector<Ray> LIDAR;
@@ -93,7 +124,7 @@ extern std::vector<Ray> LIDAR;
 void destroyBVH();
 
 extern unsigned g_trianglesNo;
-extern Triangle g_triangles[1290];
-extern std::vector<Infinite::Vertex> vertices;
+extern std::vector<Triangle> g_triangles;
+extern std::vector<glm::vec3> vertices;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "CarTLAS.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/common.hpp>
+
+namespace {
+const uint32_t LEAF_SIZE = 2;
+const int STACK_SIZE = 64;
+
+// the ray's entry distance into an axis aligned box, or INFINITY if it
+// misses it or only gets there past ray.t
+float EnterBox(const Ray &ray, const glm::vec3 &bottom, const glm::vec3 &top) {
+  glm::vec3 t1 = (bottom - ray.O) * ray.inv;
+  glm::vec3 t2 = (top - ray.O) * ray.inv;
+  glm::vec3 near = glm::min(t1, t2);
+  glm::vec3 far = glm::max(t1, t2);
+  float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+  float exit = std::min(std::min(far.x, far.y), std::min(far.z, ray.t));
+  return enter <= exit ? enter : INFINITY;
+}
+
+// the same in the car's own frame, where its box is axis aligned
+float EnterCar(const Ray &ray, const CarInstance &car) {
+  glm::vec2 forward(-std::cos(car.heading), std::sin(car.heading));
+  glm::vec2 left(-forward.y, forward.x);
+  glm::vec3 offset = ray.O - glm::vec3(car.position, car.halfSize.z);
+
+  Ray local;
+  local.O = glm::vec3(offset.x * forward.x + offset.y * forward.y,
+                      offset.x * left.x + offset.y * left.y, offset.z);
+  local.D = glm::vec3(ray.D.x * forward.x + ray.D.y * forward.y,
+                      ray.D.x * left.x + ray.D.y * left.y, ray.D.z);
+  local.inv = 1.0f / local.D;
+  local.t = ray.t;
+  return EnterBox(local, -car.halfSize, car.halfSize);
+}
+} // namespace
+
+void CarTLAS::build(const std::vector<CarInstance> &cars) {
+  instances = cars;
+  const uint32_t count = (uint32_t)instances.size();
+  bottoms.resize(count);
+  tops.resize(count);
+  centres.resize(count);
+  order.resize(count);
+  nodes.clear();
+
+  for (uint32_t i = 0; i < count; i++) {
+    const CarInstance &car = instances[i];
+    // the box's extent along x and y once it is turned
+    float c = std::abs(std::cos(car.heading));
+    float s = std::abs(std::sin(car.heading));
+    glm::vec3 extent(c * car.halfSize.x + s * car.halfSize.y,
+                     s * car.halfSize.x + c * car.halfSize.y,
+                     car.halfSize.z);
+    glm::vec3 centre(car.position, car.halfSize.z);
+    bottoms[i] = centre - extent;
+    tops[i] = centre + extent;
+    centres[i] = centre;
+    order[i] = i;
+  }
+
+  if (count > 0) {
+    buildNode(0, count);
+  }
+}
+
+void CarTLAS::buildNode(uint32_t begin, uint32_t end) {
+  uint32_t index = (uint32_t)nodes.size();
+  nodes.push_back(Node());
+
+  glm::vec3 bottom(FLT_MAX);
+  glm::vec3 top(-FLT_MAX);
+  glm::vec3 low(FLT_MAX);
+  glm::vec3 high(-FLT_MAX);
+  for (uint32_t i = begin; i < end; i++) {
+    bottom = glm::min(bottom, bottoms[order[i]]);
+    top = glm::max(top, tops[order[i]]);
+    low = glm::min(low, centres[order[i]]);
+    high = glm::max(high, centres[order[i]]);
+  }
+  nodes[index].bottom = bottom;
+  nodes[index].top = top;
+
+  if (end - begin <= LEAF_SIZE) {
+    nodes[index].first = begin;
+    nodes[index].count = end - begin;
+    return;
+  }
+
+  // split at the median centre along the widest spread of centres
+  glm::vec3 spread = high - low;
+  int axis = spread.x > spread.y ? 0 : 1;
+  axis = spread.z > spread[axis] ? 2 : axis;
+  uint32_t middle = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + middle,
+                   order.begin() + end, [this, axis](uint32_t a, uint32_t b) {
+                     return centres[a][axis] < centres[b][axis];
+                   });
+
+  buildNode(begin, middle);
+  nodes[index].first = (uint32_t)nodes.size();
+  nodes[index].count = 0;
+  buildNode(middle, end);
+}
+
+void CarTLAS::intersect(Ray &ray, int skip) const {
+  if (nodes.empty()) {
+    return;
+  }
+
+  uint32_t stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node &node = nodes[stack[--top]];
+    if (EnterBox(ray, node.bottom, node.top) == INFINITY) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if ((int)order[i] == skip) {
+          continue;
+        }
+        float t = EnterCar(ray, instances[order[i]]);
+        if (t < ray.t) {
+          ray.t = t;
+        }
+      }
+    } else {
+      uint32_t self = (uint32_t)(&node - nodes.data());
+      stack[top++] = node.first;
+      stack[top++] = self + 1;
+    }
+  }
+}
+
+void CarTLAS::intersect(std::vector<Ray> &rays, int skip) const {
+  for (Ray &ray : rays) {
+    intersect(ray, skip);
+  }
+}
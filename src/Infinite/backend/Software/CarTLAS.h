@@ -0,0 +1,59 @@
+#ifndef SOFTWARE_CAR_TLAS_H
+#define SOFTWARE_CAR_TLAS_H
+
+#pragma once
+
+#include "BVH.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <vector>
+
+// a car as LIDAR sees it: a box sitting on the ground
+struct CarInstance {
+  glm::vec2 position;  // metres, world
+  float heading;       // Car::heading, the car faces (-cos, sin) like the camera
+  glm::vec3 halfSize;  // half the length, width and height
+};
+
+// Top level acceleration structure over the cars on track, the moving half
+// of the scene. The track's BVH in BHV.cpp never changes, so it stays the
+// bottom level and is traced first; the cars' boxes are then traced with
+// whatever distance the track left, so most of them are culled by their
+// bounds alone.
+//
+// It is rebuilt from scratch every step, which is cheaper than refitting
+// for the handful of cars in a race: a median split over the box centres,
+// into buffers that are kept between builds.
+class CarTLAS {
+public:
+  void build(const std::vector<CarInstance> &instances);
+
+  // shortens ray.t to the closest car the ray hits, ignoring car skip (the
+  // one the ray starts in)
+  void intersect(Ray &ray, int skip = -1) const;
+  void intersect(std::vector<Ray> &rays, int skip = -1) const;
+
+  size_t size() const { return instances.size(); }
+
+private:
+  // depth first: an inner node's left child is the next node and its right
+  // child is at `right`. Leaves have count > 0 cars from `first` in order
+  struct Node {
+    glm::vec3 bottom;
+    glm::vec3 top;
+    uint32_t first; // leaf: index into order, inner: right child
+    uint32_t count;
+  };
+
+  std::vector<CarInstance> instances;
+  std::vector<glm::vec3> bottoms;
+  std::vector<glm::vec3> tops;
+  std::vector<glm::vec3> centres;
+  std::vector<uint32_t> order;
+  std::vector<Node> nodes;
+
+  void buildNode(uint32_t begin, uint32_t end);
+};
+
+#endif // SOFTWARE_CAR_TLAS_H
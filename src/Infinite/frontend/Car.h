@@ -1,3 +1,8 @@
+#ifndef CAR_H
+#define CAR_H
+
+#pragma once
+
 #include <algorithm>
 #include <cmath>
 #include <glm/common.hpp>
@@ -17,20 +22,24 @@ public:
   float wheelRadius;  // Radius of the wheels
   float mass;         // Mass of the car (kg)
   float acceleration; // Linear acceleration (m/s^2)
-  float angularVelocity;
+  float angularVelocity; // yaw rate of the last update (rad/s)
   float carWidth;
 
+  // steering is clamped to +-maxSteeringDegrees
+  static constexpr float maxSteeringDegrees = 20.0f;
+
   Car(float initX, float initHeading, float wheelbaseLength, float wheelR,
       float carMass, float width)
       : position(initX), heading(initHeading), velocity(0.0f),
         wheelbase(wheelbaseLength), wheelRadius(wheelR), mass(carMass),
-        acceleration(0.0f), carWidth(width) {}
+        acceleration(0.0f), angularVelocity(0.0f), carWidth(width) {}
 
   // Update car's position based on torque, steering angle, and time step
   inline float update(float steeringAngleDegrees, float torque,
                       float deltaTime) {
     // Convert steering angle to radians
-    steeringAngleDegrees = std::clamp(steeringAngleDegrees, -20.0f, 20.0f);
+    steeringAngleDegrees = std::clamp(steeringAngleDegrees, -maxSteeringDegrees,
+                                      maxSteeringDegrees);
     float steeringAngle = glm::radians(steeringAngleDegrees);
     position = 0;
     // Calculate the force exerted by the torque on the wheels (force = torque /
@@ -45,25 +54,17 @@ public:
 
     // 0.4 is a really good max
     velocity = std::clamp(velocity, -0.6f, 0.6f);
-    if (std::abs(velocity) < 1e-4) {
+    // snap to a stop once braking or coasting has all but stopped the car,
+    // but let a drive force build speed from 0 however short the step is
+    if (std::abs(velocity) < 1e-4 && acceleration * velocity <= 0.0f) {
       velocity = 0.0f;
       acceleration = 0.0f;
     }
-    // Calculate turning radius
-    float turningRadius;
-    if (std::abs(steeringAngle) > 0.0001f) {
-      turningRadius = wheelbase / std::tan(steeringAngle);
-    } else {
-      turningRadius = INFINITY; // No turning if steering is zero
-    }
-
-    // Calculate angular velocity (if turning)
-    float angularVelocity =
-        (turningRadius == INFINITY) ? 0.0f : (100 / turningRadius);
-
-    if (velocity == 0) {
-      angularVelocity = 0;
-    }
+    // Kinematic bicycle: the rear axle follows an arc of radius
+    // wheelbase / tan(steering), so the yaw rate grows with speed. It's the
+    // model the controllers, ControlLoop and the lattice and Hybrid-A*
+    // planners predict the car with
+    angularVelocity = velocity * std::tan(steeringAngle) / wheelbase;
     // Update car's heading (orientation)
     heading += angularVelocity * deltaTime;
 
@@ -80,3 +81,5 @@ public:
               << " m/s^2, Heading: " << heading * 180.0f / M_PI << " degrees\n";
   }
 };
+
+#endif // CAR_H
@@ -0,0 +1,63 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Fixed timestep clock for the simulation. Frame times go in, a whole number
+// of fixed steps comes out, and whatever is left over carries to the next
+// frame, so the simulation only ever sees the same step size no matter how
+// fast or unevenly frames are drawn. Time is kept in integer nanoseconds so
+// the carried remainder never drifts.
+//
+// getAlpha() is how far the leftover time is into the next step, for drawing
+// the state between the last two steps instead of snapping to the latest.
+class SimulationClock {
+public:
+  explicit SimulationClock(double rate = 1000.0, int maxStepsPerFrame = 250)
+      : maxStepsPerFrame(maxStepsPerFrame) {
+    setRate(rate);
+  }
+
+  // steps per second
+  void setRate(double rate) {
+    stepNanoseconds = std::max<int64_t>(1, std::llround(1e9 / rate));
+    accumulator = std::min(accumulator, stepNanoseconds);
+  }
+
+  // adds a frame's worth of real time and returns how many steps are due. A
+  // frame longer than maxStepsPerFrame steps drops the rest, so one long
+  // stall can't leave the simulation running behind forever after
+  inline int advance(double frameSeconds) {
+    accumulator += std::max<int64_t>(0, std::llround(frameSeconds * 1e9));
+    int64_t due = accumulator / stepNanoseconds;
+    if (due > maxStepsPerFrame) {
+      due = maxStepsPerFrame;
+      accumulator = due * stepNanoseconds;
+    }
+    accumulator -= due * stepNanoseconds;
+    return (int)due;
+  }
+
+  // call once per step run
+  inline void tick() { ticks++; }
+
+  double getStep() const { return stepNanoseconds * 1e-9; }
+  uint64_t getTicks() const { return ticks; }
+  // simulated seconds so far
+  double getTime() const { return ticks * getStep(); }
+  // fraction of a step between the last step and now, [0, 1)
+  float getAlpha() const { return (float)accumulator / stepNanoseconds; }
+
+  int maxStepsPerFrame;
+
+private:
+  int64_t stepNanoseconds = 1000000;
+  int64_t accumulator = 0;
+  uint64_t ticks = 0;
+};
+
+#endif // SIMULATION_CLOCK_H
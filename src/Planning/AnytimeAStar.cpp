@@ -0,0 +1,203 @@
+#include "AnytimeAStar.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// the open list is a binary heap sorted on f, smallest on top
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return a.f > b.f;
+  }
+};
+
+const int DIRECTIONS[8][2] = {{1, 0},  {-1, 0}, {0, 1},  {0, -1},
+                              {1, 1},  {1, -1}, {-1, 1}, {-1, -1}};
+
+enum CellState { UNSEEN, OPEN, CLOSED, INCONSISTENT };
+} // namespace
+
+AnytimeAStar::Status AnytimeAStar::plan(const OccupancyGrid &grid,
+                                        uint32_t version, glm::vec2 start,
+                                        glm::vec2 end, PlanBudget budget) {
+  this->grid = &grid;
+  expandedNodes = 0;
+
+  // update2() asks for the cell just past the far edge of the grid, so keep
+  // the goal on the map
+  int newStart = std::clamp((int)start.x, 0, MAP_WIDTH - 1) * MAP_HEIGHT +
+                 std::clamp((int)start.y, 0, MAP_HEIGHT - 1);
+  int newGoal = std::clamp((int)end.x, 0, MAP_WIDTH - 1) * MAP_HEIGHT +
+                std::clamp((int)end.y, 0, MAP_HEIGHT - 1);
+  if (!started || newStart != startIndex || newGoal != goalIndex ||
+      (version != this->version && !keepsSearch(grid))) {
+    startIndex = newStart;
+    goalIndex = newGoal;
+    restart();
+  }
+  this->version = version;
+
+  if (status == OPTIMAL || status == FAILED) {
+    return status;
+  }
+
+  budget.begin();
+  for (;;) {
+    bool finished = improvePath(budget);
+    expandedNodes = budget.getUsed();
+    if (!finished) {
+      if (status == SEARCHING) {
+        buildPath(closestIndex);
+      }
+      return status;
+    }
+
+    if (std::isinf(g[goalIndex])) {
+      status = FAILED;
+      path.clear();
+      return status;
+    }
+
+    buildPath(goalIndex);
+    if (epsilon <= 1.0f) {
+      status = OPTIMAL;
+      return status;
+    }
+    status = IMPROVING;
+    nextIteration();
+  }
+}
+
+bool AnytimeAStar::keepsSearch(const OccupancyGrid &grid) {
+  changed.clear();
+  DiffGrid(grid, searched, changed);
+  for (int index : changed) {
+    if (index == goalIndex) {
+      return false;
+    }
+    // a cell's cost is only read when one of its neighbours is expanded, and
+    // everything expanded has a finite g
+    int x = index / MAP_HEIGHT;
+    int y = index % MAP_HEIGHT;
+    for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, MAP_WIDTH - 1);
+         nx++) {
+      for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, MAP_HEIGHT - 1);
+           ny++) {
+        if (!std::isinf(g[nx * MAP_HEIGHT + ny])) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void AnytimeAStar::restart() {
+  searched = *grid;
+  g.assign(MAP_WIDTH * MAP_HEIGHT, INFINITY);
+  parent.assign(MAP_WIDTH * MAP_HEIGHT, -1);
+  state.assign(MAP_WIDTH * MAP_HEIGHT, UNSEEN);
+  open.clear();
+  path.clear();
+  started = true;
+  epsilon = std::max(initialEpsilon, 1.0f);
+  closestIndex = startIndex;
+
+  int startX = startIndex / MAP_HEIGHT;
+  int startY = startIndex % MAP_HEIGHT;
+  int goalX = goalIndex / MAP_HEIGHT;
+  int goalY = goalIndex % MAP_HEIGHT;
+  if (!IsPassable(*grid, startX, startY) || !IsPassable(*grid, goalX, goalY)) {
+    status = FAILED;
+    return;
+  }
+
+  status = SEARCHING;
+  g[startIndex] = 0.0f;
+  pushOpen(startIndex);
+}
+
+float AnytimeAStar::heuristic(int index) const {
+  return OctileDistance(index / MAP_HEIGHT - goalIndex / MAP_HEIGHT,
+                        index % MAP_HEIGHT - goalIndex % MAP_HEIGHT);
+}
+
+void AnytimeAStar::pushOpen(int index) {
+  state[index] = OPEN;
+  open.push_back({g[index] + epsilon * heuristic(index), g[index], index});
+  std::push_heap(open.begin(), open.end(), OpenCompare());
+}
+
+// lowers epsilon and starts the next, tighter, search from everything that
+// was left open or went inconsistent in the last one
+void AnytimeAStar::nextIteration() {
+  epsilon = std::max(1.0f, epsilon - epsilonStep);
+  open.clear();
+  for (int i = 0; i < MAP_WIDTH * MAP_HEIGHT; i++) {
+    if (state[i] == OPEN || state[i] == INCONSISTENT) {
+      pushOpen(i);
+    } else if (state[i] == CLOSED) {
+      state[i] = UNSEEN;
+    }
+  }
+}
+
+// returns false if the budget ran out before this epsilon's search finished
+bool AnytimeAStar::improvePath(PlanBudget &budget) {
+  for (;;) {
+    while (!open.empty() && (state[open.front().index] != OPEN ||
+                             open.front().g != g[open.front().index])) {
+      std::pop_heap(open.begin(), open.end(), OpenCompare());
+      open.pop_back();
+    }
+    if (open.empty() || g[goalIndex] <= open.front().f) {
+      return true;
+    }
+    if (budget.exhausted()) {
+      return false;
+    }
+
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    int index = open.back().index;
+    open.pop_back();
+    state[index] = CLOSED;
+    if (heuristic(index) < heuristic(closestIndex)) {
+      closestIndex = index;
+    }
+
+    int x = index / MAP_HEIGHT;
+    int y = index % MAP_HEIGHT;
+    for (const auto &dir : DIRECTIONS) {
+      int nx = x + dir[0];
+      int ny = y + dir[1];
+      if (!IsPassable(*grid, nx, ny)) {
+        continue;
+      }
+      bool diagonal = dir[0] != 0 && dir[1] != 0;
+      if (diagonal &&
+          (!IsPassable(*grid, nx, y) || !IsPassable(*grid, x, ny))) {
+        continue; // no cutting corners
+      }
+      float newG = g[index] + (diagonal ? 1.41421356f : 1.0f) *
+                                  TraversalCost(*grid, nx, ny);
+      int n = nx * MAP_HEIGHT + ny;
+      if (newG >= g[n]) {
+        continue;
+      }
+      g[n] = newG;
+      parent[n] = index;
+      if (state[n] == CLOSED) {
+        state[n] = INCONSISTENT; // reopened by the next iteration
+      } else if (state[n] != INCONSISTENT) {
+        pushOpen(n);
+      }
+    }
+  }
+}
+
+void AnytimeAStar::buildPath(int index) {
+  path.clear();
+  for (; index >= 0; index = parent[index]) {
+    path.push_back(glm::vec2(index / MAP_HEIGHT, index % MAP_HEIGHT));
+  }
+  std::reverse(path.begin(), path.end());
+}
@@ -0,0 +1,83 @@
+#ifndef PLANNING_ANYTIME_A_STAR_H
+#define PLANNING_ANYTIME_A_STAR_H
+
+#pragma once
+
+#include "OccupancyGrid.h"
+#include "PlanBudget.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// Anytime Repairing A* (ARA*, Likhachev et al. 2003) on the occupancy grid.
+// Each call to plan() only does as much work as its PlanBudget allows, then
+// hands back the best path so far: first a quick solution found with a
+// heavily inflated heuristic (at most epsilon times the optimal cost), which
+// later calls tighten until epsilon reaches 1. Until any solution exists the
+// path runs to the expanded cell closest to the goal.
+//
+// A call picks up where the last one stopped as long as the start and goal
+// are the same and the costmap either has the same version or only changed
+// in cells the search hasn't looked at yet. Otherwise it starts over.
+//
+// Costs match DStarLite: TraversalCost() per step, no cutting corners.
+class AnytimeAStar {
+public:
+  enum Status {
+    SEARCHING, // no complete path yet, getPath() is partial
+    IMPROVING, // complete path within getEpsilon() of optimal
+    OPTIMAL,   // complete path, epsilon has reached 1
+    FAILED     // the goal can't be reached
+  };
+
+  Status plan(const OccupancyGrid &grid, uint32_t version, glm::vec2 start,
+              glm::vec2 end, PlanBudget budget);
+
+  // best path from the start so far, in the same format as astar()
+  const std::vector<glm::vec2> &getPath() const { return path; }
+  Status getStatus() const { return status; }
+  float getEpsilon() const { return epsilon; }
+  // expansions used by the last call
+  uint32_t getExpandedNodes() const { return expandedNodes; }
+
+  float initialEpsilon = 3.0f;
+  float epsilonStep = 0.5f;
+
+private:
+  struct OpenEntry {
+    float f;
+    float g;
+    int index;
+  };
+
+  const OccupancyGrid *grid = nullptr;
+  bool started = false;
+  uint32_t version = 0;
+  int startIndex = -1;
+  int goalIndex = -1;
+  float epsilon = 1.0f;
+  Status status = FAILED;
+  uint32_t expandedNodes = 0;
+  int closestIndex = -1; // expanded cell with the smallest heuristic
+
+  std::vector<float> g;
+  std::vector<int> parent;
+  // 0 untouched, 1 open, 2 closed this iteration, 3 inconsistent
+  std::vector<uint8_t> state;
+  std::vector<OpenEntry> open;
+  std::vector<glm::vec2> path;
+  OccupancyGrid searched;   // the grid as the search has seen it
+  std::vector<int> changed; // cells that differ from it, see DiffGrid()
+
+  // true if the search so far still holds on grid, bringing searched up to
+  // date with it
+  bool keepsSearch(const OccupancyGrid &grid);
+  void restart();
+  float heuristic(int index) const;
+  void pushOpen(int index);
+  void nextIteration();
+  bool improvePath(PlanBudget &budget);
+  void buildPath(int index);
+};
+
+#endif // PLANNING_ANYTIME_A_STAR_H
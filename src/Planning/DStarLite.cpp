@@ -0,0 +1,250 @@
+#include "DStarLite.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// the open list is a binary heap sorted on key, smallest on top
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return b.key < a.key;
+  }
+};
+
+const int DIRECTIONS[8][2] = {{1, 0},  {-1, 0}, {0, 1},  {0, -1},
+                              {1, 1},  {1, -1}, {-1, 1}, {-1, -1}};
+} // namespace
+
+std::vector<glm::vec2>
+DStarLite::search(const OccupancyGrid &grid, glm::vec2 start, glm::vec2 end,
+                  const std::vector<int> &changedCells) {
+  this->grid = &grid;
+  expandedNodes = 0;
+
+  // update2() asks for the cell just past the far edge of the grid, so keep
+  // the goal on the map
+  int newStart = std::clamp((int)start.x, 0, MAP_WIDTH - 1) * MAP_HEIGHT +
+                 std::clamp((int)start.y, 0, MAP_HEIGHT - 1);
+  int newGoal = std::clamp((int)end.x, 0, MAP_WIDTH - 1) * MAP_HEIGHT +
+                std::clamp((int)end.y, 0, MAP_HEIGHT - 1);
+
+  if (!initialised || newGoal != goalIndex) {
+    startIndex = newStart;
+    goalIndex = newGoal;
+    initialise();
+  } else {
+    if (newStart != startIndex) {
+      km += heuristic(startIndex, newStart);
+      startIndex = newStart;
+    }
+    // a changed cell alters the edges into and out of it as well as the
+    // diagonals that pass its corners, all of which start at it or one of its
+    // neighbours
+    for (int index : changedCells) {
+      int x = index / MAP_HEIGHT;
+      int y = index % MAP_HEIGHT;
+      if (index != goalIndex) {
+        rhs[index] = bestSuccessor(index);
+      }
+      updateVertex(index);
+      for (const auto &dir : DIRECTIONS) {
+        int nx = x + dir[0];
+        int ny = y + dir[1];
+        if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) {
+          continue;
+        }
+        int n = nx * MAP_HEIGHT + ny;
+        if (n != goalIndex) {
+          rhs[n] = bestSuccessor(n);
+        }
+        updateVertex(n);
+      }
+    }
+  }
+
+  computeShortestPath();
+  return buildPath();
+}
+
+void DStarLite::initialise() {
+  g.assign(MAP_WIDTH * MAP_HEIGHT, INFINITY);
+  rhs.assign(MAP_WIDTH * MAP_HEIGHT, INFINITY);
+  openKey.resize(MAP_WIDTH * MAP_HEIGHT);
+  inOpen.assign(MAP_WIDTH * MAP_HEIGHT, 0);
+  open.clear();
+  km = 0.0f;
+
+  rhs[goalIndex] = 0.0f;
+  insert(goalIndex, calculateKey(goalIndex));
+  initialised = true;
+}
+
+DStarLite::Key DStarLite::calculateKey(int index) const {
+  float best = std::min(g[index], rhs[index]);
+  return {best + heuristic(startIndex, index) + km, best};
+}
+
+float DStarLite::heuristic(int from, int to) const {
+  return OctileDistance(from / MAP_HEIGHT - to / MAP_HEIGHT,
+                        from % MAP_HEIGHT - to % MAP_HEIGHT);
+}
+
+float DStarLite::cost(int from, int to) const {
+  int x = from / MAP_HEIGHT;
+  int y = from % MAP_HEIGHT;
+  int toX = to / MAP_HEIGHT;
+  int toY = to % MAP_HEIGHT;
+  if (!IsPassable(*grid, x, y) || !IsPassable(*grid, toX, toY)) {
+    return INFINITY;
+  }
+  if (x != toX && y != toY) {
+    // no cutting corners
+    if (!IsPassable(*grid, toX, y) || !IsPassable(*grid, x, toY)) {
+      return INFINITY;
+    }
+    return 1.41421356f * TraversalCost(*grid, toX, toY);
+  }
+  return TraversalCost(*grid, toX, toY);
+}
+
+float DStarLite::bestSuccessor(int index) const {
+  int x = index / MAP_HEIGHT;
+  int y = index % MAP_HEIGHT;
+  float best = INFINITY;
+  for (const auto &dir : DIRECTIONS) {
+    int nx = x + dir[0];
+    int ny = y + dir[1];
+    if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) {
+      continue;
+    }
+    int n = nx * MAP_HEIGHT + ny;
+    best = std::min(best, cost(index, n) + g[n]);
+  }
+  return best;
+}
+
+void DStarLite::insert(int index, Key key) {
+  openKey[index] = key;
+  inOpen[index] = 1;
+  open.push_back({key, index});
+  std::push_heap(open.begin(), open.end(), OpenCompare());
+}
+
+void DStarLite::updateVertex(int index) {
+  if (g[index] != rhs[index]) {
+    insert(index, calculateKey(index)); // older entries go stale
+  } else {
+    inOpen[index] = 0;
+  }
+}
+
+// drops stale entries until the real top of the queue is found
+bool DStarLite::topEntry(OpenEntry &entry) {
+  while (!open.empty()) {
+    const OpenEntry &top = open.front();
+    if (inOpen[top.index] && !(top.key < openKey[top.index]) &&
+        !(openKey[top.index] < top.key)) {
+      entry = top;
+      return true;
+    }
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    open.pop_back();
+  }
+  return false;
+}
+
+void DStarLite::computeShortestPath() {
+  OpenEntry top;
+  while (topEntry(top) && (top.key < calculateKey(startIndex) ||
+                           rhs[startIndex] > g[startIndex])) {
+    int u = top.index;
+    Key newKey = calculateKey(u);
+    expandedNodes++;
+
+    if (top.key < newKey) {
+      insert(u, newKey);
+      continue;
+    }
+
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    open.pop_back();
+    inOpen[u] = 0;
+
+    int x = u / MAP_HEIGHT;
+    int y = u % MAP_HEIGHT;
+    if (g[u] > rhs[u]) {
+      g[u] = rhs[u];
+      for (const auto &dir : DIRECTIONS) {
+        int nx = x + dir[0];
+        int ny = y + dir[1];
+        if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) {
+          continue;
+        }
+        int s = nx * MAP_HEIGHT + ny;
+        if (s != goalIndex) {
+          rhs[s] = std::min(rhs[s], cost(s, u) + g[u]);
+        }
+        updateVertex(s);
+      }
+    } else {
+      float oldG = g[u];
+      g[u] = INFINITY;
+      if (u != goalIndex && rhs[u] == oldG) {
+        rhs[u] = bestSuccessor(u);
+      }
+      updateVertex(u);
+      for (const auto &dir : DIRECTIONS) {
+        int nx = x + dir[0];
+        int ny = y + dir[1];
+        if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) {
+          continue;
+        }
+        int s = nx * MAP_HEIGHT + ny;
+        if (s != goalIndex && rhs[s] == cost(s, u) + oldG) {
+          rhs[s] = bestSuccessor(s);
+        }
+        updateVertex(s);
+      }
+    }
+  }
+}
+
+// walks downhill on g from the start to the goal
+std::vector<glm::vec2> DStarLite::buildPath() const {
+  std::vector<glm::vec2> path;
+  if (std::isinf(rhs[startIndex])) {
+    return path;
+  }
+
+  int index = startIndex;
+  path.push_back(glm::vec2(index / MAP_HEIGHT, index % MAP_HEIGHT));
+  for (int steps = 0; index != goalIndex && steps < MAP_WIDTH * MAP_HEIGHT;
+       steps++) {
+    int x = index / MAP_HEIGHT;
+    int y = index % MAP_HEIGHT;
+    int next = -1;
+    float best = INFINITY;
+    for (const auto &dir : DIRECTIONS) {
+      int nx = x + dir[0];
+      int ny = y + dir[1];
+      if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) {
+        continue;
+      }
+      int n = nx * MAP_HEIGHT + ny;
+      float value = cost(index, n) + g[n];
+      if (value < best) {
+        best = value;
+        next = n;
+      }
+    }
+    if (next < 0) {
+      return {};
+    }
+    index = next;
+    path.push_back(glm::vec2(index / MAP_HEIGHT, index % MAP_HEIGHT));
+  }
+
+  if (index != goalIndex) {
+    return {};
+  }
+  return path;
+}
@@ -0,0 +1,73 @@
+#ifndef PLANNING_D_STAR_LITE_H
+#define PLANNING_D_STAR_LITE_H
+
+#pragma once
+
+#include "OccupancyGrid.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// Incremental planner (D* Lite, Koenig & Likhachev 2002). The search runs
+// backwards from the goal and keeps its g/rhs values alive between calls, so
+// a new frame only has to repair the part of the search that the changed
+// cells actually touch instead of planning from scratch.
+//
+// Costs and connectivity match JumpPointSearch with costAware set: stepping
+// into a cell costs its TraversalCost() times the step length and diagonal
+// moves can not cut the corner of a wall.
+class DStarLite {
+public:
+  // plans from start to end on grid. changedCells holds the index
+  // (x * MAP_HEIGHT + y) of every cell that differs from the grid passed to
+  // the previous call, see DiffGrid(). The search is restarted from scratch
+  // on the first call or when the goal moves.
+  std::vector<glm::vec2> search(const OccupancyGrid &grid, glm::vec2 start,
+                                glm::vec2 end,
+                                const std::vector<int> &changedCells);
+
+  // throws away the search state, the next call plans from scratch
+  void reset() { initialised = false; }
+
+  // number of cells expanded by the last call
+  uint32_t getExpandedNodes() const { return expandedNodes; }
+
+private:
+  struct Key {
+    float k1;
+    float k2;
+    bool operator<(const Key &rhs) const {
+      return k1 < rhs.k1 || (k1 == rhs.k1 && k2 < rhs.k2);
+    }
+  };
+  struct OpenEntry {
+    Key key;
+    int index;
+  };
+
+  const OccupancyGrid *grid = nullptr;
+  bool initialised = false;
+  int startIndex = -1;
+  int goalIndex = -1;
+  float km = 0.0f; // heuristic offset for when the start moves
+  uint32_t expandedNodes = 0;
+
+  std::vector<float> g;
+  std::vector<float> rhs;
+  std::vector<Key> openKey; // key the cell is queued with
+  std::vector<uint8_t> inOpen;
+  std::vector<OpenEntry> open; // lazy heap, entries not matching openKey are stale
+
+  void initialise();
+  Key calculateKey(int index) const;
+  float heuristic(int from, int to) const;
+  float cost(int from, int to) const;
+  float bestSuccessor(int index) const;
+  void updateVertex(int index);
+  void insert(int index, Key key);
+  bool topEntry(OpenEntry &entry);
+  void computeShortestPath();
+  std::vector<glm::vec2> buildPath() const;
+};
+
+#endif // PLANNING_D_STAR_LITE_H
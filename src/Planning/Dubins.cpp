@@ -0,0 +1,164 @@
+#include "Dubins.h"
+#include <cmath>
+
+// follows Shkel & Lumelsky, "Classification of the Dubins set" (2001): the
+// problem is moved so the start sits at the origin and the goal on the x
+// axis, d apart in units of the turning radius
+
+namespace {
+const float TWO_PI = 6.28318530718f;
+
+inline float mod2pi(float angle) {
+  float result = std::fmod(angle, TWO_PI);
+  return result < 0.0f ? result + TWO_PI : result;
+}
+
+enum Segment { LEFT, STRAIGHT, RIGHT };
+
+const Segment WORDS[6][3] = {
+    {LEFT, STRAIGHT, LEFT},  {LEFT, STRAIGHT, RIGHT}, {RIGHT, STRAIGHT, LEFT},
+    {RIGHT, STRAIGHT, RIGHT}, {RIGHT, LEFT, RIGHT},   {LEFT, RIGHT, LEFT}};
+
+// drives one segment of length t (in radii) from a pose on the unit circle
+inline glm::vec3 drive(const glm::vec3 &pose, float t, Segment segment) {
+  float s = std::sin(pose.z);
+  float c = std::cos(pose.z);
+  switch (segment) {
+  case LEFT:
+    return glm::vec3(pose.x + std::sin(pose.z + t) - s,
+                     pose.y - std::cos(pose.z + t) + c, pose.z + t);
+  case RIGHT:
+    return glm::vec3(pose.x - std::sin(pose.z - t) + s,
+                     pose.y + std::cos(pose.z - t) - c, pose.z - t);
+  case STRAIGHT:
+  default:
+    return glm::vec3(pose.x + c * t, pose.y + s * t, pose.z);
+  }
+}
+
+// segment lengths for one word, false if the word has no solution
+bool solve(DubinsPath::Type type, float alpha, float beta, float d,
+           float out[3]) {
+  float sa = std::sin(alpha);
+  float sb = std::sin(beta);
+  float ca = std::cos(alpha);
+  float cb = std::cos(beta);
+  float cab = std::cos(alpha - beta);
+  float dSq = d * d;
+
+  switch (type) {
+  case DubinsPath::LSL: {
+    float pSq = 2.0f + dSq - 2.0f * cab + 2.0f * d * (sa - sb);
+    if (pSq < 0.0f) {
+      return false;
+    }
+    float tmp = std::atan2(cb - ca, d + sa - sb);
+    out[0] = mod2pi(tmp - alpha);
+    out[1] = std::sqrt(pSq);
+    out[2] = mod2pi(beta - tmp);
+    return true;
+  }
+  case DubinsPath::RSR: {
+    float pSq = 2.0f + dSq - 2.0f * cab + 2.0f * d * (sb - sa);
+    if (pSq < 0.0f) {
+      return false;
+    }
+    float tmp = std::atan2(ca - cb, d - sa + sb);
+    out[0] = mod2pi(alpha - tmp);
+    out[1] = std::sqrt(pSq);
+    out[2] = mod2pi(tmp - beta);
+    return true;
+  }
+  case DubinsPath::LSR: {
+    float pSq = -2.0f + dSq + 2.0f * cab + 2.0f * d * (sa + sb);
+    if (pSq < 0.0f) {
+      return false;
+    }
+    float p = std::sqrt(pSq);
+    float tmp = std::atan2(-ca - cb, d + sa + sb) - std::atan2(-2.0f, p);
+    out[0] = mod2pi(tmp - alpha);
+    out[1] = p;
+    out[2] = mod2pi(tmp - beta);
+    return true;
+  }
+  case DubinsPath::RSL: {
+    float pSq = -2.0f + dSq + 2.0f * cab - 2.0f * d * (sa + sb);
+    if (pSq < 0.0f) {
+      return false;
+    }
+    float p = std::sqrt(pSq);
+    float tmp = std::atan2(ca + cb, d - sa - sb) - std::atan2(2.0f, p);
+    out[0] = mod2pi(alpha - tmp);
+    out[1] = p;
+    out[2] = mod2pi(beta - tmp);
+    return true;
+  }
+  case DubinsPath::RLR: {
+    float tmp = (6.0f - dSq + 2.0f * cab + 2.0f * d * (sa - sb)) / 8.0f;
+    if (std::abs(tmp) > 1.0f) {
+      return false;
+    }
+    float phi = std::atan2(ca - cb, d - sa + sb);
+    float p = mod2pi(TWO_PI - std::acos(tmp));
+    out[0] = mod2pi(alpha - phi + mod2pi(p / 2.0f));
+    out[1] = p;
+    out[2] = mod2pi(alpha - beta - out[0] + p);
+    return true;
+  }
+  case DubinsPath::LRL: {
+    float tmp = (6.0f - dSq + 2.0f * cab + 2.0f * d * (sb - sa)) / 8.0f;
+    if (std::abs(tmp) > 1.0f) {
+      return false;
+    }
+    float phi = std::atan2(ca - cb, d + sa - sb);
+    float p = mod2pi(TWO_PI - std::acos(tmp));
+    out[0] = mod2pi(-alpha - phi + p / 2.0f);
+    out[1] = p;
+    out[2] = mod2pi(beta - alpha - out[0] + p);
+    return true;
+  }
+  }
+  return false;
+}
+} // namespace
+
+bool ShortestDubinsPath(const glm::vec3 &from, const glm::vec3 &to,
+                        float radius, DubinsPath &path) {
+  float dx = to.x - from.x;
+  float dy = to.y - from.y;
+  float d = std::sqrt(dx * dx + dy * dy) / radius;
+  float theta = d > 0.0f ? mod2pi(std::atan2(dy, dx)) : 0.0f;
+  float alpha = mod2pi(from.z - theta);
+  float beta = mod2pi(to.z - theta);
+
+  float best = INFINITY;
+  for (int type = DubinsPath::LSL; type <= DubinsPath::LRL; type++) {
+    float segments[3];
+    if (!solve((DubinsPath::Type)type, alpha, beta, d, segments)) {
+      continue;
+    }
+    float length = segments[0] + segments[1] + segments[2];
+    if (length < best) {
+      best = length;
+      path.type = (DubinsPath::Type)type;
+      path.segments[0] = segments[0];
+      path.segments[1] = segments[1];
+      path.segments[2] = segments[2];
+    }
+  }
+  path.start = from;
+  path.radius = radius;
+  return best < INFINITY;
+}
+
+glm::vec3 DubinsPath::sample(float distance) const {
+  float t = distance / radius;
+  glm::vec3 pose(0.0f, 0.0f, start.z);
+  for (int i = 0; i < 3; i++) {
+    float part = std::fmin(std::fmax(t, 0.0f), segments[i]);
+    pose = drive(pose, part, WORDS[type][i]);
+    t -= part;
+  }
+  return glm::vec3(pose.x * radius + start.x, pose.y * radius + start.y,
+                   pose.z);
+}
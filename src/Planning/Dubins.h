@@ -0,0 +1,33 @@
+#ifndef PLANNING_DUBINS_H
+#define PLANNING_DUBINS_H
+
+#pragma once
+
+#include <glm/ext/vector_float3.hpp>
+
+// Shortest path between two poses for a car that only drives forwards and
+// turns no tighter than a fixed radius (Dubins 1957). Always three segments,
+// each a full-lock left or right arc or a straight line. Poses are
+// (x, y, heading) with the heading in radians from the x axis.
+struct DubinsPath {
+  enum Type { LSL, LSR, RSL, RSR, RLR, LRL };
+
+  glm::vec3 start;
+  float radius;
+  float segments[3]; // lengths, in units of radius
+  Type type;
+
+  inline float length() const {
+    return (segments[0] + segments[1] + segments[2]) * radius;
+  }
+
+  // pose after driving distance along the path
+  glm::vec3 sample(float distance) const;
+};
+
+// finds the shortest of the six Dubins words, false if none exist (only
+// happens for degenerate input)
+bool ShortestDubinsPath(const glm::vec3 &from, const glm::vec3 &to,
+                        float radius, DubinsPath &path);
+
+#endif // PLANNING_DUBINS_H
@@ -0,0 +1,75 @@
+#include "HeuristicField.h"
+#include <algorithm>
+
+namespace {
+// the open list is a binary heap sorted on f, smallest on top
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return a.f > b.f;
+  }
+};
+
+const int DIRECTIONS[8][2] = {{1, 0},  {-1, 0}, {0, 1},  {0, -1},
+                              {1, 1},  {1, -1}, {-1, 1}, {-1, -1}};
+} // namespace
+
+bool HeuristicField::update(const OccupancyGrid &grid, uint32_t version,
+                            glm::vec2 goal, Direction direction) {
+  int goalX = std::clamp((int)goal.x, 0, MAP_WIDTH - 1);
+  int goalY = std::clamp((int)goal.y, 0, MAP_HEIGHT - 1);
+  int newGoal = goalX * MAP_HEIGHT + goalY;
+  if (valid && version == builtVersion && newGoal == goalIndex &&
+      direction == builtDirection) {
+    return false;
+  }
+  valid = true;
+  builtVersion = version;
+  goalIndex = newGoal;
+  builtDirection = direction;
+
+  cost.assign(MAP_WIDTH * MAP_HEIGHT, INFINITY);
+  open.clear();
+  if (!IsPassable(grid, goalX, goalY)) {
+    return true;
+  }
+
+  cost[goalIndex] = 0.0f;
+  open.push_back({0.0f, goalIndex});
+
+  // towards the goal the search runs backwards, so stepping from a neighbour
+  // into the cell being expanded is priced by that cell. Out from the goal it
+  // is priced by the neighbour
+  while (!open.empty()) {
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    OpenEntry top = open.back();
+    open.pop_back();
+    if (top.f > cost[top.index]) {
+      continue;
+    }
+
+    int x = top.index / MAP_HEIGHT;
+    int y = top.index % MAP_HEIGHT;
+    float here = TraversalCost(grid, x, y);
+    for (const auto &dir : DIRECTIONS) {
+      int nx = x + dir[0];
+      int ny = y + dir[1];
+      if (!IsPassable(grid, nx, ny)) {
+        continue;
+      }
+      bool diagonal = dir[0] != 0 && dir[1] != 0;
+      if (diagonal &&
+          (!IsPassable(grid, nx, y) || !IsPassable(grid, x, ny))) {
+        continue; // no cutting corners
+      }
+      float enter = direction == TO_GOAL ? here : TraversalCost(grid, nx, ny);
+      float newCost = top.f + (diagonal ? 1.41421356f : 1.0f) * enter;
+      int n = nx * MAP_HEIGHT + ny;
+      if (newCost < cost[n]) {
+        cost[n] = newCost;
+        open.push_back({newCost, n});
+        std::push_heap(open.begin(), open.end(), OpenCompare());
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,51 @@
+#ifndef PLANNING_HEURISTIC_FIELD_H
+#define PLANNING_HEURISTIC_FIELD_H
+
+#pragma once
+
+#include "OccupancyGrid.h"
+#include <cmath>
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// Cost-to-goal of every cell on the grid, found with one Dijkstra pass out
+// from the goal over the same 8-connected costs the grid planners use. It
+// sees walls, unlike a straight line estimate, so the continuous planners
+// stop wandering into dead ends. Only rebuilt when the costmap or the goal
+// change.
+//
+// Built FROM_GOAL it holds the cost of getting out from the goal to each cell
+// instead, which is what a search running backwards towards it needs.
+class HeuristicField {
+public:
+  enum Direction { TO_GOAL, FROM_GOAL };
+
+  // rebuilds the field unless it was already built for this costmap version,
+  // goal and direction. Returns true if it did any work.
+  bool update(const OccupancyGrid &grid, uint32_t version, glm::vec2 goal,
+              Direction direction = TO_GOAL);
+
+  // cost between (x, y) and the goal, INFINITY if there is no way through
+  inline float get(int x, int y) const {
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
+      return INFINITY;
+    }
+    return cost[x * MAP_HEIGHT + y];
+  }
+
+private:
+  struct OpenEntry {
+    float f;
+    int index;
+  };
+
+  bool valid = false;
+  uint32_t builtVersion = 0;
+  int goalIndex = -1;
+  Direction builtDirection = TO_GOAL;
+  std::vector<float> cost;
+  std::vector<OpenEntry> open;
+};
+
+#endif // PLANNING_HEURISTIC_FIELD_H
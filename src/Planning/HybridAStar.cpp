@@ -0,0 +1,247 @@
+#include "HybridAStar.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/trigonometric.hpp>
+
+namespace {
+// the open list is a binary heap sorted on f, smallest on top
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return a.f > b.f;
+  }
+};
+
+const float TWO_PI = 6.28318530718f;
+const float HEADING_STEP = TWO_PI / HybridAStar::HEADINGS;
+} // namespace
+
+HybridAStar::HybridAStar(const Car &car, float cellsPerMeter) {
+  float maxSteer = glm::radians(Car::maxSteeringDegrees);
+  steeringAngles[0] = -maxSteer;
+  steeringAngles[1] = -maxSteer * 0.5f;
+  steeringAngles[2] = 0.0f;
+  steeringAngles[3] = maxSteer * 0.5f;
+  steeringAngles[4] = maxSteer;
+  wheelbase = car.wheelbase * cellsPerMeter;
+  turnRadius = wheelbase / std::tan(maxSteer);
+  stepLength = std::max(1.5f, 1.05f * turnRadius * HEADING_STEP);
+
+  float bodyWidth = car.carWidth * cellsPerMeter;
+  for (int h = 0; h < HEADINGS; h++) {
+    float c = std::cos(h * HEADING_STEP);
+    float s = std::sin(h * HEADING_STEP);
+    std::vector<std::pair<int, int>> cells;
+    for (float along = 0.0f; along <= wheelbase; along += 0.5f) {
+      for (float across = -bodyWidth * 0.5f; across <= bodyWidth * 0.5f;
+           across += 0.5f) {
+        cells.push_back({(int)std::round(along * c - across * s),
+                         (int)std::round(along * s + across * c)});
+      }
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    for (const auto &[x, y] : cells) {
+      footprints[h].push_back((int16_t)x);
+      footprints[h].push_back((int16_t)y);
+    }
+  }
+}
+
+int HybridAStar::headingBin(float heading) const {
+  int bin = (int)std::round(heading / HEADING_STEP) % HEADINGS;
+  return bin < 0 ? bin + HEADINGS : bin;
+}
+
+// the rear axle has to be on the map, but the rest of the car may hang over
+// the edge into cells the LIDAR has not seen yet
+bool HybridAStar::collides(const OccupancyGrid &grid,
+                           const glm::vec3 &pose) const {
+  int x = (int)std::round(pose.x);
+  int y = (int)std::round(pose.y);
+  if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
+    return true;
+  }
+  const std::vector<int16_t> &mask = footprints[headingBin(pose.z)];
+  for (size_t i = 0; i < mask.size(); i += 2) {
+    int cx = x + mask[i];
+    int cy = y + mask[i + 1];
+    if (cx >= 0 && cx < MAP_WIDTH && cy >= 0 && cy < MAP_HEIGHT &&
+        grid[cx][cy] >= BLOCKED_CELL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// kinematic bicycle, integrated in steps of at most one cell
+bool HybridAStar::drive(const OccupancyGrid &grid, glm::vec3 &pose, int steer,
+                        float &cost, std::vector<glm::vec2> *cells) const {
+  int substeps = (int)std::ceil(stepLength);
+  float ds = stepLength / substeps;
+  float yawRate = std::tan(steeringAngles[steer]) / wheelbase;
+  float penalty =
+      1.0f + steerPenalty * std::abs(steeringAngles[steer] / steeringAngles[4]);
+
+  for (int i = 0; i < substeps; i++) {
+    pose.x += ds * std::cos(pose.z);
+    pose.y += ds * std::sin(pose.z);
+    pose.z += ds * yawRate;
+    if (collides(grid, pose)) {
+      return false;
+    }
+    int x = (int)std::round(pose.x);
+    int y = (int)std::round(pose.y);
+    cost += ds * penalty * TraversalCost(grid, x, y);
+    if (cells && (cells->empty() || cells->back() != glm::vec2(x, y))) {
+      cells->push_back(glm::vec2(x, y));
+    }
+  }
+  return true;
+}
+
+bool HybridAStar::analyticShot(const OccupancyGrid &grid,
+                               const glm::vec3 &from, const glm::vec3 &goal,
+                               DubinsPath &path) const {
+  if (!ShortestDubinsPath(from, goal, turnRadius, path)) {
+    return false;
+  }
+  float length = path.length();
+  for (float s = 1.0f; s < length; s += 1.0f) {
+    if (collides(grid, path.sample(s))) {
+      return false;
+    }
+  }
+  return !collides(grid, goal);
+}
+
+std::vector<glm::vec2> HybridAStar::search(const OccupancyGrid &grid,
+                                           const HeuristicField &field,
+                                           glm::vec2 start, float heading,
+                                           glm::vec2 end, float endHeading,
+                                           PlanBudget budget) {
+  budget.begin();
+  expandedNodes = 0;
+  timedOut = false;
+
+  const int bins = MAP_WIDTH * MAP_HEIGHT * HEADINGS;
+  if (stamp.empty()) {
+    stamp.resize(bins, 0);
+    binNode.resize(bins);
+  }
+  if (++generation == 0) {
+    std::fill(stamp.begin(), stamp.end(), 0);
+    generation = 1;
+  }
+
+  // update2() asks for the cell just past the far edge of the grid, so keep
+  // the goal on the map
+  glm::vec3 goal(std::clamp(end.x, 0.0f, MAP_WIDTH - 1.0f),
+                 std::clamp(end.y, 0.0f, MAP_HEIGHT - 1.0f), endHeading);
+
+  nodes.clear();
+  open.clear();
+  glm::vec3 startPose(start.x, start.y, heading);
+  float startH = field.get((int)std::round(start.x), (int)std::round(start.y));
+  if (std::isinf(startH)) {
+    return {};
+  }
+  nodes.push_back({startPose, 0.0f, -1, 2, false});
+  open.push_back({startH, 0.0f, 0});
+
+  while (!open.empty()) {
+    if (budget.exhausted()) {
+      timedOut = true;
+      return {};
+    }
+
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    OpenEntry top = open.back();
+    open.pop_back();
+    Node &current = nodes[top.node];
+    if (current.closed || top.g != current.g) {
+      continue; // replaced by a cheaper pose in the same bin
+    }
+    current.closed = true;
+    expandedNodes++;
+
+    glm::vec3 pose = current.pose;
+    float g = current.g;
+    if (glm::length(glm::vec2(pose.x, pose.y) - glm::vec2(goal.x, goal.y)) <=
+        goalTolerance) {
+      return buildPath(grid, top.node, nullptr);
+    }
+    if (expandedNodes % analyticInterval == 1) {
+      DubinsPath shot;
+      if (analyticShot(grid, pose, goal, shot)) {
+        return buildPath(grid, top.node, &shot);
+      }
+    }
+
+    for (int steer = 0; steer < STEERS; steer++) {
+      glm::vec3 next = pose;
+      float cost = 0.0f;
+      if (!drive(grid, next, steer, cost, nullptr)) {
+        continue;
+      }
+      int x = (int)std::round(next.x);
+      int y = (int)std::round(next.y);
+      float h = field.get(x, y);
+      if (std::isinf(h)) {
+        continue;
+      }
+
+      int bin = (x * MAP_HEIGHT + y) * HEADINGS + headingBin(next.z);
+      float newG = g + cost;
+      int index;
+      if (stamp[bin] != generation) {
+        stamp[bin] = generation;
+        index = (int)nodes.size();
+        binNode[bin] = index;
+        nodes.push_back({next, newG, top.node, (int8_t)steer, false});
+      } else {
+        index = binNode[bin];
+        Node &existing = nodes[index];
+        if (existing.closed || existing.g <= newG) {
+          continue;
+        }
+        existing = {next, newG, top.node, (int8_t)steer, false};
+      }
+      open.push_back({newG + h, newG, index});
+      std::push_heap(open.begin(), open.end(), OpenCompare());
+    }
+  }
+
+  return {};
+}
+
+std::vector<glm::vec2> HybridAStar::buildPath(const OccupancyGrid &grid,
+                                              int node,
+                                              const DubinsPath *shot) const {
+  std::vector<int> chain;
+  for (int i = node; i >= 0; i = nodes[i].parent) {
+    chain.push_back(i);
+  }
+  std::reverse(chain.begin(), chain.end());
+
+  // replay the steering that led to each node to get the cells in between
+  std::vector<glm::vec2> path;
+  const glm::vec3 &first = nodes[chain[0]].pose;
+  path.push_back(glm::vec2(std::round(first.x), std::round(first.y)));
+  for (size_t i = 1; i < chain.size(); i++) {
+    glm::vec3 pose = nodes[chain[i - 1]].pose;
+    float cost = 0.0f;
+    drive(grid, pose, nodes[chain[i]].steer, cost, &path);
+  }
+
+  if (shot) {
+    float length = shot->length();
+    for (float s = 1.0f; s <= length + 0.5f; s += 1.0f) {
+      glm::vec3 pose = shot->sample(std::min(s, length));
+      glm::vec2 cell(std::round(pose.x), std::round(pose.y));
+      if (path.back() != cell) {
+        path.push_back(cell);
+      }
+    }
+  }
+  return path;
+}
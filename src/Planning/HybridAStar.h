@@ -0,0 +1,89 @@
+#ifndef PLANNING_HYBRID_A_STAR_H
+#define PLANNING_HYBRID_A_STAR_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "Dubins.h"
+#include "HeuristicField.h"
+#include "OccupancyGrid.h"
+#include "PlanBudget.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <vector>
+
+// Hybrid-A* (Dolgov et al. 2008) for the tight sections where a cell path is
+// not something the car can follow. States are continuous (x, y, heading)
+// poses binned into a cell and heading bin, successors come from driving a
+// kinematic bicycle with the Car's wheelbase and steering limits a short
+// distance, and every few expansions a Dubins curve is tried straight to the
+// goal. The heuristic is a HeuristicField, which the caller keeps up to date
+// with the costmap so it is only rebuilt once per costmap.
+class HybridAStar {
+public:
+  static const int HEADINGS = 36;
+
+  explicit HybridAStar(const Car &car, float cellsPerMeter = CELLS_PER_METER);
+
+  // drop in for astar(): returns the cells from start to end, or an empty
+  // path if end can't be reached or the budget runs out first. Headings
+  // are radians from the grid's x axis, field must be built for end.
+  std::vector<glm::vec2> search(const OccupancyGrid &grid,
+                                const HeuristicField &field, glm::vec2 start,
+                                float heading, glm::vec2 end, float endHeading,
+                                PlanBudget budget);
+
+  uint32_t getExpandedNodes() const { return expandedNodes; }
+  bool getTimedOut() const { return timedOut; }
+
+  // cells driven per expansion, defaults to just enough for full lock to
+  // reach the next heading bin so turning successors don't collapse into
+  // the straight one
+  float stepLength;
+  float goalTolerance = 3.0f; // cells
+  uint32_t analyticInterval = 8; // expansions between Dubins shots
+  float steerPenalty = 0.05f;    // per cell driven at full lock
+
+private:
+  struct Node {
+    glm::vec3 pose;
+    float g;
+    int parent;
+    int8_t steer; // index into steeringAngles that led here
+    bool closed;
+  };
+  struct OpenEntry {
+    float f;
+    float g;
+    int node;
+  };
+
+  static const int STEERS = 5;
+  float steeringAngles[STEERS];
+  float wheelbase;   // cells
+  float turnRadius;  // cells, at full lock
+  uint32_t expandedNodes = 0;
+  bool timedOut = false;
+
+  // cells covered by the footprint when the rear axle sits on (0, 0), one
+  // mask per heading bin
+  std::vector<int16_t> footprints[HEADINGS];
+
+  std::vector<Node> nodes;
+  std::vector<OpenEntry> open;
+  uint32_t generation = 0;
+  std::vector<uint32_t> stamp;
+  std::vector<int> binNode; // node occupying each (cell, heading) bin
+
+  int headingBin(float heading) const;
+  bool collides(const OccupancyGrid &grid, const glm::vec3 &pose) const;
+  bool drive(const OccupancyGrid &grid, glm::vec3 &pose, int steer,
+             float &cost, std::vector<glm::vec2> *cells) const;
+  bool analyticShot(const OccupancyGrid &grid, const glm::vec3 &from,
+                    const glm::vec3 &goal, DubinsPath &path) const;
+  std::vector<glm::vec2> buildPath(const OccupancyGrid &grid, int node,
+                                   const DubinsPath *shot) const;
+};
+
+#endif // PLANNING_HYBRID_A_STAR_H
@@ -0,0 +1,311 @@
+#include "JumpPointSearch.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+inline int sign(int v) { return (0 < v) - (v < 0); }
+
+// the open list is a binary heap sorted on f, smallest on top
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return a.f > b.f;
+  }
+};
+
+const int DIRECTIONS[8][2] = {{1, 0},  {-1, 0}, {0, 1},  {0, -1},
+                              {1, 1},  {1, -1}, {-1, 1}, {-1, -1}};
+} // namespace
+
+JumpPointSearch::JumpPointSearch(bool costAware) : costAware(costAware) {}
+
+std::vector<glm::vec2> JumpPointSearch::search(const OccupancyGrid &grid,
+                                               glm::vec2 start,
+                                               glm::vec2 end) {
+  this->grid = &grid;
+  expandedNodes = 0;
+
+  // update2() asks for the cell just past the far edge of the grid, so keep
+  // the goal on the map
+  int startX = std::clamp((int)start.x, 0, MAP_WIDTH - 1);
+  int startY = std::clamp((int)start.y, 0, MAP_HEIGHT - 1);
+  goalX = std::clamp((int)end.x, 0, MAP_WIDTH - 1);
+  goalY = std::clamp((int)end.y, 0, MAP_HEIGHT - 1);
+
+  if (!passable(startX, startY) || !passable(goalX, goalY)) {
+    return {};
+  }
+
+  if (stamp.empty()) {
+    stamp.resize(MAP_WIDTH * MAP_HEIGHT, 0);
+    g.resize(MAP_WIDTH * MAP_HEIGHT);
+    parent.resize(MAP_WIDTH * MAP_HEIGHT);
+    closed.resize(MAP_WIDTH * MAP_HEIGHT);
+    boundary.resize(MAP_WIDTH * MAP_HEIGHT);
+  }
+  if (++generation == 0) {
+    std::fill(stamp.begin(), stamp.end(), 0);
+    generation = 1;
+  }
+  if (costAware) {
+    markBoundaries();
+  }
+
+  int startIndex = startX * MAP_HEIGHT + startY;
+  stamp[startIndex] = generation;
+  g[startIndex] = 0.0f;
+  parent[startIndex] = -1;
+  closed[startIndex] = 0;
+
+  open.clear();
+  open.push_back({OctileDistance(goalX - startX, goalY - startY), startIndex});
+
+  while (!open.empty()) {
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    int index = open.back().index;
+    open.pop_back();
+
+    if (closed[index]) {
+      continue; // stale entry, the cell was reached more cheaply already
+    }
+    closed[index] = 1;
+    expandedNodes++;
+
+    int x = index / MAP_HEIGHT;
+    int y = index % MAP_HEIGHT;
+    if (x == goalX && y == goalY) {
+      return buildPath(index);
+    }
+
+    // the start and any cell on a cost boundary look in every direction,
+    // everything else only follows its natural and forced neighbours
+    if (parent[index] < 0 || isBoundary(x, y)) {
+      for (const auto &dir : DIRECTIONS) {
+        int j = jump(x, y, dir[0], dir[1]);
+        if (j >= 0) {
+          push(j / MAP_HEIGHT, j % MAP_HEIGHT, index);
+        }
+      }
+      continue;
+    }
+
+    int dx = sign(x - parent[index] / MAP_HEIGHT);
+    int dy = sign(y - parent[index] % MAP_HEIGHT);
+    int dirs[5][2];
+    int dirCount = 0;
+
+    if (dx != 0 && dy != 0) {
+      bool vertical = passable(x, y + dy);
+      bool horizontal = passable(x + dx, y);
+      if (vertical) {
+        dirs[dirCount][0] = 0;
+        dirs[dirCount++][1] = dy;
+      }
+      if (horizontal) {
+        dirs[dirCount][0] = dx;
+        dirs[dirCount++][1] = 0;
+      }
+      if (vertical && horizontal) {
+        dirs[dirCount][0] = dx;
+        dirs[dirCount++][1] = dy;
+      }
+    } else if (dx != 0) {
+      bool next = passable(x + dx, y);
+      bool up = passable(x, y + 1);
+      bool down = passable(x, y - 1);
+      if (next) {
+        dirs[dirCount][0] = dx;
+        dirs[dirCount++][1] = 0;
+        if (up) {
+          dirs[dirCount][0] = dx;
+          dirs[dirCount++][1] = 1;
+        }
+        if (down) {
+          dirs[dirCount][0] = dx;
+          dirs[dirCount++][1] = -1;
+        }
+      }
+      if (up) {
+        dirs[dirCount][0] = 0;
+        dirs[dirCount++][1] = 1;
+      }
+      if (down) {
+        dirs[dirCount][0] = 0;
+        dirs[dirCount++][1] = -1;
+      }
+    } else {
+      bool next = passable(x, y + dy);
+      bool right = passable(x + 1, y);
+      bool left = passable(x - 1, y);
+      if (next) {
+        dirs[dirCount][0] = 0;
+        dirs[dirCount++][1] = dy;
+        if (right) {
+          dirs[dirCount][0] = 1;
+          dirs[dirCount++][1] = dy;
+        }
+        if (left) {
+          dirs[dirCount][0] = -1;
+          dirs[dirCount++][1] = dy;
+        }
+      }
+      if (right) {
+        dirs[dirCount][0] = 1;
+        dirs[dirCount++][1] = 0;
+      }
+      if (left) {
+        dirs[dirCount][0] = -1;
+        dirs[dirCount++][1] = 0;
+      }
+    }
+
+    for (int i = 0; i < dirCount; i++) {
+      int j = jump(x, y, dirs[i][0], dirs[i][1]);
+      if (j >= 0) {
+        push(j / MAP_HEIGHT, j % MAP_HEIGHT, index);
+      }
+    }
+  }
+
+  return {};
+}
+
+// a cell is on a boundary when one of its neighbours is passable but costs
+// something different
+void JumpPointSearch::markBoundaries() {
+  for (int x = 0; x < MAP_WIDTH; x++) {
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+      int cost = (*grid)[x][y];
+      uint8_t edge = 0;
+      if (cost < BLOCKED_CELL) {
+        for (const auto &dir : DIRECTIONS) {
+          int n = GetMap(*grid, x + dir[0], y + dir[1]);
+          if (n < BLOCKED_CELL && n != cost) {
+            edge = 1;
+            break;
+          }
+        }
+      }
+      boundary[x * MAP_HEIGHT + y] = edge;
+    }
+  }
+}
+
+void JumpPointSearch::push(int x, int y, int fromIndex) {
+  int index = x * MAP_HEIGHT + y;
+  float newG = g[fromIndex] + segmentCost(fromIndex, index);
+
+  if (stamp[index] != generation) {
+    stamp[index] = generation;
+    closed[index] = 0;
+  } else if (closed[index] || g[index] <= newG) {
+    return;
+  }
+
+  g[index] = newG;
+  parent[index] = fromIndex;
+  open.push_back({newG + OctileDistance(goalX - x, goalY - y), index});
+  std::push_heap(open.begin(), open.end(), OpenCompare());
+}
+
+int JumpPointSearch::jump(int x, int y, int dx, int dy) const {
+  if (dx != 0 && dy != 0) {
+    return jumpDiagonal(x, y, dx, dy);
+  }
+  return jumpStraight(x, y, dx, dy);
+}
+
+int JumpPointSearch::jumpStraight(int x, int y, int dx, int dy) const {
+  for (;;) {
+    x += dx;
+    y += dy;
+    if (!passable(x, y)) {
+      return -1;
+    }
+    if ((x == goalX && y == goalY) || isBoundary(x, y)) {
+      return x * MAP_HEIGHT + y;
+    }
+    // forced neighbours: a wall beside the previous cell that ends here
+    if (dx != 0) {
+      if ((passable(x, y - 1) && !passable(x - dx, y - 1)) ||
+          (passable(x, y + 1) && !passable(x - dx, y + 1))) {
+        return x * MAP_HEIGHT + y;
+      }
+    } else {
+      if ((passable(x - 1, y) && !passable(x - 1, y - dy)) ||
+          (passable(x + 1, y) && !passable(x + 1, y - dy))) {
+        return x * MAP_HEIGHT + y;
+      }
+    }
+  }
+}
+
+int JumpPointSearch::jumpDiagonal(int x, int y, int dx, int dy) const {
+  for (;;) {
+    // no cutting corners
+    if (!passable(x + dx, y) || !passable(x, y + dy)) {
+      return -1;
+    }
+    x += dx;
+    y += dy;
+    if (!passable(x, y)) {
+      return -1;
+    }
+    if ((x == goalX && y == goalY) || isBoundary(x, y)) {
+      return x * MAP_HEIGHT + y;
+    }
+    if (jumpStraight(x, y, dx, 0) >= 0 || jumpStraight(x, y, 0, dy) >= 0) {
+      return x * MAP_HEIGHT + y;
+    }
+  }
+}
+
+// jump points are always joined by a straight or 45 degree line, walk it
+float JumpPointSearch::segmentCost(int fromIndex, int toIndex) const {
+  int x = fromIndex / MAP_HEIGHT;
+  int y = fromIndex % MAP_HEIGHT;
+  int toX = toIndex / MAP_HEIGHT;
+  int toY = toIndex % MAP_HEIGHT;
+  int dx = sign(toX - x);
+  int dy = sign(toY - y);
+
+  if (!costAware) {
+    return OctileDistance(toX - x, toY - y);
+  }
+
+  float step = (dx != 0 && dy != 0) ? 1.41421356f : 1.0f;
+  float cost = 0.0f;
+  while (x != toX || y != toY) {
+    x += dx;
+    y += dy;
+    cost += step * TraversalCost(*grid, x, y);
+  }
+  return cost;
+}
+
+std::vector<glm::vec2> JumpPointSearch::buildPath(int goalIndex) const {
+  std::vector<int> jumpPoints;
+  for (int index = goalIndex; index >= 0; index = parent[index]) {
+    jumpPoints.push_back(index);
+  }
+  std::reverse(jumpPoints.begin(), jumpPoints.end());
+
+  // fill in the cells between jump points so callers can index the path by
+  // cell like they do with astar()
+  std::vector<glm::vec2> path;
+  int x = jumpPoints[0] / MAP_HEIGHT;
+  int y = jumpPoints[0] % MAP_HEIGHT;
+  path.push_back(glm::vec2(x, y));
+  for (size_t i = 1; i < jumpPoints.size(); i++) {
+    int toX = jumpPoints[i] / MAP_HEIGHT;
+    int toY = jumpPoints[i] % MAP_HEIGHT;
+    int dx = sign(toX - x);
+    int dy = sign(toY - y);
+    while (x != toX || y != toY) {
+      x += dx;
+      y += dy;
+      path.push_back(glm::vec2(x, y));
+    }
+  }
+  return path;
+}
@@ -0,0 +1,72 @@
+#ifndef PLANNING_JUMP_POINT_SEARCH_H
+#define PLANNING_JUMP_POINT_SEARCH_H
+
+#pragma once
+
+#include "OccupancyGrid.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// Jump Point Search over the occupancy grid. Most of the costmap is free
+// space, where plain A* pushes a huge symmetric frontier; JPS only ever
+// expands the cells where the path could have to turn.
+//
+// With costAware set, cells next to a cell of a different (passable) cost are
+// treated as jump points too, so every straight jump stays inside a region of
+// uniform cost and the inflation bands are still priced in. Without it,
+// inflated cells are as cheap as free ones and only walls matter.
+//
+// Diagonal moves are not allowed to cut the corner of a wall.
+class JumpPointSearch {
+public:
+  explicit JumpPointSearch(bool costAware = false);
+
+  // returns every cell from start to end (inclusive) in the same format as
+  // astar(), or an empty path if end can not be reached
+  std::vector<glm::vec2> search(const OccupancyGrid &grid, glm::vec2 start,
+                                glm::vec2 end);
+
+  // number of jump points expanded by the last search
+  uint32_t getExpandedNodes() const { return expandedNodes; }
+
+  bool costAware;
+
+private:
+  struct OpenEntry {
+    float f;
+    int index;
+  };
+
+  const OccupancyGrid *grid = nullptr;
+  int goalX = 0;
+  int goalY = 0;
+  uint32_t expandedNodes = 0;
+
+  // per cell search state, reused between searches. A cell only holds valid
+  // data if its stamp matches the current generation
+  uint32_t generation = 0;
+  std::vector<uint32_t> stamp;
+  std::vector<float> g;
+  std::vector<int> parent;
+  std::vector<uint8_t> closed;
+  std::vector<uint8_t> boundary;
+  std::vector<OpenEntry> open;
+
+  inline bool passable(int x, int y) const {
+    return IsPassable(*grid, x, y);
+  }
+  inline bool isBoundary(int x, int y) const {
+    return costAware && boundary[x * MAP_HEIGHT + y];
+  }
+
+  void markBoundaries();
+  void push(int x, int y, int fromIndex);
+  int jumpStraight(int x, int y, int dx, int dy) const;
+  int jumpDiagonal(int x, int y, int dx, int dy) const;
+  int jump(int x, int y, int dx, int dy) const;
+  float segmentCost(int fromIndex, int toIndex) const;
+  std::vector<glm::vec2> buildPath(int goalIndex) const;
+};
+
+#endif // PLANNING_JUMP_POINT_SEARCH_H
@@ -0,0 +1,243 @@
+#include "LatticePlanner.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/trigonometric.hpp>
+
+namespace {
+// the open list is a binary heap sorted on f, smallest on top
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return a.f > b.f;
+  }
+};
+
+const float HEADING_STEP = 2.0f * (float)M_PI / LatticePlanner::HEADINGS;
+const float STRAIGHT_LENGTH = 10.0f; // cells
+
+inline int wrapHeading(int heading) {
+  return (heading % LatticePlanner::HEADINGS + LatticePlanner::HEADINGS) %
+         LatticePlanner::HEADINGS;
+}
+
+// pose after driving length cells along an arc of the given curvature
+inline glm::vec2 arcPoint(float heading, float curvature, float length) {
+  if (std::abs(curvature) < 1e-6f) {
+    return glm::vec2(length * std::cos(heading), length * std::sin(heading));
+  }
+  float end = heading + curvature * length;
+  return glm::vec2((std::sin(end) - std::sin(heading)) / curvature,
+                   (std::cos(heading) - std::cos(end)) / curvature);
+}
+} // namespace
+
+LatticePlanner::LatticePlanner(const Car &car, float cellsPerMeter) {
+  // tightest turn the steering clamp allows, in cells
+  float maxCurvature =
+      std::tan(glm::radians(Car::maxSteeringDegrees)) /
+      (car.wheelbase * cellsPerMeter);
+  float bodyLength = car.wheelbase * cellsPerMeter;
+  float bodyWidth = car.carWidth * cellsPerMeter;
+
+  for (int heading = 0; heading < HEADINGS; heading++) {
+    buildPrimitive(heading, 0.0f, STRAIGHT_LENGTH, bodyLength, bodyWidth);
+    for (float curvature : {maxCurvature, maxCurvature * 0.5f}) {
+      // just long enough to turn by one heading bin
+      float length = HEADING_STEP / curvature;
+      buildPrimitive(heading, curvature, length, bodyLength, bodyWidth);
+      buildPrimitive(heading, -curvature, length, bodyLength, bodyWidth);
+    }
+  }
+}
+
+void LatticePlanner::buildPrimitive(int heading, float curvature,
+                                    float length, float bodyLength,
+                                    float bodyWidth) {
+  Primitive primitive;
+  float startHeading = heading * HEADING_STEP;
+  glm::vec2 end = arcPoint(startHeading, curvature, length);
+  primitive.endX = (int)std::round(end.x);
+  primitive.endY = (int)std::round(end.y);
+  primitive.endHeading =
+      wrapHeading(heading + (int)std::round(curvature * length / HEADING_STEP));
+  primitive.cost =
+      length * (1.0f + (std::abs(curvature) > 0.0f ? turnPenalty : 0.0f));
+
+  // sample the centre line and the footprint every half cell
+  std::vector<std::pair<int, int>> swept;
+  int lastX = 0;
+  int lastY = 0;
+  int samples = (int)std::ceil(length * 2.0f);
+  for (int i = 0; i <= samples; i++) {
+    float s = length * i / samples;
+    glm::vec2 p = arcPoint(startHeading, curvature, s);
+    if (i == samples) {
+      p = glm::vec2(primitive.endX, primitive.endY);
+    }
+    float theta = startHeading + curvature * s;
+    float c = std::cos(theta);
+    float sn = std::sin(theta);
+
+    int cx = (int)std::round(p.x);
+    int cy = (int)std::round(p.y);
+    if (cx != lastX || cy != lastY) {
+      primitive.cells.push_back(glm::vec2(cx, cy));
+      lastX = cx;
+      lastY = cy;
+    }
+
+    for (float along = 0.0f; along <= bodyLength; along += 0.5f) {
+      for (float across = -bodyWidth * 0.5f; across <= bodyWidth * 0.5f;
+           across += 0.5f) {
+        swept.push_back({(int)std::round(p.x + along * c - across * sn),
+                         (int)std::round(p.y + along * sn + across * c)});
+      }
+    }
+  }
+
+  std::sort(swept.begin(), swept.end());
+  swept.erase(std::unique(swept.begin(), swept.end()), swept.end());
+  primitive.sweptCells.reserve(swept.size() * 2);
+  for (const auto &[x, y] : swept) {
+    primitive.sweptCells.push_back((int16_t)x);
+    primitive.sweptCells.push_back((int16_t)y);
+  }
+
+  primitives[heading].push_back(std::move(primitive));
+}
+
+// cells past the edge of the grid are simply not seen by the LIDAR yet, so
+// only cells on the map can block the car
+bool LatticePlanner::collides(const OccupancyGrid &grid, int x, int y,
+                              const Primitive &primitive) const {
+  const int16_t *cells = primitive.sweptCells.data();
+  for (size_t i = 0; i < primitive.sweptCells.size(); i += 2) {
+    int cx = x + cells[i];
+    int cy = y + cells[i + 1];
+    if (cx >= 0 && cx < MAP_WIDTH && cy >= 0 && cy < MAP_HEIGHT &&
+        grid[cx][cy] >= BLOCKED_CELL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+float LatticePlanner::primitiveCost(const OccupancyGrid &grid, int x, int y,
+                                    const Primitive &primitive) const {
+  float cost = primitive.cost;
+  for (const glm::vec2 &cell : primitive.cells) {
+    cost += TraversalCost(grid, x + (int)cell.x, y + (int)cell.y) - 1.0f;
+  }
+  return cost;
+}
+
+std::vector<glm::vec2> LatticePlanner::search(const OccupancyGrid &grid,
+                                              glm::vec2 start, float heading,
+                                              glm::vec2 end) {
+  expandedNodes = 0;
+
+  const int states = MAP_WIDTH * MAP_HEIGHT * HEADINGS;
+  if (stamp.empty()) {
+    stamp.resize(states, 0);
+    g.resize(states);
+    parent.resize(states);
+    parentPrimitive.resize(states);
+    closed.resize(states);
+  }
+  if (++generation == 0) {
+    std::fill(stamp.begin(), stamp.end(), 0);
+    generation = 1;
+  }
+
+  int startX = std::clamp((int)start.x, 0, MAP_WIDTH - 1);
+  int startY = std::clamp((int)start.y, 0, MAP_HEIGHT - 1);
+  int startHeading = wrapHeading((int)std::round(heading / HEADING_STEP));
+  int startState = (startX * MAP_HEIGHT + startY) * HEADINGS + startHeading;
+
+  auto estimate = [&](int x, int y) {
+    float distance = glm::length(glm::vec2(x, y) - end);
+    return std::max(distance - goalTolerance, 0.0f);
+  };
+
+  stamp[startState] = generation;
+  g[startState] = 0.0f;
+  parent[startState] = -1;
+  closed[startState] = 0;
+  open.clear();
+  open.push_back({estimate(startX, startY), startState});
+
+  while (!open.empty() && expandedNodes < maxExpansions) {
+    std::pop_heap(open.begin(), open.end(), OpenCompare());
+    int state = open.back().index;
+    open.pop_back();
+
+    if (closed[state]) {
+      continue;
+    }
+    closed[state] = 1;
+    expandedNodes++;
+
+    int cell = state / HEADINGS;
+    int h = state % HEADINGS;
+    int x = cell / MAP_HEIGHT;
+    int y = cell % MAP_HEIGHT;
+
+    if (glm::length(glm::vec2(x, y) - end) <= goalTolerance) {
+      return buildPath(state);
+    }
+
+    const std::vector<Primitive> &successors = primitives[h];
+    for (size_t i = 0; i < successors.size(); i++) {
+      const Primitive &primitive = successors[i];
+      int nx = x + primitive.endX;
+      int ny = y + primitive.endY;
+      if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) {
+        continue;
+      }
+      int next = (nx * MAP_HEIGHT + ny) * HEADINGS + primitive.endHeading;
+      if (stamp[next] == generation && closed[next]) {
+        continue;
+      }
+      if (collides(grid, x, y, primitive)) {
+        continue;
+      }
+
+      float newG = g[state] + primitiveCost(grid, x, y, primitive);
+      if (stamp[next] != generation) {
+        stamp[next] = generation;
+        closed[next] = 0;
+      } else if (g[next] <= newG) {
+        continue;
+      }
+      g[next] = newG;
+      parent[next] = state;
+      parentPrimitive[next] = (uint8_t)i;
+      open.push_back({newG + estimate(nx, ny), next});
+      std::push_heap(open.begin(), open.end(), OpenCompare());
+    }
+  }
+
+  return {};
+}
+
+std::vector<glm::vec2> LatticePlanner::buildPath(int goalState) const {
+  std::vector<int> states;
+  for (int state = goalState; state >= 0; state = parent[state]) {
+    states.push_back(state);
+  }
+  std::reverse(states.begin(), states.end());
+
+  std::vector<glm::vec2> path;
+  int first = states[0] / HEADINGS;
+  path.push_back(glm::vec2(first / MAP_HEIGHT, first % MAP_HEIGHT));
+  for (size_t i = 1; i < states.size(); i++) {
+    int from = states[i - 1];
+    int cell = from / HEADINGS;
+    glm::vec2 origin(cell / MAP_HEIGHT, cell % MAP_HEIGHT);
+    const Primitive &primitive =
+        primitives[from % HEADINGS][parentPrimitive[states[i]]];
+    for (const glm::vec2 &offset : primitive.cells) {
+      path.push_back(origin + offset);
+    }
+  }
+  return path;
+}
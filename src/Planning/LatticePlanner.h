@@ -0,0 +1,85 @@
+#ifndef PLANNING_LATTICE_PLANNER_H
+#define PLANNING_LATTICE_PLANNER_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "OccupancyGrid.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// State lattice planner over (x, y, heading). Successors are only ever the
+// motion primitives the car can actually drive: straight lines and arcs at
+// full and half steering lock, built from the Car's wheelbase and steering
+// clamp. Each primitive turns by exactly one heading bin so every end state
+// lands back on the lattice.
+//
+// All primitives and the cells the car's footprint sweeps over while driving
+// them are precomputed in the constructor, so a search only does table
+// lookups. The footprint runs from the rear axle (the planned point) to the
+// front axle and is carWidth wide.
+class LatticePlanner {
+public:
+  static const int HEADINGS = 16;
+
+  struct Primitive {
+    int endX; // offset of the end cell from the start cell
+    int endY;
+    int endHeading;
+    float cost; // length in cells, turning costs a little extra
+    std::vector<glm::vec2> cells; // centre line, start cell excluded
+    std::vector<int16_t> sweptCells; // x, y pairs of every cell the car covers
+  };
+
+  explicit LatticePlanner(const Car &car,
+                          float cellsPerMeter = CELLS_PER_METER);
+
+  // heading is in radians from the grid's x axis, update2() starts facing
+  // down the y axis (M_PI / 2). Any state within goalTolerance cells of end
+  // counts as the goal. Returns the cells along the driven primitives, from
+  // start to the goal.
+  std::vector<glm::vec2> search(const OccupancyGrid &grid, glm::vec2 start,
+                                float heading, glm::vec2 end);
+
+  const std::vector<Primitive> &getPrimitives(int heading) const {
+    return primitives[heading];
+  }
+
+  // number of states expanded by the last search
+  uint32_t getExpandedNodes() const { return expandedNodes; }
+
+  float goalTolerance = 10.0f;
+  // stops the search so it stays within a frame, returns no path if hit
+  uint32_t maxExpansions = 20000;
+  // extra cost per cell for driving a turning primitive
+  float turnPenalty = 0.1f;
+
+private:
+  struct OpenEntry {
+    float f;
+    int index;
+  };
+
+  std::vector<Primitive> primitives[HEADINGS];
+  uint32_t expandedNodes = 0;
+
+  // per state search data, valid when stamp matches generation
+  uint32_t generation = 0;
+  std::vector<uint32_t> stamp;
+  std::vector<float> g;
+  std::vector<int> parent;
+  std::vector<uint8_t> parentPrimitive;
+  std::vector<uint8_t> closed;
+  std::vector<OpenEntry> open;
+
+  void buildPrimitive(int heading, float curvature, float length,
+                      float bodyLength, float bodyWidth);
+  bool collides(const OccupancyGrid &grid, int x, int y,
+                const Primitive &primitive) const;
+  float primitiveCost(const OccupancyGrid &grid, int x, int y,
+                      const Primitive &primitive) const;
+  std::vector<glm::vec2> buildPath(int goalState) const;
+};
+
+#endif // PLANNING_LATTICE_PLANNER_H
@@ -0,0 +1,28 @@
+#include "OccupancyGrid.h"
+
+OccupancyGrid occupancy_grid(MAP_WIDTH, std::vector<int>(MAP_HEIGHT, 0));
+uint32_t costmap_version = 0;
+
+int GetMap(const OccupancyGrid &grid, int x, int y) {
+  if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
+    return BLOCKED_CELL;
+  }
+  return grid[x][y];
+}
+
+int GetMap(int x, int y) { return GetMap(occupancy_grid, x, y); }
+
+void DiffGrid(const OccupancyGrid &grid, OccupancyGrid &previous,
+              std::vector<int> &changed) {
+  if (previous.size() != grid.size()) {
+    previous.assign(MAP_WIDTH, std::vector<int>(MAP_HEIGHT, FREE_CELL));
+  }
+  for (int x = 0; x < MAP_WIDTH; x++) {
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+      if (previous[x][y] != grid[x][y]) {
+        previous[x][y] = grid[x][y];
+        changed.push_back(x * MAP_HEIGHT + y);
+      }
+    }
+  }
+}
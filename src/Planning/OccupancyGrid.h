@@ -0,0 +1,56 @@
+#ifndef PLANNING_OCCUPANCY_GRID_H
+#define PLANNING_OCCUPANCY_GRID_H
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+const int MAP_WIDTH = 200;
+const int MAP_HEIGHT = 200;
+const float CELLS_PER_METER = 50.0f; // each cell is 2cm across
+
+// cell values used by the costmap
+const int FREE_CELL = 0;     // open track
+const int INFLATED_CELL = 1; // inside the soft buffer around a wall
+const int BLOCKED_CELL = 9;  // a wall (or the hard buffer around one)
+
+// indexed [x][y], x is across the track and y is forward from the car
+typedef std::vector<std::vector<int>> OccupancyGrid;
+
+extern OccupancyGrid occupancy_grid;
+
+// bumped whenever a rebuild of occupancy_grid changes it, so anything cached
+// from it knows when it is stale and can keep going while it isn't
+extern uint32_t costmap_version;
+
+// anything outside of the grid is treated as a wall
+int GetMap(const OccupancyGrid &grid, int x, int y);
+int GetMap(int x, int y);
+
+// brings previous up to date with grid, appending the index
+// (x * MAP_HEIGHT + y) of every cell that was different to changed
+void DiffGrid(const OccupancyGrid &grid, OccupancyGrid &previous,
+              std::vector<int> &changed);
+
+inline bool IsPassable(const OccupancyGrid &grid, int x, int y) {
+  return GetMap(grid, x, y) < BLOCKED_CELL;
+}
+
+// cost of moving one cell length into (x, y), inflated cells cost more so the
+// planners keep away from the walls when they can
+inline float TraversalCost(const OccupancyGrid &grid, int x, int y) {
+  return 1.0f + GetMap(grid, x, y);
+}
+
+// admissible distance estimate on an 8-connected grid where the cheapest step
+// costs 1 (or sqrt(2) diagonally)
+inline float OctileDistance(int dx, int dy) {
+  dx = dx < 0 ? -dx : dx;
+  dy = dy < 0 ? -dy : dy;
+  int lo = dx < dy ? dx : dy;
+  int hi = dx < dy ? dy : dx;
+  return (hi - lo) + 1.41421356f * lo;
+}
+
+#endif // PLANNING_OCCUPANCY_GRID_H
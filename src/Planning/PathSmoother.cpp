@@ -0,0 +1,193 @@
+#include "PathSmoother.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+
+namespace {
+const float SAMPLES_PER_CELL = 4.0f; // line of sight and spline sampling
+
+inline bool Blocked(const OccupancyGrid &grid, glm::vec2 p) {
+  return !IsPassable(grid, (int)std::round(p.x), (int)std::round(p.y));
+}
+
+// Menger curvature of the circle through a, b and c
+inline float Curvature(glm::vec2 a, glm::vec2 b, glm::vec2 c) {
+  glm::vec2 ab = b - a;
+  glm::vec2 bc = c - b;
+  float denominator = glm::length(ab) * glm::length(bc) * glm::length(c - a);
+  if (denominator < 1e-6f) {
+    return 0.0f;
+  }
+  return 2.0f * std::abs(ab.x * bc.y - ab.y * bc.x) / denominator;
+}
+
+// time parameter step of a centripetal Catmull-Rom spline
+inline float KnotStep(glm::vec2 a, glm::vec2 b) {
+  return std::max(std::sqrt(glm::length(b - a)), 1e-3f);
+}
+} // namespace
+
+PathSmoother::PathSmoother(const Car &car, float cellsPerMeter) {
+  float wheelbase = car.wheelbase * cellsPerMeter;
+  maxCurvature = std::tan(glm::radians(Car::maxSteeringDegrees)) / wheelbase;
+}
+
+const std::vector<glm::vec2> &
+PathSmoother::smooth(const OccupancyGrid &grid,
+                     const std::vector<glm::vec2> &path) {
+  resampled.clear();
+  maxCurvatureFound = 0.0f;
+  if (path.size() < 3) {
+    resampled.insert(resampled.end(), path.begin(), path.end());
+    return resampled;
+  }
+
+  shortcut(grid, path);
+  fitSpline(grid);
+  resample();
+  boundCurvature(grid);
+  return resampled;
+}
+
+// the line may not cross a wall, or any cell worse than maxCost, so cutting a
+// corner never drags the path into the inflation it was routed around
+bool PathSmoother::lineOfSight(const OccupancyGrid &grid, glm::vec2 from,
+                               glm::vec2 to, int maxCost) const {
+  float length = glm::length(to - from);
+  int steps = std::max(1, (int)std::ceil(length * SAMPLES_PER_CELL));
+  for (int i = 1; i < steps; i++) {
+    glm::vec2 p = from + (to - from) * ((float)i / steps);
+    if (GetMap(grid, (int)std::round(p.x), (int)std::round(p.y)) > maxCost) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// greedy: from each kept cell, walk forwards until the line of sight breaks
+// and keep the last cell that could still be seen
+void PathSmoother::shortcut(const OccupancyGrid &grid,
+                            const std::vector<glm::vec2> &path) {
+  waypoints.clear();
+  waypoints.push_back(path[0]);
+  size_t anchor = 0;
+  while (anchor + 1 < path.size()) {
+    size_t next = anchor + 1;
+    int maxCost = std::max(GetMap(grid, (int)path[anchor].x,
+                                  (int)path[anchor].y),
+                           GetMap(grid, (int)path[next].x, (int)path[next].y));
+    for (size_t j = anchor + 2; j < path.size(); j++) {
+      maxCost = std::max(maxCost, GetMap(grid, (int)path[j].x, (int)path[j].y));
+      if (!lineOfSight(grid, path[anchor], path[j], maxCost)) {
+        break;
+      }
+      next = j;
+    }
+    waypoints.push_back(path[next]);
+    anchor = next;
+  }
+}
+
+// centripetal Catmull-Rom (Barry-Goldman form), so it can't loop or cusp
+// between close waypoints. A span that would clip a wall falls back to the
+// straight line, which shortcut() already checked
+void PathSmoother::fitSpline(const OccupancyGrid &grid) {
+  dense.clear();
+  distances.clear();
+  dense.push_back(waypoints[0]);
+  distances.push_back(0.0f);
+
+  const size_t count = waypoints.size();
+  for (size_t i = 0; i + 1 < count; i++) {
+    glm::vec2 p1 = waypoints[i];
+    glm::vec2 p2 = waypoints[i + 1];
+    // mirror the ends so the first and last spans have a tangent
+    glm::vec2 p0 = i > 0 ? waypoints[i - 1] : p1 * 2.0f - p2;
+    glm::vec2 p3 = i + 2 < count ? waypoints[i + 2] : p2 * 2.0f - p1;
+
+    float t0 = 0.0f;
+    float t1 = t0 + KnotStep(p0, p1);
+    float t2 = t1 + KnotStep(p1, p2);
+    float t3 = t2 + KnotStep(p2, p3);
+
+    int steps =
+        std::max(1, (int)std::ceil(glm::length(p2 - p1) * SAMPLES_PER_CELL));
+    size_t spanStart = dense.size();
+    bool clear = true;
+    for (int s = 1; s <= steps; s++) {
+      float t = t1 + (t2 - t1) * ((float)s / steps);
+      glm::vec2 a1 = (t1 - t) / (t1 - t0) * p0 + (t - t0) / (t1 - t0) * p1;
+      glm::vec2 a2 = (t2 - t) / (t2 - t1) * p1 + (t - t1) / (t2 - t1) * p2;
+      glm::vec2 a3 = (t3 - t) / (t3 - t2) * p2 + (t - t2) / (t3 - t2) * p3;
+      glm::vec2 b1 = (t2 - t) / (t2 - t0) * a1 + (t - t0) / (t2 - t0) * a2;
+      glm::vec2 b2 = (t3 - t) / (t3 - t1) * a2 + (t - t1) / (t3 - t1) * a3;
+      glm::vec2 point = (t2 - t) / (t2 - t1) * b1 + (t - t1) / (t2 - t1) * b2;
+      if (Blocked(grid, point)) {
+        clear = false;
+        break;
+      }
+      distances.push_back(distances.back() + glm::length(point - dense.back()));
+      dense.push_back(point);
+    }
+
+    if (!clear) {
+      dense.resize(spanStart);
+      distances.resize(spanStart);
+      for (int s = 1; s <= steps; s++) {
+        glm::vec2 point = p1 + (p2 - p1) * ((float)s / steps);
+        distances.push_back(distances.back() +
+                            glm::length(point - dense.back()));
+        dense.push_back(point);
+      }
+    }
+  }
+}
+
+void PathSmoother::resample() {
+  resampled.clear();
+  resampled.push_back(dense[0]);
+  float total = distances.back();
+  size_t segment = 1;
+  for (float s = spacing; s < total; s += spacing) {
+    while (distances[segment] < s) {
+      segment++;
+    }
+    float span = distances[segment] - distances[segment - 1];
+    float alpha = span > 0.0f ? (s - distances[segment - 1]) / span : 0.0f;
+    resampled.push_back(dense[segment - 1] +
+                        (dense[segment] - dense[segment - 1]) * alpha);
+  }
+  if (glm::length(dense.back() - resampled.back()) > 1e-3f) {
+    resampled.push_back(dense.back());
+  }
+}
+
+// pulls each point that turns too tightly halfway towards the midpoint of
+// its neighbours, which straightens it out while the ends stay put
+void PathSmoother::boundCurvature(const OccupancyGrid &grid) {
+  const size_t count = resampled.size();
+  for (int iteration = 0; iteration < relaxIterations; iteration++) {
+    bool changed = false;
+    for (size_t i = 1; i + 1 < count; i++) {
+      if (Curvature(resampled[i - 1], resampled[i], resampled[i + 1]) <=
+          maxCurvature) {
+        continue;
+      }
+      glm::vec2 target =
+          (resampled[i] + (resampled[i - 1] + resampled[i + 1]) * 0.5f) * 0.5f;
+      if (!Blocked(grid, target)) {
+        resampled[i] = target;
+        changed = true;
+      }
+    }
+    if (!changed) {
+      break;
+    }
+  }
+
+  for (size_t i = 1; i + 1 < count; i++) {
+    maxCurvatureFound =
+        std::max(maxCurvatureFound,
+                 Curvature(resampled[i - 1], resampled[i], resampled[i + 1]));
+  }
+}
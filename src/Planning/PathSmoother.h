@@ -0,0 +1,56 @@
+#ifndef PLANNING_PATH_SMOOTHER_H
+#define PLANNING_PATH_SMOOTHER_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include "OccupancyGrid.h"
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// Turns the zig-zag cell paths the grid planners return into something the
+// car can steer along:
+//   1. shortcut, dropping every cell that a straight line can skip without
+//      going through a wall or anything more expensive than the path it
+//      replaces
+//   2. fit a centripetal Catmull-Rom spline through what is left
+//   3. resample it every `spacing` cells of arc length
+//   4. relax any point that turns tighter than the car can, using the Car's
+//      wheelbase and steering lock. Walls can leave no room for that, so
+//      getMaxCurvature() says how close it got
+//
+// Every buffer is kept between calls, so once they have grown to fit the
+// longest path nothing is allocated.
+class PathSmoother {
+public:
+  explicit PathSmoother(const Car &car, float cellsPerMeter = CELLS_PER_METER);
+
+  // the smoothed path from the first cell of path to the last, in cells like
+  // astar(). The reference stays valid until the next call
+  const std::vector<glm::vec2> &smooth(const OccupancyGrid &grid,
+                                       const std::vector<glm::vec2> &path);
+
+  const std::vector<glm::vec2> &getPath() const { return resampled; }
+  // tightest turn left in the last path, 1 / cells
+  float getMaxCurvature() const { return maxCurvatureFound; }
+
+  float spacing = 1.0f;   // cells of arc length between output points
+  float maxCurvature;     // 1 / cells, full lock by default
+  int relaxIterations = 100;
+
+private:
+  std::vector<glm::vec2> waypoints;
+  std::vector<glm::vec2> dense;
+  std::vector<float> distances; // arc length at each dense point
+  std::vector<glm::vec2> resampled;
+  float maxCurvatureFound = 0.0f;
+
+  bool lineOfSight(const OccupancyGrid &grid, glm::vec2 from, glm::vec2 to,
+                   int maxCost) const;
+  void shortcut(const OccupancyGrid &grid, const std::vector<glm::vec2> &path);
+  void fitSpline(const OccupancyGrid &grid);
+  void resample();
+  void boundCurvature(const OccupancyGrid &grid);
+};
+
+#endif // PLANNING_PATH_SMOOTHER_H
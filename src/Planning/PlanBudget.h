@@ -0,0 +1,39 @@
+#ifndef PLANNING_PLAN_BUDGET_H
+#define PLANNING_PLAN_BUDGET_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// How much work a planner may do in one call. Whichever runs out first ends
+// the call; zero means no limit.
+struct PlanBudget {
+  double seconds = 0.0;
+  uint32_t expansions = 0;
+
+  inline void begin() {
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(seconds));
+    used = 0;
+  }
+
+  // call once per expansion, the clock is only read every 16 expansions
+  inline bool exhausted() {
+    used++;
+    if (expansions != 0 && used > expansions) {
+      return true;
+    }
+    return seconds > 0.0 && (used & 15) == 0 &&
+           std::chrono::steady_clock::now() > deadline;
+  }
+
+  uint32_t getUsed() const { return used; }
+
+private:
+  std::chrono::steady_clock::time_point deadline;
+  uint32_t used = 0;
+};
+
+#endif // PLANNING_PLAN_BUDGET_H
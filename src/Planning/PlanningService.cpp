@@ -0,0 +1,149 @@
+#include "PlanningService.h"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+// the open list is a binary heap sorted on f, smallest on top. With an exact
+// heuristic every cell on the best path ties on f, so prefer the deepest one
+struct OpenCompare {
+  template <typename T> bool operator()(const T &a, const T &b) const {
+    return a.f > b.f || (a.f == b.f && a.g < b.g);
+  }
+};
+
+const int DIRECTIONS[8][2] = {{1, 0},  {-1, 0}, {0, 1},  {0, -1},
+                              {1, 1},  {1, -1}, {-1, 1}, {-1, -1}};
+
+int ThreadCount() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+int ThreadIndex() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+} // namespace
+
+PlanningService::PlanningService() : workers(ThreadCount()) {}
+
+void PlanningService::run(const OccupancyGrid &grid, uint32_t version,
+                          glm::vec2 start, const std::vector<glm::vec2> &goals,
+                          std::vector<PlanResult> &results) {
+  if (!hasSnapshot || version != snapshotVersion) {
+    snapshot = grid;
+    snapshotVersion = version;
+    hasSnapshot = true;
+  }
+  field.update(snapshot, snapshotVersion, start, HeuristicField::FROM_GOAL);
+
+  int startIndex = std::clamp((int)start.x, 0, MAP_WIDTH - 1) * MAP_HEIGHT +
+                   std::clamp((int)start.y, 0, MAP_HEIGHT - 1);
+  if ((int)workers.size() < ThreadCount()) {
+    workers.resize(ThreadCount());
+  }
+  results.resize(goals.size());
+
+  const int count = (int)goals.size();
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < count; i++) {
+    search(workers[ThreadIndex()], startIndex, goals[i], results[i]);
+  }
+}
+
+// A* from the goal back to the start, guided by the field. Each step still
+// means driving forwards, from the neighbour into the cell being expanded, so
+// it is priced by that cell
+void PlanningService::search(Worker &worker, int startIndex, glm::vec2 goal,
+                             PlanResult &result) const {
+  result.path.clear();
+  result.cost = INFINITY;
+  result.expandedNodes = 0;
+
+  // update2() asks for the cell just past the far edge of the grid, so keep
+  // the goal on the map
+  int goalX = std::clamp((int)goal.x, 0, MAP_WIDTH - 1);
+  int goalY = std::clamp((int)goal.y, 0, MAP_HEIGHT - 1);
+  float goalH = field.get(goalX, goalY);
+  if (std::isinf(goalH)) {
+    return;
+  }
+
+  if (worker.stamp.empty()) {
+    worker.stamp.resize(MAP_WIDTH * MAP_HEIGHT, 0);
+    worker.g.resize(MAP_WIDTH * MAP_HEIGHT);
+    worker.parent.resize(MAP_WIDTH * MAP_HEIGHT);
+  }
+  if (++worker.generation == 0) {
+    std::fill(worker.stamp.begin(), worker.stamp.end(), 0);
+    worker.generation = 1;
+  }
+
+  int goalIndex = goalX * MAP_HEIGHT + goalY;
+  worker.open.clear();
+  worker.stamp[goalIndex] = worker.generation;
+  worker.g[goalIndex] = 0.0f;
+  worker.parent[goalIndex] = -1;
+  worker.open.push_back({goalH, 0.0f, goalIndex});
+
+  while (!worker.open.empty()) {
+    std::pop_heap(worker.open.begin(), worker.open.end(), OpenCompare());
+    OpenEntry top = worker.open.back();
+    worker.open.pop_back();
+    if (top.g != worker.g[top.index]) {
+      continue; // a cheaper route to this cell was found since
+    }
+    result.expandedNodes++;
+
+    if (top.index == startIndex) {
+      // the search ran goal to start, so walking the parents gives the path
+      // in the order update2() wants it
+      result.cost = 0.0f;
+      for (int index = top.index; index >= 0; index = worker.parent[index]) {
+        glm::vec2 cell(index / MAP_HEIGHT, index % MAP_HEIGHT);
+        if (!result.path.empty()) {
+          glm::vec2 step = cell - result.path.back();
+          bool diagonal = step.x != 0.0f && step.y != 0.0f;
+          result.cost += (diagonal ? 1.41421356f : 1.0f) *
+                         TraversalCost(snapshot, (int)cell.x, (int)cell.y);
+        }
+        result.path.push_back(cell);
+      }
+      return;
+    }
+
+    int x = top.index / MAP_HEIGHT;
+    int y = top.index % MAP_HEIGHT;
+    float enter = TraversalCost(snapshot, x, y);
+    for (const auto &dir : DIRECTIONS) {
+      int nx = x + dir[0];
+      int ny = y + dir[1];
+      if (!IsPassable(snapshot, nx, ny)) {
+        continue;
+      }
+      bool diagonal = dir[0] != 0 && dir[1] != 0;
+      if (diagonal &&
+          (!IsPassable(snapshot, nx, y) || !IsPassable(snapshot, x, ny))) {
+        continue; // no cutting corners
+      }
+      float newG = top.g + (diagonal ? 1.41421356f : 1.0f) * enter;
+      int n = nx * MAP_HEIGHT + ny;
+      if (worker.stamp[n] == worker.generation && newG >= worker.g[n]) {
+        continue;
+      }
+      worker.stamp[n] = worker.generation;
+      worker.g[n] = newG;
+      worker.parent[n] = top.index;
+      worker.open.push_back({newG + field.get(nx, ny), newG, n});
+      std::push_heap(worker.open.begin(), worker.open.end(), OpenCompare());
+    }
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef PLANNING_PLANNING_SERVICE_H
+#define PLANNING_PLANNING_SERVICE_H
+
+#pragma once
+
+#include "HeuristicField.h"
+#include "OccupancyGrid.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <vector>
+
+// answer to one goal handed to PlanningService::run()
+struct PlanResult {
+  std::vector<glm::vec2> path; // start to goal, same format as astar()
+  float cost = INFINITY;       // INFINITY if the goal can't be reached
+  uint32_t expandedNodes = 0;
+};
+
+// Plans from one start to many candidate goals at once, so update2() can
+// score gap targets and offsets instead of always going for the top centre.
+//
+// Every query runs against the same snapshot of the costmap, which is copied
+// once per costmap version and left alone while the queries run. The start is
+// shared, so instead of a heuristic per goal there is a single HeuristicField
+// built out from the start, and each query searches backwards from its goal
+// towards the start. That field is the exact cost from the start, so a query
+// only expands the cells along its own path.
+//
+// Queries are spread over the OpenMP threads (run serially without OpenMP),
+// each of which keeps its own search buffers between calls.
+class PlanningService {
+public:
+  PlanningService();
+
+  // plans from start to every goal, results[i] is for goals[i]. Costs are
+  // TraversalCost() per step with no cutting corners, like the other planners.
+  void run(const OccupancyGrid &grid, uint32_t version, glm::vec2 start,
+           const std::vector<glm::vec2> &goals,
+           std::vector<PlanResult> &results);
+
+  const OccupancyGrid &getSnapshot() const { return snapshot; }
+  const HeuristicField &getField() const { return field; }
+
+private:
+  struct OpenEntry {
+    float f;
+    float g;
+    int index;
+  };
+
+  // search buffers owned by one thread. A cell only holds valid data if its
+  // stamp matches the current generation
+  struct Worker {
+    uint32_t generation = 0;
+    std::vector<uint32_t> stamp;
+    std::vector<float> g;
+    std::vector<int> parent;
+    std::vector<OpenEntry> open;
+  };
+
+  bool hasSnapshot = false;
+  uint32_t snapshotVersion = 0;
+  OccupancyGrid snapshot;
+  HeuristicField field;
+  std::vector<Worker> workers;
+
+  void search(Worker &worker, int startIndex, glm::vec2 goal,
+              PlanResult &result) const;
+};
+
+#endif // PLANNING_PLANNING_SERVICE_H
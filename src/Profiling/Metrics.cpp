@@ -0,0 +1,277 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "rays traced", "BVH nodes visited", "A* expansions", "allocations"};
+const char *const LATENCY_NAMES[LATENCY_COUNT] = {
+    "lidar",        "costmap", "plan",         "autonomy",
+    "physics step", "frame",   "bridge round trip"};
+
+// zero initialised, and so usable by the very first operator new
+MetricsBlock localBlock;
+
+MetricsBlock *publishedBlock = nullptr;
+std::string publishedName;
+
+// shm_open() wants exactly one leading slash
+std::string SegmentName(const std::string &name) {
+  return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+void Describe(MetricsBlock &block) {
+  memcpy(block.magic, METRICS_MAGIC, sizeof(block.magic));
+  block.version = METRICS_VERSION;
+  block.counterCount = COUNTER_COUNT;
+  block.latencyCount = LATENCY_COUNT;
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    snprintf(block.counterNames[i], METRIC_NAME_SIZE, "%s", COUNTER_NAMES[i]);
+  }
+  for (int i = 0; i < LATENCY_COUNT; i++) {
+    snprintf(block.latencyNames[i], METRIC_NAME_SIZE, "%s", LATENCY_NAMES[i]);
+  }
+}
+
+// the local block only has names for printing, its values start at zero
+const bool localBlockDescribed = (Describe(localBlock), true);
+
+// adds everything in from to to, so nothing counted before publishing is lost
+void Carry(const MetricsBlock &from, MetricsBlock &to) {
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    to.counters[i].value += from.counters[i].value.load();
+  }
+  for (int i = 0; i < LATENCY_COUNT; i++) {
+    const LatencyHistogram &source = from.latencies[i];
+    LatencyHistogram &target = to.latencies[i];
+    target.count += source.count.load();
+    target.totalNanoseconds += source.totalNanoseconds.load();
+    if (source.maxNanoseconds.load() > target.maxNanoseconds.load()) {
+      target.maxNanoseconds = source.maxNanoseconds.load();
+    }
+    for (int j = 0; j < HISTOGRAM_BUCKETS; j++) {
+      target.buckets[j] += source.buckets[j].load();
+    }
+  }
+}
+} // namespace
+
+MetricsBlock *metrics = &localBlock;
+
+uint64_t HistogramBucketLimit(int bucket) {
+  if (bucket < HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t lowest =
+      (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS)
+      << shift;
+  return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+#ifdef _WIN32
+void PublishMetrics(const std::string &name) {
+  throw std::runtime_error("shared memory metrics need POSIX: " + name);
+}
+
+void UnpublishMetrics() {}
+
+MetricsReader::MetricsReader(const std::string &name) {
+  throw std::runtime_error("shared memory metrics need POSIX: " + name);
+}
+
+MetricsReader::~MetricsReader() {}
+#else
+void PublishMetrics(const std::string &name) {
+  if (publishedBlock) {
+    throw std::runtime_error("metrics are already published as " +
+                             publishedName);
+  }
+  std::string segment = SegmentName(name);
+  int fd = shm_open(segment.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open shared memory: " + segment);
+  }
+  // a segment left behind by a run that crashed starts over from zero
+  void *memory = MAP_FAILED;
+  if (ftruncate(fd, 0) == 0 && ftruncate(fd, sizeof(MetricsBlock)) == 0) {
+    memory = mmap(nullptr, sizeof(MetricsBlock), PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(segment.c_str());
+    throw std::runtime_error("failed to map shared memory: " + segment);
+  }
+
+  MetricsBlock *block = new (memory) MetricsBlock();
+  Describe(*block);
+  block->pid = (uint32_t)getpid();
+  Carry(localBlock, *block);
+  block->running.store(1, std::memory_order_release);
+  publishedBlock = block;
+  publishedName = segment;
+  metrics = block;
+}
+
+void UnpublishMetrics() {
+  if (!publishedBlock) {
+    return;
+  }
+  memset((void *)&localBlock, 0, sizeof(localBlock));
+  Describe(localBlock);
+  Carry(*publishedBlock, localBlock);
+  metrics = &localBlock;
+  publishedBlock->running.store(0, std::memory_order_release);
+  munmap(publishedBlock, sizeof(MetricsBlock));
+  shm_unlink(publishedName.c_str());
+  publishedBlock = nullptr;
+}
+
+MetricsReader::MetricsReader(const std::string &name) {
+  std::string segment = SegmentName(name);
+  int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw std::runtime_error("no metrics published as " + segment);
+  }
+  void *memory =
+      mmap(nullptr, sizeof(MetricsBlock), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error("failed to map shared memory: " + segment);
+  }
+  block = (const MetricsBlock *)memory;
+  if (memcmp(block->magic, METRICS_MAGIC, sizeof(block->magic)) != 0 ||
+      block->version != METRICS_VERSION ||
+      block->counterCount != COUNTER_COUNT ||
+      block->latencyCount != LATENCY_COUNT) {
+    munmap(memory, sizeof(MetricsBlock));
+    throw std::runtime_error("metrics in " + segment +
+                             " are from an incompatible build");
+  }
+}
+
+MetricsReader::~MetricsReader() {
+  munmap((void *)block, sizeof(MetricsBlock));
+}
+#endif
+
+uint64_t MetricsSnapshot::Histogram::getQuantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  // the rank of the value wanted, counting from 1
+  uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * count + 0.5));
+  uint64_t seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(HistogramBucketLimit(i), maxNanoseconds);
+    }
+  }
+  return maxNanoseconds;
+}
+
+MetricsSnapshot MetricsSnapshot::since(const MetricsSnapshot &before) const {
+  MetricsSnapshot change = *this;
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    change.counters[i] -= before.counters[i];
+  }
+  for (int i = 0; i < LATENCY_COUNT; i++) {
+    Histogram &histogram = change.latencies[i];
+    histogram.count -= before.latencies[i].count;
+    histogram.totalNanoseconds -= before.latencies[i].totalNanoseconds;
+    for (int j = 0; j < HISTOGRAM_BUCKETS; j++) {
+      histogram.buckets[j] -= before.latencies[i].buckets[j];
+    }
+  }
+  return change;
+}
+
+MetricsSnapshot ReadMetrics(const MetricsBlock &block) {
+  MetricsSnapshot snapshot;
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    snapshot.counters[i] =
+        block.counters[i].value.load(std::memory_order_relaxed);
+  }
+  for (int i = 0; i < LATENCY_COUNT; i++) {
+    const LatencyHistogram &source = block.latencies[i];
+    MetricsSnapshot::Histogram &histogram = snapshot.latencies[i];
+    // the buckets are read one at a time while they're being added to, so
+    // count them up rather than trust a count read before or after them
+    histogram.count = 0;
+    for (int j = 0; j < HISTOGRAM_BUCKETS; j++) {
+      histogram.buckets[j] = source.buckets[j].load(std::memory_order_relaxed);
+      histogram.count += histogram.buckets[j];
+    }
+    histogram.totalNanoseconds =
+        source.totalNanoseconds.load(std::memory_order_relaxed);
+    histogram.maxNanoseconds =
+        source.maxNanoseconds.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+void PrintMetrics(const MetricsBlock &block, const MetricsSnapshot &snapshot,
+                  double seconds) {
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    printf("  %-20.*s %14llu  %12.0f/s\n", METRIC_NAME_SIZE,
+           block.counterNames[i], (unsigned long long)snapshot.counters[i],
+           seconds > 0.0 ? snapshot.counters[i] / seconds : 0.0);
+  }
+  printf("  %-20s %10s %10s %10s %10s %10s %10s\n", "latency (us)", "count",
+         "mean", "p50", "p99", "p999", "max");
+  for (int i = 0; i < LATENCY_COUNT; i++) {
+    const MetricsSnapshot::Histogram &histogram = snapshot.latencies[i];
+    if (histogram.count == 0) {
+      continue;
+    }
+    printf("  %-20.*s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           METRIC_NAME_SIZE, block.latencyNames[i],
+           (unsigned long long)histogram.count,
+           histogram.totalNanoseconds * 1e-3 / histogram.count,
+           histogram.getQuantile(0.5) * 1e-3,
+           histogram.getQuantile(0.99) * 1e-3,
+           histogram.getQuantile(0.999) * 1e-3,
+           histogram.maxNanoseconds * 1e-3);
+  }
+}
+
+#ifndef F1TENTH_NO_METRICS
+// Every allocation in the process goes through here, so ALLOCATIONS counts
+// them all. Each thread adds its count 64 at a time, so allocating doesn't
+// mean fighting over the counter's cache line.
+namespace {
+thread_local uint32_t uncountedAllocations = 0;
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (++uncountedAllocations == 64) {
+    CountMetric(ALLOCATIONS, uncountedAllocations);
+    uncountedAllocations = 0;
+  }
+  for (;;) {
+    if (void *memory = std::malloc(size ? size : 1)) {
+      return memory;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+#endif
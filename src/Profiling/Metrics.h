@@ -0,0 +1,203 @@
+#ifndef PROFILING_METRICS_H
+#define PROFILING_METRICS_H
+
+#pragma once
+
+#include "Trace.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Counters and latency histograms that stay on for the whole run, unlike the
+// zones in Trace.h which only record while tracing. Updating either is a
+// relaxed atomic add, so the hot paths never take a lock, and every one of
+// them lives in a single MetricsBlock. PublishMetrics() moves that block into
+// a named shared memory segment, where F1TenthMetrics (src/metrics.cpp) or a
+// MetricsReader in anything else can watch it live while the simulator runs.
+//
+// Building with F1TENTH_NO_METRICS turns every update into a no-op.
+
+enum MetricCounter {
+  RAYS_TRACED,       // LIDAR rays traced through the BVH
+  BVH_NODES_VISITED, // nodes those rays were tested against
+  ASTAR_EXPANSIONS,  // nodes expanded by whichever planner ran
+  ALLOCATIONS,       // calls to operator new, counted 64 at a time
+  COUNTER_COUNT
+};
+
+enum MetricLatency {
+  LIDAR_LATENCY,    // TraceLidar()
+  COSTMAP_LATENCY,  // build_costmap()
+  PLAN_LATENCY,     // one planner call
+  AUTONOMY_LATENCY, // all of update2()
+  PHYSICS_LATENCY,  // one physics step of one car
+  FRAME_LATENCY,    // one frame of the windowed loop
+  BRIDGE_LATENCY,   // a scan out through the Bridge to its command back
+  LATENCY_COUNT
+};
+
+// 16 buckets for every power of two, so a bucket is never more than 1/16th
+// wider than the values in it, from 1 ns all the way up to 2^64 ns
+const int HISTOGRAM_SUB_BITS = 4;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+inline int HistogramBucket(uint64_t nanoseconds) {
+  if (nanoseconds < HISTOGRAM_SUB_BUCKETS) {
+    return (int)nanoseconds;
+  }
+#if defined(__GNUC__) || defined(__clang__)
+  int exponent = 63 - __builtin_clzll(nanoseconds);
+#else
+  int exponent = 63;
+  while ((nanoseconds >> exponent) == 0) {
+    exponent--;
+  }
+#endif
+  int shift = exponent - HISTOGRAM_SUB_BITS;
+  return (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+         (int)((nanoseconds >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+// the largest value that lands in bucket
+uint64_t HistogramBucketLimit(int bucket);
+
+struct LatencyHistogram {
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> totalNanoseconds;
+  std::atomic<uint64_t> maxNanoseconds;
+  std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+
+  inline void record(uint64_t nanoseconds) {
+    buckets[HistogramBucket(nanoseconds)].fetch_add(1,
+                                                    std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    uint64_t max = maxNanoseconds.load(std::memory_order_relaxed);
+    while (nanoseconds > max &&
+           !maxNanoseconds.compare_exchange_weak(max, nanoseconds,
+                                                 std::memory_order_relaxed)) {
+    }
+  }
+};
+
+const char METRICS_MAGIC[8] = "F1TMETR";
+const uint32_t METRICS_VERSION = 1;
+const int METRIC_NAME_SIZE = 32;
+
+// What the shared memory segment holds. The names are in it too, so a reader
+// doesn't have to be built from the same source as the simulator, only with
+// the same METRICS_VERSION.
+struct MetricsBlock {
+  char magic[8];
+  uint32_t version;
+  uint32_t pid;
+  uint32_t counterCount;
+  uint32_t latencyCount;
+  std::atomic<uint32_t> running; // cleared once the simulator stops publishing
+  char counterNames[COUNTER_COUNT][METRIC_NAME_SIZE];
+  char latencyNames[LATENCY_COUNT][METRIC_NAME_SIZE];
+
+  // counters each on a cache line of their own, so threads adding to
+  // different ones don't slow each other down
+  struct alignas(64) Counter {
+    std::atomic<uint64_t> value;
+  };
+  Counter counters[COUNTER_COUNT];
+  alignas(64) LatencyHistogram latencies[LATENCY_COUNT];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "metrics are shared between processes, so they can't use locks");
+
+// where the updates go; a block in this process until PublishMetrics()
+extern MetricsBlock *metrics;
+
+#ifndef F1TENTH_NO_METRICS
+inline void CountMetric(MetricCounter counter, uint64_t amount = 1) {
+  metrics->counters[counter].value.fetch_add(amount,
+                                             std::memory_order_relaxed);
+}
+
+inline void RecordLatency(MetricLatency latency, uint64_t nanoseconds) {
+  metrics->latencies[latency].record(nanoseconds);
+}
+#else
+inline void CountMetric(MetricCounter, uint64_t = 1) {}
+
+inline void RecordLatency(MetricLatency, uint64_t) {}
+#endif
+
+// records how long the rest of the enclosing scope takes
+class LatencyScope {
+public:
+  explicit LatencyScope(MetricLatency latency)
+      : latency(latency), begin(TraceNow()) {}
+  ~LatencyScope() { RecordLatency(latency, TraceNow() - begin); }
+  LatencyScope(const LatencyScope &) = delete;
+  LatencyScope &operator=(const LatencyScope &) = delete;
+
+private:
+  MetricLatency latency;
+  uint64_t begin;
+};
+
+#ifdef F1TENTH_NO_METRICS
+#define LATENCY_SCOPE(latency)
+#else
+#define LATENCY_SCOPE(latency)                                                 \
+  LatencyScope TRACE_CONCAT(latencyScope, __LINE__)(latency)
+#endif
+
+// Moves the metrics into the shared memory segment name ("/f1tenth-sim"),
+// carrying over what was counted so far. Call it before starting any other
+// threads. Throws std::runtime_error if the segment can't be made
+void PublishMetrics(const std::string &name);
+// marks the segment stopped, removes it and moves the metrics back. Only
+// once the other threads are done with them
+void UnpublishMetrics();
+
+// the values in a MetricsBlock at one moment, and what changed since another
+struct MetricsSnapshot {
+  uint64_t counters[COUNTER_COUNT] = {};
+  struct Histogram {
+    uint64_t count = 0;
+    uint64_t totalNanoseconds = 0;
+    uint64_t maxNanoseconds = 0;
+    uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+
+    // the latency q (0.5 for the median) of the values are at or below,
+    // accurate to the bucket it falls in
+    uint64_t getQuantile(double q) const;
+  } latencies[LATENCY_COUNT];
+
+  // counts since before. The max is kept as it is, it can't be subtracted
+  MetricsSnapshot since(const MetricsSnapshot &before) const;
+};
+
+MetricsSnapshot ReadMetrics(const MetricsBlock &block);
+// one line per counter (with its rate over seconds) and per histogram that
+// has anything in it, with names out of block
+void PrintMetrics(const MetricsBlock &block, const MetricsSnapshot &snapshot,
+                  double seconds);
+
+// maps another process's published metrics read only
+class MetricsReader {
+public:
+  // throws std::runtime_error if there is no such segment, or it's from an
+  // incompatible build
+  explicit MetricsReader(const std::string &name);
+  ~MetricsReader();
+  MetricsReader(const MetricsReader &) = delete;
+  MetricsReader &operator=(const MetricsReader &) = delete;
+
+  const MetricsBlock &getBlock() const { return *block; }
+  bool isRunning() const {
+    return block->running.load(std::memory_order_acquire) != 0;
+  }
+
+private:
+  const MetricsBlock *block = nullptr;
+};
+
+#endif // PROFILING_METRICS_H
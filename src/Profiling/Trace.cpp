@@ -0,0 +1,132 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+std::atomic<bool> tracing{false};
+
+namespace {
+struct TraceEvent {
+  const char *name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// one thread's zones. Only its thread writes events and count; the exporter
+// reads count first, so it never sees a slot before it has been filled
+struct TraceRing {
+  std::vector<TraceEvent> events;
+  std::atomic<uint64_t> count{0};
+  std::string name;
+  int id;
+};
+
+std::mutex ringsMutex;
+// kept after their threads exit, so short lived workers still show up
+std::vector<std::unique_ptr<TraceRing>> rings;
+size_t ringSize = 1 << 16;
+uint64_t traceStart = 0;
+
+thread_local TraceRing *threadRing = nullptr;
+// the name for this thread's ring, if it was named before it had one
+thread_local std::string threadName;
+
+// a thread's ring is only made once it records something, so naming threads
+// costs nothing when tracing is off
+TraceRing &ThreadRing() {
+  if (!threadRing) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    rings.emplace_back(new TraceRing());
+    threadRing = rings.back().get();
+    threadRing->events.resize(ringSize);
+    threadRing->name = threadName;
+    threadRing->id = (int)rings.size();
+  }
+  return *threadRing;
+}
+
+// names are string literals, but keep the JSON valid whatever they hold
+void WriteJSONString(FILE *file, const char *text) {
+  fputc('"', file);
+  for (; *text; text++) {
+    if (*text == '"' || *text == '\\') {
+      fputc('\\', file);
+    }
+    if ((unsigned char)*text >= 0x20) {
+      fputc(*text, file);
+    }
+  }
+  fputc('"', file);
+}
+} // namespace
+
+void EnableTracing(size_t eventsPerThread) {
+  {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ringSize = std::max<size_t>(1, eventsPerThread);
+    if (traceStart == 0) {
+      traceStart = TraceNow();
+    }
+  }
+  tracing = true;
+}
+
+void DisableTracing() { tracing = false; }
+
+void SetTraceThreadName(const std::string &name) {
+  threadName = name;
+  if (threadRing) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    threadRing->name = name;
+  }
+}
+
+void RecordTraceZone(const char *name, uint64_t begin, uint64_t end) {
+  TraceRing &ring = ThreadRing();
+  uint64_t count = ring.count.load(std::memory_order_relaxed);
+  ring.events[count % ring.events.size()] = {name, begin, end};
+  ring.count.store(count + 1, std::memory_order_release);
+}
+
+void WriteChromeTrace(const std::string &filename) {
+  FILE *file = fopen(filename.c_str(), "w");
+  if (!file) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  for (const std::unique_ptr<TraceRing> &ring : rings) {
+    if (!ring->name.empty()) {
+      fprintf(file,
+              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"tid\":%d,\"args\":{\"name\":",
+              first ? "" : ",\n", ring->id);
+      WriteJSONString(file, ring->name.c_str());
+      fprintf(file, "}}");
+      first = false;
+    }
+
+    uint64_t count = ring->count.load(std::memory_order_acquire);
+    uint64_t size = ring->events.size();
+    for (uint64_t i = count > size ? count - size : 0; i < count; i++) {
+      const TraceEvent &event = ring->events[i % size];
+      // microseconds since tracing started, as the format wants
+      fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+      WriteJSONString(file, event.name);
+      fprintf(file,
+              ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+              ring->id, (int64_t)(event.begin - traceStart) * 1e-3,
+              (event.end - event.begin) * 1e-3);
+      first = false;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  if (fclose(file) != 0) {
+    throw std::runtime_error("failed to write file: " + filename);
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef PROFILING_TRACE_H
+#define PROFILING_TRACE_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped timers for the hot paths. TRACE_ZONE("name") times the rest of the
+// enclosing scope; each thread keeps its zones in a ring of its own, so
+// recording one never takes a lock or touches another thread's memory, and
+// once a ring is full the oldest zones go first. WriteChromeTrace() puts
+// every thread's zones in a Chrome trace JSON file, which chrome://tracing
+// and ui.perfetto.dev both open.
+//
+// Tracing starts off. While it is off a zone is one relaxed load and a
+// branch; building with F1TENTH_NO_TRACE takes the zones out entirely.
+
+extern std::atomic<bool> tracing;
+
+// starts recording, with room for eventsPerThread zones in each thread's ring
+void EnableTracing(size_t eventsPerThread = 1 << 16);
+void DisableTracing();
+// names the calling thread in the trace
+void SetTraceThreadName(const std::string &name);
+// every ring so far as Chrome trace JSON, best done while the traced threads
+// are idle. Throws std::runtime_error if filename can't be written
+void WriteChromeTrace(const std::string &filename);
+
+// nanoseconds on the trace's clock
+inline uint64_t TraceNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+// name has to outlive the trace, a string literal
+void RecordTraceZone(const char *name, uint64_t begin, uint64_t end);
+
+class TraceZone {
+public:
+  explicit TraceZone(const char *name)
+      : name(tracing.load(std::memory_order_relaxed) ? name : nullptr),
+        begin(this->name ? TraceNow() : 0) {}
+  ~TraceZone() {
+    if (name) {
+      RecordTraceZone(name, begin, TraceNow());
+    }
+  }
+  TraceZone(const TraceZone &) = delete;
+  TraceZone &operator=(const TraceZone &) = delete;
+
+private:
+  const char *name;
+  uint64_t begin;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#ifdef F1TENTH_NO_TRACE
+#define TRACE_ZONE(name)
+#else
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#endif
+
+#endif // PROFILING_TRACE_H
@@ -0,0 +1,803 @@
+#include "Autonomy.h"
+#include "../Control/ControlLoop.h"
+#include "../Control/LinearMPC.h"
+#include "../Control/PurePursuit.h"
+#include "../Control/Stanley.h"
+#include "../Infinite/backend/Software/BVH.h"
+#include "../Infinite/frontend/Camera.h"
+#include "../Planning/AnytimeAStar.h"
+#include "../Planning/DStarLite.h"
+#include "../Planning/HeuristicField.h"
+#include "../Planning/HybridAStar.h"
+#include "../Planning/JumpPointSearch.h"
+#include "../Planning/LatticePlanner.h"
+#include "../Planning/OccupancyGrid.h"
+#include "../Planning/PathSmoother.h"
+#include "../Planning/PlanBudget.h"
+#include "../Planning/PlanningService.h"
+#include "../Profiling/Metrics.h"
+#include "../Profiling/Trace.h"
+#include "../stlastar.h"
+#include "Determinism.h"
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <glm/fwd.hpp>
+#include <iostream>
+#include <ostream>
+#include <vector>
+
+// This code currently does not work, but the idea is to eventually get it to
+// work, currently it is much faster than the python version without much
+// optimization. Also this is probably the slowest it will get A* wise
+
+SimulationClock sim_clock(1000.0);
+float speed = 0.0f;
+float steeringAngle = 0.0f;
+
+template <typename T> int sgn(T val) { return (T(0) < val) - (val < T(0)); }
+
+Car car(0.0f, glm::radians(0.0f), 0.4f, 0.1f, 2.0f, 0.1f);
+glm::vec2 start_position{-1.0f, 0.9f};
+
+class MapSearchNode {
+public:
+  glm::vec2 pos;
+
+  MapSearchNode() { pos = {0, 0}; }
+  MapSearchNode(int px, int py) {
+    pos.x = px;
+    pos.y = py;
+  }
+
+  float GoalDistanceEstimate(MapSearchNode &nodeGoal);
+  bool IsGoal(MapSearchNode &nodeGoal);
+  bool GetSuccessors(AStarSearch<MapSearchNode> *astarsearch,
+                     MapSearchNode *parent_node);
+  float GetCost(MapSearchNode &successor);
+  bool IsSameState(MapSearchNode &rhs);
+  size_t Hash();
+
+  void PrintNodeInfo();
+};
+
+bool MapSearchNode::IsSameState(MapSearchNode &rhs) {
+
+  // same state in a maze search is simply when (x,y) are the same
+  if ((pos.x == rhs.pos.x) && (pos.y == rhs.pos.y)) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
+size_t MapSearchNode::Hash() {
+  size_t h1 = std::hash<float>{}(pos.x);
+  size_t h2 = std::hash<float>{}(pos.y);
+  return h1 ^ (h2 << 1);
+}
+
+void MapSearchNode::PrintNodeInfo() {
+  const int strSize = 100;
+  char str[strSize];
+  snprintf(str, strSize, "Node position : (%d,%d)\n", (int)pos.x, (int)pos.y);
+
+  std::cout << str;
+}
+
+// Here's the heuristic function that estimates the distance from a Node
+// to the Goal.
+
+float MapSearchNode::GoalDistanceEstimate(MapSearchNode &nodeGoal) {
+  return std::abs(pos.x - nodeGoal.pos.x) + std::abs(pos.y - nodeGoal.pos.y);
+}
+
+bool MapSearchNode::IsGoal(MapSearchNode &nodeGoal) {
+
+  if ((pos.x == nodeGoal.pos.x) && (pos.y == nodeGoal.pos.y)) {
+    return true;
+  }
+
+  return false;
+}
+
+// This generates the successors to the given Node. It uses a helper function
+// called AddSuccessor to give the successors to the AStar class. The A*
+// specific initialisation is done for each node internally, so here you just
+// set the state information that is specific to the application
+bool MapSearchNode::GetSuccessors(AStarSearch<MapSearchNode> *astarsearch,
+                                  MapSearchNode *parent_node) {
+
+  int parent_x = -1;
+  int parent_y = -1;
+
+  if (parent_node) {
+    parent_x = parent_node->pos.x;
+    parent_y = parent_node->pos.y;
+  }
+
+  MapSearchNode NewNode;
+
+  // push each possible move except allowing the search to go backwards
+  float search = GetMap(pos.x - 1, pos.y);
+  float current = GetMap(pos.x, pos.y);
+  if ((search < 9) && !((parent_x == pos.x - 1) && (parent_y == pos.y))) {
+    NewNode = MapSearchNode(pos.x - 1, pos.y);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  // search = GetMap(pos.x, pos.y - 1);
+  // if ((search < 9) && (current == 0 && search != 0) &&
+  //     !((parent_x == pos.x) && (parent_y == pos.y - 1))) {
+  //   NewNode = MapSearchNode(pos.x, pos.y - 1);
+  //   astarsearch->AddSuccessor(NewNode);
+  // }
+
+  search = GetMap(pos.x + 1, pos.y);
+  if ((search < 9) && !((parent_x == pos.x + 1) && (parent_y == pos.y))) {
+    NewNode = MapSearchNode(pos.x + 1, pos.y);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  search = GetMap(pos.x, pos.y + 1);
+  if ((search < 9) && !((parent_x == pos.x) && (parent_y == pos.y + 1))) {
+    NewNode = MapSearchNode(pos.x, pos.y + 1);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  search = GetMap(pos.x + 1, pos.y + 1);
+  if ((search < 9) && !((parent_x == pos.x) && (parent_y == pos.y + 1))) {
+    NewNode = MapSearchNode(pos.x, pos.y + 1);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  search = GetMap(pos.x - 1, pos.y + 1);
+  if ((search < 9) && !((parent_x == pos.x) && (parent_y == pos.y + 1))) {
+    NewNode = MapSearchNode(pos.x, pos.y + 1);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  search = GetMap(pos.x - 1, pos.y - 1);
+  if ((search < 9) && !((parent_x == pos.x) && (parent_y == pos.y + 1))) {
+    NewNode = MapSearchNode(pos.x, pos.y + 1);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  search = GetMap(pos.x + 1, pos.y - 1);
+  if ((search < 9) && !((parent_x == pos.x) && (parent_y == pos.y + 1))) {
+    NewNode = MapSearchNode(pos.x, pos.y + 1);
+    astarsearch->AddSuccessor(NewNode);
+  }
+
+  return true;
+}
+
+// given this node, what does it cost to move to successor. In the case
+// of our map the answer is the map terrain value at this node since that is
+// conceptually where we're moving
+
+float MapSearchNode::GetCost(MapSearchNode &successor) {
+  return (float)GetMap(pos.x, pos.x);
+}
+
+uint32_t astar_expansions = 0; // by the last astar() call
+
+std::vector<glm::vec2> astar(glm::vec2 start, glm::vec2 end,
+                             PlanBudget budget = PlanBudget()) {
+  TRACE_ZONE("astar");
+  astar_expansions = 0;
+  std::vector<glm::vec2> solution = {};
+
+  // Our sample problem defines the world as a 2d array representing a terrain
+  // Each element contains an integer from 0 to 5 which indicates the cost
+  // of travel across the terrain. Zero means the least possible difficulty
+  // in travelling (think ice rink if you can skate) whilst 5 represents the
+  // most difficult. 9 indicates that we cannot pass.
+
+  // Create an instance of the search class...
+
+  AStarSearch<MapSearchNode> astarsearch;
+
+  unsigned int SearchCount = 0;
+
+  const unsigned int NumSearches = 1;
+
+  while (SearchCount < NumSearches) {
+
+    // Create a start state
+    MapSearchNode nodeStart;
+    nodeStart.pos = start;
+
+    // Define the goal state
+    MapSearchNode nodeEnd;
+    nodeEnd.pos = end;
+    // Set Start and goal states
+
+    astarsearch.SetStartAndGoalStates(nodeStart, nodeEnd);
+
+    unsigned int SearchState;
+    unsigned int SearchSteps = 0;
+    budget.begin();
+
+    do {
+      // gives up (and returns no path) once the budget is spent
+      if (budget.exhausted()) {
+        astarsearch.CancelSearch();
+      }
+      SearchState = astarsearch.SearchStep();
+
+      SearchSteps++;
+
+#if DEBUG_LISTS
+
+      cout << "Steps:" << SearchSteps << "\n";
+
+      int len = 0;
+
+      cout << "Open:\n";
+      MapSearchNode *p = astarsearch.GetOpenListStart();
+      while (p) {
+        len++;
+#if !DEBUG_LIST_LENGTHS_ONLY
+        ((MapSearchNode *)p)->PrintNodeInfo();
+#endif
+        p = astarsearch.GetOpenListNext();
+      }
+
+      cout << "Open list has " << len << " nodes\n";
+
+      len = 0;
+
+      cout << "Closed:\n";
+      p = astarsearch.GetClosedListStart();
+      while (p) {
+        len++;
+#if !DEBUG_LIST_LENGTHS_ONLY
+        p->PrintNodeInfo();
+#endif
+        p = astarsearch.GetClosedListNext();
+      }
+
+      cout << "Closed list has " << len << " nodes\n";
+#endif
+
+    } while (SearchState == AStarSearch<MapSearchNode>::SEARCH_STATE_SEARCHING);
+
+    if (SearchState == AStarSearch<MapSearchNode>::SEARCH_STATE_SUCCEEDED) {
+      // std::cout << "Search found goal state\n";
+
+      MapSearchNode *node = astarsearch.GetSolutionStart();
+
+#if DISPLAY_SOLUTION
+      cout << "Displaying solution\n";
+#endif
+      int steps = 0;
+
+      // node->PrintNodeInfo();
+      solution.push_back(std::move(node->pos));
+      for (;;) {
+        node = astarsearch.GetSolutionNext();
+
+        if (!node) {
+          break;
+        }
+        solution.push_back(std::move(node->pos));
+        // node->PrintNodeInfo();
+        steps++;
+      };
+
+      // std::cout << "Solution steps " << steps << std::endl;
+
+      // Once you're done with the solution you can free the nodes up
+      astarsearch.FreeSolutionNodes();
+
+    } else if (SearchState == AStarSearch<MapSearchNode>::SEARCH_STATE_FAILED) {
+      // std::cout << "Search terminated. Did not find goal state\n";
+    }
+
+    // Display the number of loops the search went through
+    // std::cout << "SearchSteps : " << SearchSteps << "\n";
+    astar_expansions += SearchSteps;
+
+    SearchCount++;
+
+    astarsearch.EnsureMemoryFreed();
+  }
+
+  return solution;
+}
+
+// which planner update2() uses
+enum class PlannerMode {
+  ASTAR,
+  JPS,            // Jump Point Search, inflated cells cost the same as free
+  JPS_COST_AWARE, // Jump Point Search that still avoids inflated cells
+  DSTAR_LITE,     // repairs the last frame's search instead of starting over
+  LATTICE,        // only plans paths the car can actually drive
+  HYBRID_ASTAR,   // continuous poses, for tight spots the grid can't handle
+  ANYTIME,        // ARA*, best path so far within the budget, resumable
+  MULTI_GOAL,     // plans to every gap on the far edge, keeps the best
+};
+PlannerMode plannerMode = PlannerMode::ASTAR;
+
+const struct {
+  const char *name;
+  PlannerMode mode;
+} PLANNER_NAMES[] = {
+    {"astar", PlannerMode::ASTAR},
+    {"jps", PlannerMode::JPS},
+    {"jps_cost_aware", PlannerMode::JPS_COST_AWARE},
+    {"dstar_lite", PlannerMode::DSTAR_LITE},
+    {"lattice", PlannerMode::LATTICE},
+    {"hybrid_astar", PlannerMode::HYBRID_ASTAR},
+    {"anytime", PlannerMode::ANYTIME},
+    {"multi_goal", PlannerMode::MULTI_GOAL},
+};
+
+bool set_planner(const std::string &name) {
+  for (const auto &planner : PLANNER_NAMES) {
+    if (name == planner.name) {
+      plannerMode = planner.mode;
+      return true;
+    }
+  }
+  return false;
+}
+
+JumpPointSearch jps;
+
+DStarLite dstar;
+OccupancyGrid dstar_grid; // the grid as D* Lite last saw it
+std::vector<int> changed_cells;
+
+LatticePlanner lattice(car);
+
+HeuristicField heuristic_field; // rebuilt once per costmap
+HybridAStar hybrid(car);
+double planningBudget = 0.010; // seconds a single plan() call may take
+bool deterministic = false;
+uint32_t planningExpansions = 20000; // the budget instead, when deterministic
+
+// how long a single plan() call may search for. A time budget finds more on a
+// fast machine than on a slow one, so deterministic runs count expansions
+PlanBudget plan_budget() {
+  PlanBudget budget;
+  if (deterministic) {
+    budget.expansions = planningExpansions;
+  } else {
+    budget.seconds = planningBudget;
+  }
+  return budget;
+}
+
+AnytimeAStar anytime;
+// update2() builds each costmap here and swaps it in if it differs
+OccupancyGrid next_costmap(MAP_WIDTH, std::vector<int>(MAP_HEIGHT, FREE_CELL));
+
+PlanningService planning_service;
+std::vector<glm::vec2> candidate_goals;
+std::vector<PlanResult> candidate_results;
+const int lateralOffsetStep = 20;  // cells between the offset goals
+const float lateralPenalty = 0.5f; // per cell away from the requested goal
+
+// the middle of every gap along the far edge of the grid, plus goals stepped
+// sideways from end so there is always something to compare against
+void find_candidate_goals(glm::vec2 end, std::vector<glm::vec2> &goals) {
+  goals.clear();
+  const int row = MAP_HEIGHT - 1;
+  int gapStart = -1;
+  for (int x = 0; x <= MAP_WIDTH; x++) {
+    bool passable = x < MAP_WIDTH && IsPassable(occupancy_grid, x, row);
+    if (passable && gapStart < 0) {
+      gapStart = x;
+    } else if (!passable && gapStart >= 0) {
+      goals.push_back(glm::vec2((gapStart + x - 1) / 2, row));
+      gapStart = -1;
+    }
+  }
+  for (int x = (int)end.x % lateralOffsetStep; x < MAP_WIDTH;
+       x += lateralOffsetStep) {
+    goals.push_back(glm::vec2(x, row));
+  }
+}
+
+std::vector<glm::vec2> plan_multi_goal(glm::vec2 start, glm::vec2 end) {
+  find_candidate_goals(end, candidate_goals);
+  planning_service.run(occupancy_grid, costmap_version, start, candidate_goals,
+                       candidate_results);
+
+  int best = -1;
+  float bestScore = INFINITY;
+  for (size_t i = 0; i < candidate_results.size(); i++) {
+    float score = candidate_results[i].cost +
+                  lateralPenalty * std::abs(candidate_goals[i].x - end.x);
+    if (score < bestScore) {
+      bestScore = score;
+      best = (int)i;
+    }
+  }
+  if (best < 0) {
+    return {};
+  }
+  return candidate_results[best].path;
+}
+
+std::vector<glm::vec2> run_planner(glm::vec2 start, glm::vec2 end) {
+  switch (plannerMode) {
+  case PlannerMode::JPS:
+  case PlannerMode::JPS_COST_AWARE:
+    jps.costAware = plannerMode == PlannerMode::JPS_COST_AWARE;
+    return jps.search(occupancy_grid, start, end);
+  case PlannerMode::DSTAR_LITE:
+    changed_cells.clear();
+    DiffGrid(occupancy_grid, dstar_grid, changed_cells);
+    return dstar.search(occupancy_grid, start, end, changed_cells);
+  case PlannerMode::LATTICE:
+    // the grid is in the car's frame, so the car always faces down y
+    return lattice.search(occupancy_grid, start, M_PI / 2.0, end);
+  case PlannerMode::HYBRID_ASTAR:
+    heuristic_field.update(occupancy_grid, costmap_version, end);
+    return hybrid.search(occupancy_grid, heuristic_field, start, M_PI / 2.0,
+                         end, M_PI / 2.0, plan_budget());
+  case PlannerMode::ANYTIME:
+    anytime.plan(occupancy_grid, costmap_version, start, end, plan_budget());
+    return anytime.getPath();
+  case PlannerMode::MULTI_GOAL:
+    return plan_multi_goal(start, end);
+  case PlannerMode::ASTAR:
+  default:
+    return astar(start, end, plan_budget());
+  }
+}
+
+// nodes expanded by the last run_planner() call
+uint32_t expanded_nodes() {
+  switch (plannerMode) {
+  case PlannerMode::JPS:
+  case PlannerMode::JPS_COST_AWARE:
+    return jps.getExpandedNodes();
+  case PlannerMode::DSTAR_LITE:
+    return dstar.getExpandedNodes();
+  case PlannerMode::LATTICE:
+    return lattice.getExpandedNodes();
+  case PlannerMode::HYBRID_ASTAR:
+    return hybrid.getExpandedNodes();
+  case PlannerMode::ANYTIME:
+    return anytime.getExpandedNodes();
+  case PlannerMode::MULTI_GOAL: {
+    uint32_t expanded = 0;
+    for (const PlanResult &result : candidate_results) {
+      expanded += result.expandedNodes;
+    }
+    return expanded;
+  }
+  case PlannerMode::ASTAR:
+  default:
+    return astar_expansions;
+  }
+}
+
+std::vector<glm::vec2> plan(glm::vec2 start, glm::vec2 end) {
+  std::vector<glm::vec2> path;
+  {
+    LATENCY_SCOPE(PLAN_LATENCY);
+    path = run_planner(start, end);
+  }
+  CountMetric(ASTAR_EXPANSIONS, expanded_nodes());
+  return path;
+}
+
+PathSmoother path_smoother(car);
+bool smoothPaths = true; // steer along the smoothed path, not the raw cells
+
+// what update2() steers with
+enum class ControllerMode {
+  HEADING_CLAMP, // point the car at one cell along the path
+  PURE_PURSUIT,
+  STANLEY,
+  MPC,
+};
+ControllerMode controllerMode = ControllerMode::PURE_PURSUIT;
+
+const struct {
+  const char *name;
+  ControllerMode mode;
+} CONTROLLER_NAMES[] = {
+    {"heading_clamp", ControllerMode::HEADING_CLAMP},
+    {"pure_pursuit", ControllerMode::PURE_PURSUIT},
+    {"stanley", ControllerMode::STANLEY},
+    {"mpc", ControllerMode::MPC},
+};
+
+bool set_controller(const std::string &name) {
+  for (const auto &controller : CONTROLLER_NAMES) {
+    if (name == controller.name) {
+      controllerMode = controller.mode;
+      return true;
+    }
+  }
+  return false;
+}
+
+PurePursuit pure_pursuit(car);
+Stanley stanley(car);
+LinearMPC mpc(car);
+ControlLoop control_loop(car, 100.0);
+std::vector<glm::vec2> control_path; // metres, x forward and y to the left
+
+Controller *active_controller() {
+  switch (controllerMode) {
+  case ControllerMode::PURE_PURSUIT:
+    return &pure_pursuit;
+  case ControllerMode::STANLEY:
+    return &stanley;
+  case ControllerMode::MPC:
+    return &mpc;
+  default:
+    return nullptr;
+  }
+}
+
+// Optimized LIDAR to local coordinates function (1 & 4)
+// Sample i was cast at i half degrees counter-clockwise from world x (see
+// generateRaysAroundPoint()). The points come out in the frame of a car with
+// Car::heading robot_theta, x forward and y to its right
+std::vector<std::array<float, 2>>
+lidar_to_local(float robot_x, float robot_y, float robot_theta,
+               const std::vector<Ray> &lidar_samples) {
+  const int num_samples = LIDAR_RAYS;
+  std::vector<float> lidar_angles(num_samples);
+  std::vector<std::array<float, 2>> result;
+
+  // the car points along world angle M_PI - robot_theta, and y is mirrored
+  for (int i = 0; i < num_samples; ++i) {
+    lidar_angles[i] = M_PI - 2.0 * M_PI * i / num_samples - robot_theta;
+  }
+
+  // Use parallel loop to speed up processing of each sample
+  for (int i = 0; i < num_samples; ++i) {
+    // if (lidar_samples[i].t > 5) { // Skip invalid points
+    float x_local = lidar_samples[i].t * cos(lidar_angles[i]);
+    float y_local = lidar_samples[i].t * sin(lidar_angles[i]);
+    result.push_back({x_local, y_local});
+    // }
+  }
+
+  return result;
+}
+
+// Optimized concentric buffer function (2 & 3)
+// Every wall gets a plus shaped buffer: cells up to r1 away along a row or
+// column become walls and free cells up to r2 away become inflated. Each cell
+// only reads the walls as they were on the way in, so the rows (and then the
+// columns) can be split between threads without any of them writing a cell
+// another reads, and the new walls don't grow buffers of their own.
+void add_concentric_plus_buffers(std::vector<std::vector<int>> &array, int r1,
+                                 int r2) {
+  TRACE_ZONE("add_concentric_plus_buffers");
+  const int rows = array.size();
+  const int cols = array[0].size();
+  const int far = r2 + 1; // anything further away than r2 is just far
+
+  // distance to the nearest wall along the row and along the column
+  std::vector<int> alongRow(rows * cols);
+  std::vector<int> alongColumn(rows * cols);
+#pragma omp parallel for
+  for (int i = 0; i < rows; ++i) {
+    int d = far;
+    for (int j = 0; j < cols; ++j) {
+      d = array[i][j] == 9 ? 0 : std::min(d + 1, far);
+      alongRow[i * cols + j] = d;
+    }
+    d = far;
+    for (int j = cols - 1; j >= 0; --j) {
+      d = array[i][j] == 9 ? 0 : std::min(d + 1, far);
+      alongRow[i * cols + j] = std::min(alongRow[i * cols + j], d);
+    }
+  }
+#pragma omp parallel for
+  for (int j = 0; j < cols; ++j) {
+    int d = far;
+    for (int i = 0; i < rows; ++i) {
+      d = array[i][j] == 9 ? 0 : std::min(d + 1, far);
+      alongColumn[i * cols + j] = d;
+    }
+    d = far;
+    for (int i = rows - 1; i >= 0; --i) {
+      d = array[i][j] == 9 ? 0 : std::min(d + 1, far);
+      alongColumn[i * cols + j] = std::min(alongColumn[i * cols + j], d);
+    }
+  }
+
+#pragma omp parallel for
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      int d = std::min(alongRow[i * cols + j], alongColumn[i * cols + j]);
+      if (d <= r1) {
+        array[i][j] = 9;
+      } else if (d <= r2) {
+        array[i][j] = std::max(array[i][j], 1);
+      }
+    }
+  }
+}
+
+std::atomic<int> counter{0};
+std::atomic<bool> isDriving{false};
+std::array<float, 2> position{0.0f, 0.0f};
+std::atomic<float> angle{0.0f};
+std::array<float, 2> velocity{0.0f, 0.0f};
+
+void build_costmap(const std::vector<Ray> &scan, float heading,
+                   OccupancyGrid &grid) {
+  LATENCY_SCOPE(COSTMAP_LATENCY);
+  auto samples = lidar_to_local(0.0f, 0.0f, heading, scan);
+
+  for (auto &row : grid) {
+    std::fill(row.begin(), row.end(), 0);
+  }
+  // Initialize occupancy grid
+  // FLIP CORDS!!!!!
+  for (const auto &[x, y] : samples) {
+    int y_coord = static_cast<int>(x * CELLS_PER_METER);
+    int x_coord = static_cast<int>(y * CELLS_PER_METER) + MAP_WIDTH / 2;
+
+    if (x_coord >= 0 && x_coord < MAP_WIDTH && y_coord >= 0 &&
+        y_coord < MAP_HEIGHT) {
+      grid[x_coord][y_coord] = 9;
+    }
+  }
+
+  // this could be more efficient
+  add_concentric_plus_buffers(grid, COSTMAP_HARD_BUFFER, COSTMAP_SOFT_BUFFER);
+}
+
+void cells_to_control_path(const std::vector<glm::vec2> &cells,
+                           std::vector<glm::vec2> &path) {
+  // grid x runs to the car's right
+  path.clear();
+  for (const glm::vec2 &cell : cells) {
+    path.push_back(glm::vec2(cell.y / CELLS_PER_METER,
+                             (MAP_WIDTH / 2.0f - cell.x) / CELLS_PER_METER));
+  }
+}
+
+float drive_torque(const Car &car, float speed) {
+  return drive_torque(car.velocity, speed);
+}
+
+float drive_torque(float velocity, float speed) {
+  float inverseVelocity = std::abs(velocity);
+  return std::abs(speed) < 0.1f
+             ? sgn(velocity) * inverseVelocity * brakeTorqueScale
+             : speed * torque;
+}
+
+void update2(double deltaTime) {
+  TRACE_ZONE("update2");
+  LATENCY_SCOPE(AUTONOMY_LATENCY);
+  angle = angle + car.angularVelocity * deltaTime;
+
+  // std::array<std::array<float, 2>, 2> rotation_matrix = {
+  //     {{std::cos(angle), -std::sin(angle)},
+  //      {std::sin(angle), std::cos(angle)}}};
+  // auto acc_local =
+  //     std::array<float, 2>{rc::physics::get_linear_acceleration()[0],
+  //                          rc::physics::get_linear_acceleration()[2]};
+  // std::array<float, 2> acc_global{rotation_matrix[0][0] * acc_local[0] +
+  //                                     rotation_matrix[0][1] * acc_local[1],
+  //                                 rotation_matrix[1][0] * acc_local[0] +
+  //                                     rotation_matrix[1][1] * acc_local[1]};
+  // velocity[0] += acc_global[0] * deltaTime;
+  // velocity[1] += acc_global[1] * deltaTime;
+  // position[0] += velocity[0] * deltaTime;
+  // position[1] += velocity[1] * deltaTime;
+
+  // ARA*, the Hybrid-A* heuristic and the planning service start over when
+  // the version changes, so it only moves when the costmap really did
+  build_costmap(LIDAR, car.heading, next_costmap);
+  if (next_costmap != occupancy_grid) {
+    occupancy_grid.swap(next_costmap);
+    costmap_version++;
+  }
+
+  glm::vec2 start = {MAP_WIDTH / 2, 0};
+  glm::vec2 end = {MAP_WIDTH / 2, MAP_HEIGHT};
+  std::vector<glm::vec2> rawPath = plan(start, end);
+  // resampled one cell apart, so path[car_size] is still car_size cells ahead
+  const std::vector<glm::vec2> &path =
+      smoothPaths ? path_smoother.smooth(occupancy_grid, rawPath) : rawPath;
+
+  float drive = 0.1f;
+  cells_to_control_path(path, control_path);
+  if (controllerMode != ControllerMode::HEADING_CLAMP) {
+    control_loop.setController(active_controller());
+    control_loop.setPath(control_path);
+    float steer = control_loop.step(deltaTime, car.velocity);
+    // steeringAngle is a fraction of full lock, positive to the right
+    speed = drive;
+    steeringAngle = -steer / glm::radians(Car::maxSteeringDegrees);
+    return;
+  }
+
+  // heading of the path car_size cells ahead, M_PI / 2 straight on and larger
+  // to the right, since grid y runs forward and grid x to the car's right
+  int car_size = 15;
+  float heading = M_PI / 2.0;
+  if (path.size() > car_size) {
+    heading = atan2(path[car_size].y, MAP_WIDTH / 2.0f - path[car_size].x);
+  } else if (path.size() > 0) {
+    heading = atan2(path[path.size() - 1][1],
+                    MAP_WIDTH / 2.0f - path[path.size() - 1][0]);
+  }
+
+  angle = heading - M_PI / 2.0;
+
+  float multiplier = 4.0f;
+  float clamped_angle =
+      std::max(std::min(angle * multiplier, 1.0f), -1.0f); // Clamp angle
+  speed = drive;
+  steeringAngle = clamped_angle;
+}
+
+uint64_t autonomy_interval() {
+  return std::max<uint64_t>(1, std::llround(deltaTime / sim_clock.getStep()));
+}
+
+void reset_car() {
+  Infinite::cameras.setPositon(glm::vec3(start_position, -0.05f));
+  car.velocity = 0;
+  car.position = 0;
+  car.angularVelocity = 0;
+  car.acceleration = 0;
+}
+
+void place_car(glm::vec2 position, float heading) {
+  start_position = position;
+  car.heading = heading;
+  reset_car();
+  Infinite::cameras.setAngles(car.heading + M_PI / 2.0, -M_PI / 2.0);
+}
+
+TrajectoryStep trajectory_step() {
+  TrajectoryStep step;
+  step.position = Infinite::cameras.getPosition();
+  step.heading = car.heading;
+  step.velocity = car.velocity;
+  step.acceleration = car.acceleration;
+  step.angularVelocity = car.angularVelocity;
+  step.speed = speed;
+  step.steeringAngle = steeringAngle;
+  return step;
+}
+
+uint64_t hash_state(uint64_t previous, bool sensed) {
+  StateHash hash(previous);
+  hash.add(car.position).add(car.heading).add(car.velocity);
+  hash.add(car.acceleration).add(car.angularVelocity);
+  hash.add(Infinite::cameras.getPosition()).add(Infinite::cameras.getAngles());
+  hash.add(speed).add(steeringAngle);
+  if (sensed) {
+    for (const Ray &ray : LIDAR) {
+      hash.add(ray.t);
+    }
+    for (const std::vector<int> &row : occupancy_grid) {
+      hash.add(row.data(), row.size() * sizeof(int));
+    }
+  }
+  return hash.get();
+}
+
+void physics_step(double step) {
+  // "drive" the car/camera
+  float carPos;
+  {
+    TRACE_ZONE("car.update");
+    LATENCY_SCOPE(PHYSICS_LATENCY);
+    carPos = car.update(steeringAngle * Car::maxSteeringDegrees,
+                        drive_torque(car, speed), step);
+  }
+  Infinite::cameras.move(carPos, Infinite::FORWARD);
+  Infinite::cameras.setAngles(car.heading + M_PI / 2.0, -M_PI / 2.0);
+}
@@ -0,0 +1,97 @@
+#ifndef SIMULATION_AUTONOMY_H
+#define SIMULATION_AUTONOMY_H
+
+#pragma once
+
+#include "../Infinite/backend/Software/BVH.h"
+#include "../Infinite/frontend/Car.h"
+#include "../Infinite/frontend/SimulationClock.h"
+#include "../Planning/OccupancyGrid.h"
+#include "TrajectoryLog.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <string>
+#include <vector>
+
+// The car and everything that drives it: the LIDAR costmap, the planners and
+// the controllers update2() picks between, and the physics step. None of it
+// needs a window or a GPU, so the windowed and the headless loops share it.
+
+const float torque = 0.010f;          // Torque applied to the wheels (Nm)
+const float deltaTime = 1.0f / 60.0f; // Time between autonomy updates (seconds)
+const float brakeTorqueScale = -0.2f;
+
+// cells around every wall in a costmap that are BLOCKED_CELL, then
+// INFLATED_CELL, counted along a row or a column
+const int COSTMAP_HARD_BUFFER = 1;
+const int COSTMAP_SOFT_BUFFER = 5;
+
+extern SimulationClock sim_clock; // physics steps per second
+extern float speed;
+extern float steeringAngle; // fraction of full lock, positive to the right
+
+extern Car car;
+// where reset_car() puts the car back, the camera's start unless place_car()
+// moved it
+extern glm::vec2 start_position;
+// the last path update2() planned, metres in the frame of the car when it
+// was planned, x forward and y to the left
+extern std::vector<glm::vec2> control_path;
+
+// Determinism mode: planners stop after a number of expansions instead of a
+// number of seconds, so what the car does doesn't depend on how fast the
+// machine is or how busy it was, and a run can hash its state every step.
+// Everything else (the fixed step, the LIDAR and costmap loops) already comes
+// out the same for any number of threads
+extern bool deterministic;
+extern uint32_t planningExpansions; // per plan() call when deterministic
+
+// builds the costmap from the last LIDAR scan, plans across it and sets speed
+// and steeringAngle to follow the path
+void update2(double deltaTime);
+
+// picks update2()'s planner: astar, jps, jps_cost_aware, dstar_lite, lattice,
+// hybrid_astar, anytime or multi_goal. False if there is none by that name
+bool set_planner(const std::string &name);
+// picks what update2() steers along the path with: heading_clamp,
+// pure_pursuit, stanley or mpc. False if there is none by that name
+bool set_controller(const std::string &name);
+
+// the pieces of update2() that don't depend on its globals, for anything
+// that runs its own car
+
+// marks every LIDAR hit in grid and inflates the walls. The grid is in the
+// frame of the car the scan was traced from, heading its Car::heading: grid y
+// runs forward from the car and grid x to its right
+void build_costmap(const std::vector<Ray> &scan, float heading,
+                   OccupancyGrid &grid);
+// the inflating: array's BLOCKED_CELLs are the walls, and it can be any size
+void add_concentric_plus_buffers(std::vector<std::vector<int>> &array, int r1,
+                                 int r2);
+// a planned path in cells to metres in the car's frame for the controllers
+void cells_to_control_path(const std::vector<glm::vec2> &cells,
+                           std::vector<glm::vec2> &path);
+// wheel torque for a speed command, braking to a stop when it is near 0
+float drive_torque(const Car &car, float speed);
+// the same for a car going at velocity, for cars kept in a CarBatch
+float drive_torque(float velocity, float speed);
+
+// physics steps between two autonomy updates at the clock's current rate
+uint64_t autonomy_interval();
+
+// stops the car and puts it (and the camera riding on it) back at the start
+void reset_car();
+// makes position the start, and puts the car there facing heading
+void place_car(glm::vec2 position, float heading);
+
+// drives the car and the camera one physics step with speed and steeringAngle
+void physics_step(double step);
+
+// the car, camera and commands as they are now, for TrajectoryRecorder
+TrajectoryStep trajectory_step();
+
+// previous with the car, camera and commands after a step hashed in, and the
+// LIDAR scan and costmap too if the step sensed
+uint64_t hash_state(uint64_t previous, bool sensed);
+
+#endif // SIMULATION_AUTONOMY_H
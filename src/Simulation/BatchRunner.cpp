@@ -0,0 +1,161 @@
+#include "BatchRunner.h"
+#include "Autonomy.h"
+#include "../Profiling/Trace.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+struct Field {
+  const char *name;
+  float EpisodeConfig::*member;
+};
+
+const Field FIELDS[] = {
+    {"start_heading", &EpisodeConfig::startHeading},
+    {"start_jitter", &EpisodeConfig::startJitter},
+    {"heading_jitter", &EpisodeConfig::headingJitter},
+    {"min_lookahead", &EpisodeConfig::minLookahead},
+    {"lookahead_gain", &EpisodeConfig::lookaheadGain},
+    {"stanley_gain", &EpisodeConfig::stanleyGain},
+    {"speed", &EpisodeConfig::speed},
+    {"lap_radius", &EpisodeConfig::lapRadius},
+    {"lap_departure", &EpisodeConfig::lapDeparture},
+    {"lidar_noise", &EpisodeConfig::lidarNoise},
+};
+
+// false if name isn't a field
+bool SetField(EpisodeConfig &config, const std::string &name,
+              const std::string &value) {
+  std::istringstream in(value);
+  bool parsed = false;
+  if (name == "seed") {
+    parsed = bool(in >> config.seed);
+  } else if (name == "start_x") {
+    parsed = bool(in >> config.start.x);
+  } else if (name == "start_y") {
+    parsed = bool(in >> config.start.y);
+  } else if (name == "seconds") {
+    parsed = bool(in >> config.seconds);
+  } else if (name == "controller") {
+    parsed = value == "pure_pursuit" || value == "stanley";
+    config.controller = value == "stanley" ? EpisodeConfig::STANLEY
+                                           : EpisodeConfig::PURE_PURSUIT;
+  } else if (name == "vehicle") {
+    parsed = ParseVehicleType(value, config.vehicle);
+  } else if (name == "vehicle_params") {
+    config.vehicleParams = LoadVehicleParams(value);
+    parsed = true;
+  } else {
+    for (const Field &field : FIELDS) {
+      if (name == field.name) {
+        parsed = bool(in >> config.*field.member);
+      }
+    }
+  }
+  return parsed;
+}
+} // namespace
+
+BatchResult RunBatch(const std::vector<EpisodeConfig> &configs, int threads) {
+  BatchResult result;
+  result.summaries.resize(configs.size());
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min<int>(threads, std::max<size_t>(1, configs.size()));
+  result.threads = threads;
+
+  const double step = sim_clock.getStep();
+  const uint64_t autonomyInterval = autonomy_interval();
+  std::atomic<size_t> next{0};
+
+  auto worker = [&]() {
+#ifdef _OPENMP
+    // the episodes are the parallelism, the LIDAR and costmap loops inside
+    // them would only fight each other for the same cores
+    omp_set_num_threads(1);
+#endif
+    SetTraceThreadName("episodes");
+    for (size_t i = next++; i < configs.size(); i = next++) {
+      Episode episode(configs[i], step, autonomyInterval);
+      result.summaries[i] = episode.run();
+    }
+  };
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  for (std::thread &thread : workers) {
+    thread.join();
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+
+  for (const EpisodeSummary &summary : result.summaries) {
+    result.steps += summary.steps;
+  }
+  return result;
+}
+
+std::vector<EpisodeConfig> LoadEpisodeConfigs(const std::string &filename,
+                                              const EpisodeConfig &defaults) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  std::vector<EpisodeConfig> configs;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    std::istringstream words(line.substr(0, line.find('#')));
+    EpisodeConfig config = defaults;
+    bool any = false;
+    std::string word;
+    while (words >> word) {
+      size_t equals = word.find('=');
+      std::string name = word.substr(0, equals);
+      std::string value =
+          equals == std::string::npos ? std::string() : word.substr(equals + 1);
+      if (!SetField(config, name, value)) {
+        throw std::runtime_error(filename + ":" + std::to_string(lineNumber) +
+                                 ": bad episode setting " + word);
+      }
+      any = true;
+    }
+    if (any) {
+      configs.push_back(config);
+    }
+  }
+  return configs;
+}
+
+void WriteEpisodeSummaries(const std::string &filename,
+                           const std::vector<EpisodeSummary> &summaries) {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  file << "episode,seed,steps,laps,lap_time,collisions,min_clearance,"
+          "distance,hash\n";
+  for (size_t i = 0; i < summaries.size(); i++) {
+    const EpisodeSummary &s = summaries[i];
+    file << i << ',' << s.seed << ',' << s.steps << ',' << s.laps << ','
+         << s.lapTime << ',' << s.collisions << ',' << s.minClearance << ','
+         << s.distance << ',' << std::hex << std::setw(16)
+         << std::setfill('0') << s.hash << std::dec << '\n';
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef SIMULATION_BATCH_RUNNER_H
+#define SIMULATION_BATCH_RUNNER_H
+
+#pragma once
+
+#include "Episode.h"
+#include <string>
+#include <vector>
+
+struct BatchResult {
+  std::vector<EpisodeSummary> summaries; // in the same order as the configs
+  uint64_t steps = 0;                    // over every episode
+  double seconds = 0.0;                  // wall clock
+  int threads = 0;
+
+  double getStepsPerSecond() const { return seconds > 0 ? steps / seconds : 0; }
+};
+
+// Runs every episode to the end, as fast as the cores allow. Each worker
+// thread takes the next episode nobody has started until there are none
+// left, so uneven episodes still keep every core busy. The BVH has to be
+// built (UpdateBoundingVolumeHierarchy) before this is called.
+//
+// threads is 0 for one per core. Steps are at sim_clock's rate.
+BatchResult RunBatch(const std::vector<EpisodeConfig> &configs,
+                     int threads = 0);
+
+// one episode per line, as space separated "name=value" over defaults, e.g.
+//   seed=3 controller=stanley stanley_gain=1.5 speed=0.2
+//   seed=4 vehicle=dynamic vehicle_params=../config/f1tenth.cfg
+// # starts a comment. Throws std::runtime_error if the file can't be read or
+// has a name it doesn't know
+std::vector<EpisodeConfig> LoadEpisodeConfigs(const std::string &filename,
+                                              const EpisodeConfig &defaults);
+
+// one CSV row per episode, with a header
+void WriteEpisodeSummaries(const std::string &filename,
+                           const std::vector<EpisodeSummary> &summaries);
+
+#endif // SIMULATION_BATCH_RUNNER_H
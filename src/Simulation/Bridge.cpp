@@ -0,0 +1,250 @@
+#include "Bridge.h"
+#include "../Profiling/Metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "the bridge is shared between processes, so it can't use locks");
+
+// shm_open() wants exactly one leading slash
+std::string SegmentName(const std::string &name) {
+  return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+// the writing half of a slot's sequence lock: odd while writing, then 2 * n
+template <typename Slot, typename Fill>
+void WriteSlot(Slot &slot, uint64_t n, Fill fill) {
+  slot.sequence.store(2 * n - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  fill(slot);
+  slot.sequence.store(2 * n, std::memory_order_release);
+}
+
+// spins, then yields, until done() or timeoutSeconds have passed
+template <typename Done> bool SpinUntil(double timeoutSeconds, Done done) {
+  auto deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(timeoutSeconds));
+  for (int spins = 0; !done(); spins++) {
+    if (spins < 1000) {
+      continue;
+    }
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+} // namespace
+
+#ifdef _WIN32
+Bridge::Bridge(const std::string &name, BridgeMode mode, double stepSeconds,
+               double scanSeconds)
+    : name(name), mode(mode) {
+  throw std::runtime_error("the shared memory bridge needs POSIX: " + name);
+}
+
+Bridge::~Bridge() {}
+
+BridgeClient::BridgeClient(const std::string &name) {
+  throw std::runtime_error("the shared memory bridge needs POSIX: " + name);
+}
+
+BridgeClient::~BridgeClient() {}
+#else
+Bridge::Bridge(const std::string &name, BridgeMode mode, double stepSeconds,
+               double scanSeconds)
+    : name(SegmentName(name)), mode(mode) {
+  int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open shared memory: " + this->name);
+  }
+  // whatever an earlier run left in it is gone
+  void *memory = MAP_FAILED;
+  if (ftruncate(fd, 0) == 0 && ftruncate(fd, sizeof(BridgeSegment)) == 0) {
+    memory = mmap(nullptr, sizeof(BridgeSegment), PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(this->name.c_str());
+    throw std::runtime_error("failed to map shared memory: " + this->name);
+  }
+
+  segment = new (memory) BridgeSegment();
+  memcpy(segment->magic, BRIDGE_MAGIC, sizeof(segment->magic));
+  segment->version = BRIDGE_VERSION;
+  segment->mode = mode;
+  segment->stepSeconds = stepSeconds;
+  segment->scanSeconds = scanSeconds;
+  // generateRaysAroundPoint()'s rays
+  segment->angleMin = 0.0f;
+  segment->angleIncrement = 0.5f * (float)M_PI / 180.0f;
+  segment->running.store(1, std::memory_order_release);
+}
+
+Bridge::~Bridge() {
+  segment->running.store(0, std::memory_order_release);
+  munmap(segment, sizeof(BridgeSegment));
+  shm_unlink(name.c_str());
+}
+
+BridgeClient::BridgeClient(const std::string &name) {
+  std::string segmentName = SegmentName(name);
+  int fd = shm_open(segmentName.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    throw std::runtime_error("no bridge open as " + segmentName);
+  }
+  void *memory = mmap(nullptr, sizeof(BridgeSegment), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error("failed to map shared memory: " + segmentName);
+  }
+  segment = (BridgeSegment *)memory;
+  if (memcmp(segment->magic, BRIDGE_MAGIC, sizeof(segment->magic)) != 0 ||
+      segment->version != BRIDGE_VERSION) {
+    munmap(memory, sizeof(BridgeSegment));
+    throw std::runtime_error("the bridge in " + segmentName +
+                             " is from an incompatible build");
+  }
+  // a stack that starts late picks up from the newest scan
+  scansRead = segment->scansWritten.load(std::memory_order_acquire);
+  if (scansRead > 0 && segment->mode == BRIDGE_LOCKSTEP) {
+    scansRead--;
+  }
+  commands = segment->commandsWritten.load(std::memory_order_acquire);
+}
+
+BridgeClient::~BridgeClient() { munmap(segment, sizeof(BridgeSegment)); }
+#endif
+
+void Bridge::publish(const TrajectoryStep &state, uint64_t step, double time,
+                     uint64_t resets, const std::vector<Ray> &scan) {
+  uint64_t n = ++scans;
+  WriteSlot(segment->scans[(n - 1) % BRIDGE_SLOTS], n, [&](BridgeScan &slot) {
+    slot.scan = n;
+    slot.step = step;
+    slot.time = time;
+    slot.resets = resets;
+    slot.x = state.position.x;
+    slot.y = state.position.y;
+    slot.z = state.position.z;
+    slot.heading = state.heading;
+    slot.velocity = state.velocity;
+    slot.acceleration = state.acceleration;
+    slot.angularVelocity = state.angularVelocity;
+    slot.steeringAngle = state.steeringAngle;
+    slot.rays = (uint32_t)std::min<size_t>(scan.size(), BRIDGE_MAX_RAYS);
+    for (uint32_t i = 0; i < slot.rays; i++) {
+      slot.ranges[i] = scan[i].t;
+    }
+  });
+  publishedAt[(n - 1) % BRIDGE_SLOTS] = TraceNow();
+  segment->scansWritten.store(n, std::memory_order_release);
+}
+
+bool Bridge::take(BridgeCommand &command) {
+  for (;;) {
+    uint64_t written = segment->commandsWritten.load(std::memory_order_acquire);
+    if (written == commandsRead) {
+      return false;
+    }
+    // only the newest one matters, the ones before it are stale already
+    const BridgeCommand &slot = segment->commands[(written - 1) % BRIDGE_SLOTS];
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    command.scan = slot.scan;
+    command.steeringAngle = slot.steeringAngle;
+    command.speed = slot.speed;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (before == 2 * written &&
+        slot.sequence.load(std::memory_order_relaxed) == before) {
+      commandsRead = written;
+      if (command.scan <= scans && scans - command.scan < BRIDGE_SLOTS &&
+          command.scan > 0) {
+        RecordLatency(BRIDGE_LATENCY,
+                      TraceNow() - publishedAt[(command.scan - 1) %
+                                               BRIDGE_SLOTS]);
+      }
+      return true;
+    }
+    // the client lapped the ring while this was being read, try its newest
+  }
+}
+
+bool Bridge::poll(float &steeringAngle, float &speed) {
+  BridgeCommand command;
+  if (!take(command)) {
+    return false;
+  }
+  steeringAngle = command.steeringAngle;
+  speed = command.speed;
+  return true;
+}
+
+void Bridge::wait(float &steeringAngle, float &speed, double timeoutSeconds) {
+  BridgeCommand command;
+  command.scan = 0;
+  bool answered = SpinUntil(timeoutSeconds, [&] {
+    return take(command) && command.scan >= scans;
+  });
+  if (!answered) {
+    throw std::runtime_error("no command from the bridge client for scan " +
+                             std::to_string(scans));
+  }
+  steeringAngle = command.steeringAngle;
+  speed = command.speed;
+}
+
+const BridgeScan *BridgeClient::next(double timeoutSeconds) {
+  uint64_t written = 0;
+  bool arrived = SpinUntil(timeoutSeconds, [&] {
+    written = segment->scansWritten.load(std::memory_order_acquire);
+    return written > scansRead || !isRunning();
+  });
+  if (!arrived || written <= scansRead) {
+    return nullptr;
+  }
+  // in lockstep the simulator never gets more than one scan ahead, free
+  // running the newest is the one worth reading
+  scansRead = segment->mode == BRIDGE_LOCKSTEP &&
+                      written - scansRead < BRIDGE_SLOTS
+                  ? scansRead + 1
+                  : written;
+  return &segment->scans[(scansRead - 1) % BRIDGE_SLOTS];
+}
+
+bool BridgeClient::isValid() const {
+  if (scansRead == 0) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return segment->scans[(scansRead - 1) % BRIDGE_SLOTS].sequence.load(
+             std::memory_order_relaxed) == 2 * scansRead;
+}
+
+void BridgeClient::send(float steeringAngle, float speed) {
+  uint64_t n = ++commands;
+  WriteSlot(segment->commands[(n - 1) % BRIDGE_SLOTS], n,
+            [&](BridgeCommand &slot) {
+              slot.scan = scansRead;
+              slot.steeringAngle = steeringAngle;
+              slot.speed = speed;
+            });
+  segment->commandsWritten.store(n, std::memory_order_release);
+}
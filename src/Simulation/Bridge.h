@@ -0,0 +1,153 @@
+#ifndef SIMULATION_BRIDGE_H
+#define SIMULATION_BRIDGE_H
+
+#pragma once
+
+#include "../Infinite/backend/Software/BVH.h"
+#include "TrajectoryLog.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lets an autonomy stack in another process drive the car instead of
+// update2(). The simulator publishes every LIDAR scan, with the car's
+// odometry and its ground truth pose, into a ring in a named shared memory
+// segment; the stack reads them where they are and writes steering and speed
+// commands into a second ring the simulator reads back. Nothing is copied
+// through a socket or serialised, and neither side takes a lock.
+//
+// Both rings are single producer, single consumer. Each slot has a sequence
+// that is odd while it is being written, so a reader can tell whether the
+// slot it read from was overwritten under it (see BridgeClient::isValid()).
+//
+// In LOCKSTEP mode the simulator waits for the command answering each scan
+// before stepping on, so a deterministic stack gives deterministic runs at
+// whatever speed it manages. In FREE_RUNNING mode the simulator runs against
+// the wall clock, never waits, and uses whichever command came in last, to
+// see how the stack copes with its own latency. Either way the time from a
+// scan being published to its command coming back goes into BRIDGE_LATENCY,
+// see Metrics.h.
+
+enum BridgeMode : uint32_t { BRIDGE_LOCKSTEP, BRIDGE_FREE_RUNNING };
+
+const char BRIDGE_MAGIC[8] = "F1TBRDG";
+const uint32_t BRIDGE_VERSION = 1;
+const int BRIDGE_SLOTS = 8;        // scans and commands each ring holds
+const int BRIDGE_MAX_RAYS = 1024; // ranges a scan has room for
+
+// One LIDAR scan and the car when it was taken. Ray i points at world angle
+// angleMin + i * angleIncrement (see BridgeSegment), not relative to the car;
+// the car faces along world angle pi - heading.
+struct BridgeScan {
+  std::atomic<uint64_t> sequence; // 2 * scan once written, odd while writing
+  uint64_t scan;                  // counting from 1
+  uint64_t step;                  // physics steps so far
+  double time;                    // simulated seconds
+  uint64_t resets;                // times the car has crashed and been reset
+
+  // ground truth
+  float x, y, z;
+  float heading; // radians
+
+  // odometry, what the car itself would know
+  float velocity;        // m/s along its heading
+  float acceleration;    // m/s^2
+  float angularVelocity; // rad/s
+  float steeringAngle;   // the command it is executing
+
+  uint32_t rays;
+  float ranges[BRIDGE_MAX_RAYS]; // metres, INFINITY where nothing was hit
+};
+
+// what the stack wants the car to do after a scan
+struct BridgeCommand {
+  std::atomic<uint64_t> sequence; // 2 * command once written, odd while writing
+  uint64_t scan;                  // the BridgeScan::scan it answers
+  float steeringAngle; // fraction of full lock, positive to the right
+  float speed;         // the same units as update2()'s speed
+};
+
+// The whole shared memory segment. It is all plain data and lock free 64 bit
+// atomics, so a client in C or Python can map it by these offsets.
+struct BridgeSegment {
+  char magic[8];
+  uint32_t version;
+  uint32_t mode;        // a BridgeMode
+  double stepSeconds;   // one physics step
+  double scanSeconds;   // simulated time between scans
+  float angleMin;       // world angle of ray 0, radians
+  float angleIncrement; // between rays
+  std::atomic<uint32_t> running; // cleared when the simulator stops
+
+  alignas(64) std::atomic<uint64_t> scansWritten;
+  alignas(64) std::atomic<uint64_t> commandsWritten;
+  alignas(64) BridgeScan scans[BRIDGE_SLOTS];
+  alignas(64) BridgeCommand commands[BRIDGE_SLOTS];
+};
+
+// the simulator's side
+class Bridge {
+public:
+  // Makes the shared memory segment name ("/f1tenth-bridge"). Throws
+  // std::runtime_error if it can't
+  Bridge(const std::string &name, BridgeMode mode, double stepSeconds,
+         double scanSeconds);
+  ~Bridge();
+  Bridge(const Bridge &) = delete;
+  Bridge &operator=(const Bridge &) = delete;
+
+  BridgeMode getMode() const { return mode; }
+
+  void publish(const TrajectoryStep &state, uint64_t step, double time,
+               uint64_t resets, const std::vector<Ray> &scan);
+  // the newest command since the last call, false if none came in
+  bool poll(float &steeringAngle, float &speed);
+  // waits for the command answering the last scan published. Throws
+  // std::runtime_error if none comes within timeoutSeconds
+  void wait(float &steeringAngle, float &speed, double timeoutSeconds);
+
+private:
+  BridgeSegment *segment = nullptr;
+  std::string name;
+  BridgeMode mode;
+  uint64_t scans = 0;
+  uint64_t commandsRead = 0;
+  uint64_t publishedAt[BRIDGE_SLOTS] = {}; // TraceNow() of each scan
+
+  // the newest command since the last call, false if there is none
+  bool take(BridgeCommand &command);
+};
+
+// the autonomy stack's side
+class BridgeClient {
+public:
+  // maps the segment a Bridge made. Throws std::runtime_error if there is
+  // none, or it's from an incompatible build
+  explicit BridgeClient(const std::string &name);
+  ~BridgeClient();
+  BridgeClient(const BridgeClient &) = delete;
+  BridgeClient &operator=(const BridgeClient &) = delete;
+
+  const BridgeSegment &getSegment() const { return *segment; }
+  bool isRunning() const {
+    return segment->running.load(std::memory_order_acquire) != 0;
+  }
+
+  // The next scan in lockstep, the newest one when free running, to be read
+  // in place. nullptr if nothing new came within timeoutSeconds or the
+  // simulator stopped
+  const BridgeScan *next(double timeoutSeconds);
+  // true if the scan next() returned wasn't overwritten while it was being
+  // read; check it after reading and before trusting what was read
+  bool isValid() const;
+  // answers the scan next() returned
+  void send(float steeringAngle, float speed);
+
+private:
+  BridgeSegment *segment = nullptr;
+  uint64_t scansRead = 0; // the number of the scan next() returned
+  uint64_t commands = 0;
+};
+
+#endif // SIMULATION_BRIDGE_H
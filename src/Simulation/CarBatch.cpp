@@ -0,0 +1,93 @@
+#include "CarBatch.h"
+#include "../Profiling/Trace.h"
+#include <algorithm>
+#include <cmath>
+
+void CarBatch::clear() {
+  steeringTan.clear();
+  torque.clear();
+  position.clear();
+  heading.clear();
+  velocity.clear();
+  acceleration.clear();
+  angularVelocity.clear();
+  wheelbase.clear();
+  wheelRadius.clear();
+  mass.clear();
+}
+
+size_t CarBatch::add(const Car &car) {
+  steeringTan.push_back(0.0f);
+  torque.push_back(0.0f);
+  position.push_back(car.position);
+  heading.push_back(car.heading);
+  velocity.push_back(car.velocity);
+  acceleration.push_back(car.acceleration);
+  angularVelocity.push_back(car.angularVelocity);
+  wheelbase.push_back(car.wheelbase);
+  wheelRadius.push_back(car.wheelRadius);
+  mass.push_back(car.mass);
+  return size() - 1;
+}
+
+void CarBatch::set(size_t index, const Car &car) {
+  position[index] = car.position;
+  heading[index] = car.heading;
+  velocity[index] = car.velocity;
+  acceleration[index] = car.acceleration;
+  angularVelocity[index] = car.angularVelocity;
+  wheelbase[index] = car.wheelbase;
+  wheelRadius[index] = car.wheelRadius;
+  mass[index] = car.mass;
+}
+
+void CarBatch::store(size_t index, Car &car) const {
+  car.position = position[index];
+  car.heading = heading[index];
+  car.velocity = velocity[index];
+  car.acceleration = acceleration[index];
+  car.angularVelocity = angularVelocity[index];
+}
+
+void CarBatch::setSteering(size_t index, float steeringAngleDegrees) {
+  steeringAngleDegrees =
+      std::clamp(steeringAngleDegrees, -Car::maxSteeringDegrees,
+                 Car::maxSteeringDegrees);
+  steeringTan[index] = std::tan(glm::radians(steeringAngleDegrees));
+}
+
+// CMake builds this file with -fno-trapping-math, without which GCC won't
+// turn the clamp and the stop into selects and the loop stays scalar
+void CarBatch::update(float deltaTime) {
+  TRACE_ZONE("CarBatch::update");
+  const int count = (int)size();
+  const float *__restrict tangent = steeringTan.data();
+  const float *__restrict torqueIn = torque.data();
+  const float *__restrict L = wheelbase.data();
+  const float *__restrict radius = wheelRadius.data();
+  const float *__restrict m = mass.data();
+  float *__restrict moved = position.data();
+  float *__restrict yaw = heading.data();
+  float *__restrict vel = velocity.data();
+  float *__restrict acc = acceleration.data();
+  float *__restrict yawRate = angularVelocity.data();
+
+#pragma omp simd
+  for (int i = 0; i < count; i++) {
+    float a = torqueIn[i] / radius[i] / m[i];
+    float v = std::clamp(vel[i] + a * deltaTime, -0.6f, 0.6f);
+    // the stop Car::update() snaps to
+    bool stopped = std::abs(v) < 1e-4 && a * v <= 0.0f;
+    v = stopped ? 0.0f : v;
+    a = stopped ? 0.0f : a;
+
+    float w = v * tangent[i] / L[i];
+    yaw[i] += w * deltaTime;
+    // Car::update() adds to a position it has just zeroed, which turns -0
+    // into 0
+    moved[i] = 0.0f + v * deltaTime;
+    vel[i] = v;
+    acc[i] = a;
+    yawRate[i] = w;
+  }
+}
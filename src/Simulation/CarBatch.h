@@ -0,0 +1,57 @@
+#ifndef SIMULATION_CAR_BATCH_H
+#define SIMULATION_CAR_BATCH_H
+
+#pragma once
+
+#include "../Infinite/frontend/Car.h"
+#include <cstddef>
+#include <vector>
+
+// Many Cars stepped at once by VectorEnv and Race. Each field is its own
+// array (struct of arrays) and update() is one loop over them with the
+// branches of Car::update() turned into selects, so the compiler can run it
+// across SIMD lanes.
+//
+// The tangent of the steering angle is taken once in setSteering(), where
+// Car::update() takes it every step, because the steering only changes when
+// the command does and the libm call would keep the loop scalar. Otherwise
+// it is the same arithmetic in the same order, so a car comes out of
+// update() bit for bit the way Car::update() would leave it.
+class CarBatch {
+public:
+  size_t size() const { return velocity.size(); }
+  // forgets every car, keeping the arrays' memory
+  void clear();
+
+  // appends a copy of car, steering straight ahead with no torque, and
+  // returns its index
+  size_t add(const Car &car);
+  // copies the state and parameters of car into car index
+  void set(size_t index, const Car &car);
+  // copies the state of car index back into car
+  void store(size_t index, Car &car) const;
+
+  // the steering Car::update() takes, degrees clamped to
+  // +-Car::maxSteeringDegrees
+  void setSteering(size_t index, float steeringAngleDegrees);
+  // Car::update() for every car, with its steering and torque
+  void update(float deltaTime);
+
+  // inputs, one per car
+  std::vector<float> steeringTan; // tan() of the steering angle
+  std::vector<float> torque;
+
+  // state, as in Car. position is how far the last update() went
+  std::vector<float> position;
+  std::vector<float> heading;
+  std::vector<float> velocity;
+  std::vector<float> acceleration;
+  std::vector<float> angularVelocity;
+
+  // parameters
+  std::vector<float> wheelbase;
+  std::vector<float> wheelRadius;
+  std::vector<float> mass;
+};
+
+#endif // SIMULATION_CAR_BATCH_H
@@ -0,0 +1,72 @@
+#ifndef SIMULATION_DETERMINISM_H
+#define SIMULATION_DETERMINISM_H
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <type_traits>
+
+// What a run needs to come out bit for bit the same every time: random
+// numbers that only depend on the seed, and a hash of the state after every
+// step so two runs can be compared and the first step they part ways found.
+
+// the streams a run draws from, one per thing that needs random numbers, so a
+// new draw in one of them doesn't shift what the others see
+enum RandomStreamId : uint64_t {
+  START_POSE_STREAM = 1,
+  LIDAR_NOISE_STREAM = 2,
+};
+
+inline uint64_t SplitMix64(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// a generator for one stream of one seed, unrelated to every other
+// (seed, stream) pair even when the seeds are 0, 1, 2...
+inline std::mt19937_64 RandomStream(uint64_t seed, uint64_t stream) {
+  uint64_t state = seed;
+  state = SplitMix64(state) ^ stream;
+  std::seed_seq sequence{(uint32_t)SplitMix64(state),
+                         (uint32_t)(state >> 32), (uint32_t)SplitMix64(state),
+                         (uint32_t)(state >> 32)};
+  return std::mt19937_64(sequence);
+}
+
+// FNV-1a, eight bytes at a time. Floats go in by their bits, so it only
+// matches if every value matched exactly, which is the point
+class StateHash {
+public:
+  explicit StateHash(uint64_t hash = 0xCBF29CE484222325ull) : hash(hash) {}
+
+  inline StateHash &add(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (; size >= 8; bytes += 8, size -= 8) {
+      uint64_t word;
+      std::memcpy(&word, bytes, 8);
+      hash = (hash ^ word) * PRIME;
+    }
+    for (; size > 0; bytes++, size--) {
+      hash = (hash ^ *bytes) * PRIME;
+    }
+    return *this;
+  }
+
+  template <typename T> inline StateHash &add(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be hashed by their bytes");
+    return add(&value, sizeof(T));
+  }
+
+  uint64_t get() const { return hash; }
+
+private:
+  static const uint64_t PRIME = 0x100000001B3ull;
+  uint64_t hash;
+};
+
+#endif // SIMULATION_DETERMINISM_H
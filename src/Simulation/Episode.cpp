@@ -0,0 +1,265 @@
+#include "Episode.h"
+#include "Autonomy.h"
+#include "Scenario.h"
+#include "../Profiling/Metrics.h"
+#include "../Profiling/Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+namespace {
+// the models' yaw is counter-clockwise from x, while Car::heading drives
+// along (-cos(heading), sin(heading)). The mapping is its own inverse
+float FlipHeading(float angle) { return M_PI - angle; }
+
+template <typename Model>
+void PlaceVehicle(Vehicle<Model> &vehicle, glm::vec2 position, float heading) {
+  vehicle.state.fill(0.0f);
+  vehicle.state[Model::X] = position.x;
+  vehicle.state[Model::Y] = position.y;
+  vehicle.state[Model::YAW] = FlipHeading(heading);
+}
+
+// steps vehicle with the command Car::update() would get and copies its
+// motion back into car. Returns how far it went along its old heading
+template <typename Model>
+float StepVehicle(Vehicle<Model> &vehicle, Car &car, float steeringAngle,
+                  float torque, float dt, glm::vec2 &position) {
+  VehicleInput input;
+  // steeringAngle is a fraction of full lock, positive to the right
+  input.steer = -steeringAngle * glm::radians(Car::maxSteeringDegrees);
+  input.accel = torque / car.wheelRadius / car.mass;
+  if (std::abs(car.velocity) >= vehicle.params.maxSpeed &&
+      input.accel * car.velocity > 0.0f) {
+    input.accel = 0.0f;
+  }
+
+  float yaw = vehicle.getHeading();
+  glm::vec2 before = vehicle.getPosition();
+  vehicle.step(input, dt);
+  position = vehicle.getPosition();
+
+  float moved =
+      glm::dot(position - before, glm::vec2(std::cos(yaw), std::sin(yaw)));
+  float velocity = moved / dt;
+  car.acceleration = (velocity - car.velocity) / dt;
+  car.velocity = velocity;
+  car.angularVelocity = (yaw - vehicle.getHeading()) / dt;
+  car.heading = FlipHeading(vehicle.getHeading());
+  return moved;
+}
+} // namespace
+
+Episode::Episode(const EpisodeConfig &config, double stepSeconds,
+                 uint64_t autonomyInterval)
+    : config(config), stepSeconds(stepSeconds),
+      autonomyInterval(std::max<uint64_t>(1, autonomyInterval)),
+      // the same car as the global one in Autonomy.cpp
+      car(0.0f, config.startHeading, 0.4f, 0.1f, 2.0f, 0.1f),
+      kinematic(config.vehicleParams), dynamic(config.vehicleParams),
+      grid(MAP_WIDTH, std::vector<int>(MAP_HEIGHT, FREE_CELL)),
+      planner(true), smoother(car), purePursuit(car), stanley(car),
+      controlLoop(car, 100.0),
+      noise(RandomStream(config.seed, LIDAR_NOISE_STREAM)) {
+  std::mt19937_64 random = RandomStream(config.seed, START_POSE_STREAM);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  start = config.start + glm::vec2(unit(random), unit(random)) *
+                             config.startJitter;
+  startHeading = config.startHeading + unit(random) * config.headingJitter;
+
+  purePursuit.minLookahead = config.minLookahead;
+  purePursuit.lookaheadGain = config.lookaheadGain;
+  stanley.gain = config.stanleyGain;
+  if (config.controller == EpisodeConfig::STANLEY) {
+    controlLoop.setController(&stanley);
+  } else {
+    controlLoop.setController(&purePursuit);
+  }
+
+  summary.seed = config.seed;
+  reset();
+}
+
+void Episode::reset() {
+  position = start;
+  car.heading = startHeading;
+  car.velocity = 0;
+  car.position = 0;
+  car.angularVelocity = 0;
+  car.acceleration = 0;
+  speed = 0.0f;
+  steeringAngle = 0.0f;
+  departed = false;
+  PlaceVehicle(kinematic, position, car.heading);
+  PlaceVehicle(dynamic, position, car.heading);
+}
+
+const EpisodeSummary &Episode::run() {
+  const uint64_t steps = std::llround(config.seconds / stepSeconds);
+  while (ticks < steps) {
+    step();
+  }
+  return summary;
+}
+
+void Episode::step(const CarTLAS *traffic, int self) {
+  if (beginStep(traffic, self)) {
+    endStep(move());
+  }
+}
+
+bool Episode::beginStep(const CarTLAS *traffic, int self) {
+  sensed = ticks % autonomyInterval == 0;
+  ticks++;
+  summary.steps = ticks;
+  if (sensed) {
+    if (sense(traffic, self)) {
+      hashState(true);
+      return false;
+    }
+    drive();
+  }
+  return true;
+}
+
+float Episode::move() {
+  TRACE_ZONE("car.update");
+  LATENCY_SCOPE(PHYSICS_LATENCY);
+  float torque = drive_torque(car, speed);
+  if (config.vehicle == EpisodeConfig::KINEMATIC) {
+    return StepVehicle(kinematic, car, steeringAngle, torque, stepSeconds,
+                       position);
+  } else if (config.vehicle == EpisodeConfig::DYNAMIC) {
+    return StepVehicle(dynamic, car, steeringAngle, torque, stepSeconds,
+                       position);
+  }
+  // the same way physics_step() moves the camera: along the heading from
+  // before this step
+  float heading = car.heading;
+  float moved = car.update(steeringAngle * Car::maxSteeringDegrees, torque,
+                           stepSeconds);
+  position += glm::vec2(-std::cos(heading), std::sin(heading)) * moved;
+  return moved;
+}
+
+size_t Episode::loadCar(CarBatch &batch) const {
+  size_t index = batch.add(car);
+  batch.setSteering(index, steeringAngle * Car::maxSteeringDegrees);
+  batch.torque[index] = drive_torque(car, speed);
+  return index;
+}
+
+float Episode::storeCar(const CarBatch &batch, size_t index) {
+  float heading = car.heading;
+  batch.store(index, car);
+  position += glm::vec2(-std::cos(heading), std::sin(heading)) * car.position;
+  return car.position;
+}
+
+void Episode::endStep(float moved) {
+  const bool due = sensed;
+  summary.distance += std::abs(moved);
+  if (config.scenario &&
+      config.scenario->getDistance(position) < LIDAR_CRASH_DISTANCE) {
+    crash();
+    hashState(due);
+    return;
+  }
+
+  float fromStart = glm::distance(position, start);
+  if (fromStart > config.lapDeparture) {
+    departed = true;
+  } else if (departed && fromStart < config.lapRadius) {
+    departed = false;
+    if (summary.laps++ == 0) {
+      summary.lapTime = ticks * stepSeconds;
+    }
+  }
+  hashState(due);
+}
+
+bool Episode::sense(const CarTLAS *traffic, int self) {
+  TraceLidar(glm::vec3(position, 0.05f), scan);
+  if (traffic) {
+    traffic->intersect(scan, self);
+  }
+  if (config.lidarNoise > 0.0f) {
+    std::normal_distribution<float> error(0.0f, config.lidarNoise);
+    for (Ray &ray : scan) {
+      ray.t = std::max(0.0f, ray.t + error(noise));
+    }
+  }
+
+  float closest = INFINITY;
+  for (const Ray &ray : scan) {
+    closest = std::min(closest, ray.t);
+  }
+  summary.minClearance = std::min(summary.minClearance, closest);
+  if (closest < LIDAR_CRASH_DISTANCE) {
+    crash();
+    return true;
+  }
+  return false;
+}
+
+void Episode::crash() {
+  summary.collisions++;
+  reset();
+}
+
+void Episode::drive() {
+  build_costmap(scan, car.heading, grid);
+
+  glm::vec2 from = {MAP_WIDTH / 2, 0};
+  glm::vec2 to = {MAP_WIDTH / 2, MAP_HEIGHT};
+  std::vector<glm::vec2> cells;
+  {
+    LATENCY_SCOPE(PLAN_LATENCY);
+    cells = planner.search(grid, from, to);
+  }
+  CountMetric(ASTAR_EXPANSIONS, planner.getExpandedNodes());
+  const std::vector<glm::vec2> &path = smoother.smooth(grid, cells);
+
+  cells_to_control_path(path, controlPath);
+  controlLoop.setPath(controlPath);
+  float steer =
+      controlLoop.step(autonomyInterval * stepSeconds, car.velocity);
+  // steeringAngle is a fraction of full lock, positive to the right
+  speed = config.speed;
+  steeringAngle = -steer / glm::radians(Car::maxSteeringDegrees);
+}
+
+bool ParseVehicleType(const std::string &name,
+                      EpisodeConfig::VehicleType &type) {
+  if (name == "car") {
+    type = EpisodeConfig::CAR;
+  } else if (name == "kinematic") {
+    type = EpisodeConfig::KINEMATIC;
+  } else if (name == "dynamic") {
+    type = EpisodeConfig::DYNAMIC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Episode::hashState(bool sensed) {
+  if (!deterministic) {
+    return;
+  }
+  StateHash hash(stateHash);
+  hash.add(position).add(car.heading).add(car.velocity);
+  hash.add(car.acceleration).add(car.angularVelocity);
+  hash.add(speed).add(steeringAngle);
+  if (sensed) {
+    for (const Ray &ray : scan) {
+      hash.add(ray.t);
+    }
+    for (const std::vector<int> &row : grid) {
+      hash.add(row.data(), row.size() * sizeof(int));
+    }
+  }
+  stateHash = hash.get();
+  summary.hash = stateHash;
+}
@@ -0,0 +1,160 @@
+#ifndef SIMULATION_EPISODE_H
+#define SIMULATION_EPISODE_H
+
+#pragma once
+
+#include "../Control/ControlLoop.h"
+#include "../Control/PurePursuit.h"
+#include "../Control/Stanley.h"
+#include "../Dynamics/Vehicle.h"
+#include "../Infinite/backend/Software/BVH.h"
+#include "../Infinite/backend/Software/CarTLAS.h"
+#include "../Infinite/frontend/Car.h"
+#include "../Planning/JumpPointSearch.h"
+#include "../Planning/OccupancyGrid.h"
+#include "../Planning/PathSmoother.h"
+#include "CarBatch.h"
+#include "Determinism.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+class Scenario;
+
+// how one episode starts and drives
+struct EpisodeConfig {
+  uint64_t seed = 0;
+  glm::vec2 start{-1.0f, 0.9f}; // metres, where the camera starts
+  float startHeading = 0.0f;    // radians, Car::heading
+  float startJitter = 0.0f;     // metres, the seed moves the start this much
+  float headingJitter = 0.0f;   // radians, and turns it this much
+
+  enum ControllerType { PURE_PURSUIT, STANLEY };
+  ControllerType controller = PURE_PURSUIT;
+  float minLookahead = 0.3f;  // pure pursuit, metres
+  float lookaheadGain = 1.0f; // pure pursuit, seconds
+  float stanleyGain = 2.0f;   // stanley, 1 / s
+  float speed = 0.1f;         // drive command, as in update2()
+  float lidarNoise = 0.0f;    // metres, standard deviation of every range
+  // the bundle the track came from, if any. Its distance field checks for a
+  // crash after every physics step, not only when the LIDAR looks
+  const Scenario *scenario = nullptr;
+
+  // what moves the car: Car::update(), or one of the src/Dynamics models
+  // driven by the same commands
+  enum VehicleType { CAR, KINEMATIC, DYNAMIC };
+  VehicleType vehicle = CAR;
+  VehicleParams vehicleParams; // KINEMATIC and DYNAMIC only
+
+  double seconds = 60.0; // simulated time
+
+  // a lap is leaving the start by more than lapDeparture and coming back
+  // within lapRadius of it
+  float lapRadius = 0.3f;    // metres
+  float lapDeparture = 1.0f; // metres
+};
+
+struct EpisodeSummary {
+  uint64_t seed = 0;
+  uint64_t steps = 0;
+  uint32_t laps = 0;
+  double lapTime = -1.0; // seconds to the first lap, -1 if it never finished
+  uint32_t collisions = 0;
+  float minClearance = INFINITY; // metres, closest any LIDAR ray got
+  float distance = 0.0f;         // metres driven
+  uint64_t hash = 0; // state hash after the last step, when deterministic
+};
+
+// One car driving on its own: the same LIDAR, costmap, planning, control and
+// physics steps as mainLoop(), but with every bit of state owned by the
+// episode instead of the globals in Autonomy.cpp. The only thing shared is
+// the BVH, which is only read, so episodes can run on as many threads as
+// there are cores.
+//
+// The planner is cost aware Jump Point Search, the one of update2()'s
+// planners that doesn't read the global costmap.
+//
+// Everything random comes from its own stream of config.seed, so the same
+// config drives the same way every time, on any thread.
+class Episode {
+public:
+  Episode(const EpisodeConfig &config, double stepSeconds,
+          uint64_t autonomyInterval);
+
+  // runs the whole episode
+  const EpisodeSummary &run();
+  // one physics step, with LIDAR and autonomy when they are due. With
+  // traffic, the LIDAR sees the other cars in it too, and self is this car
+  void step(const CarTLAS *traffic = nullptr, int self = -1);
+
+  // step() in parts, for a Race that moves all of its cars at once.
+  // beginStep() senses and drives when that is due, and returns false if the
+  // car crashed, which ends the step. Otherwise the car moves, with move(),
+  // or for usesCar() episodes with loadCar(), CarBatch::update() and
+  // storeCar(), and endStep() takes how far it went
+  bool beginStep(const CarTLAS *traffic = nullptr, int self = -1);
+  // returns how far the car went
+  float move();
+  // Car::update() is what moves the car
+  bool usesCar() const { return config.vehicle == EpisodeConfig::CAR; }
+  // appends the car and its command to batch, returns its index
+  size_t loadCar(CarBatch &batch) const;
+  // takes the car back out of batch after its update() and moves along,
+  // returns how far it went
+  float storeCar(const CarBatch &batch, size_t index);
+  void endStep(float moved);
+
+  const EpisodeSummary &getSummary() const { return summary; }
+  glm::vec2 getPosition() const { return position; }
+  float getHeading() const { return car.heading; }
+  const Car &getCar() const { return car; }
+  const std::vector<Ray> &getScan() const { return scan; }
+
+private:
+  EpisodeConfig config;
+  double stepSeconds;
+  uint64_t autonomyInterval;
+  uint64_t ticks = 0;
+
+  Car car;
+  // with config.vehicle KINEMATIC or DYNAMIC these move the car, and car only
+  // mirrors their motion for the controllers and the state hash
+  Vehicle<KinematicBicycle, RK4> kinematic;
+  Vehicle<DynamicBicycle<PacejkaTire>, RK4> dynamic;
+  glm::vec2 start;
+  float startHeading;
+  glm::vec2 position;
+  float speed = 0.0f;
+  float steeringAngle = 0.0f;
+  bool departed = false;
+  bool sensed = false; // this step, set by beginStep()
+  uint64_t stateHash = StateHash().get();
+
+  std::vector<Ray> scan;
+  OccupancyGrid grid;
+  JumpPointSearch planner;
+  PathSmoother smoother;
+  PurePursuit purePursuit;
+  Stanley stanley;
+  ControlLoop controlLoop;
+  std::vector<glm::vec2> controlPath;
+  std::mt19937_64 noise; // LIDAR_NOISE_STREAM
+
+  EpisodeSummary summary;
+
+  void reset();
+  // true if the car crashed and was put back at the start
+  bool sense(const CarTLAS *traffic, int self);
+  void crash();
+  void drive();
+  // like hash_state(), for this episode's car
+  void hashState(bool sensed);
+};
+
+// "car", "kinematic" or "dynamic" into type, false for anything else
+bool ParseVehicleType(const std::string &name,
+                      EpisodeConfig::VehicleType &type);
+
+#endif // SIMULATION_EPISODE_H
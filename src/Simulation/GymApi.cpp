@@ -0,0 +1,122 @@
+#include "GymApi.h"
+#include "../Infinite/backend/Model/Mesh.h"
+#include "../Infinite/backend/Software/BVH.h"
+#include "VectorEnv.h"
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+struct F1TenthGym {
+  VectorEnv env;
+};
+
+namespace {
+thread_local std::string lastError;
+
+// the BVH is one set of globals, so there is one track per process
+std::mutex trackMutex;
+std::string loadedTrack;
+
+void LoadTrack(const F1TenthGymConfig &config) {
+  if (!config.trackPath) {
+    throw std::runtime_error("no track given");
+  }
+  std::lock_guard<std::mutex> lock(trackMutex);
+  if (loadedTrack.empty()) {
+    Infinite::Mesh track = Infinite::LoadMesh(config.trackPath);
+    UpdateBoundingVolumeHierarchy(
+        config.bvhPath ? config.bvhPath : config.trackPath, track);
+    loadedTrack = config.trackPath;
+  } else if (loadedTrack != config.trackPath) {
+    throw std::runtime_error("this process already loaded " + loadedTrack +
+                             ", it can't load " + config.trackPath + " too");
+  }
+}
+
+VectorEnvConfig ToVectorEnvConfig(const F1TenthGymConfig &config) {
+  VectorEnvConfig out;
+  out.seed = config.seed;
+  out.start = {config.startX, config.startY};
+  out.startHeading = config.startHeading;
+  out.startJitter = config.startJitter;
+  out.headingJitter = config.headingJitter;
+  out.beams = config.beams;
+  out.fovDegrees = config.fovDegrees;
+  out.maxRange = config.maxRange;
+  out.stepSeconds = config.stepSeconds;
+  out.actionRepeat = config.actionRepeat;
+  out.maxSteps = config.maxSteps;
+  out.crashPenalty = config.crashPenalty;
+  out.threads = config.threads;
+  return out;
+}
+
+// runs call, turning anything it throws into -1 and lastError
+template <typename Call> int32_t Guard(Call call) {
+  try {
+    call();
+    return 0;
+  } catch (const std::exception &error) {
+    lastError = error.what();
+  } catch (...) {
+    lastError = "unknown error";
+  }
+  return -1;
+}
+} // namespace
+
+F1TenthGymConfig f1tenth_gym_default_config(void) {
+  VectorEnvConfig defaults;
+  F1TenthGymConfig config = {};
+  config.seed = defaults.seed;
+  config.startX = defaults.start.x;
+  config.startY = defaults.start.y;
+  config.startHeading = defaults.startHeading;
+  config.startJitter = defaults.startJitter;
+  config.headingJitter = defaults.headingJitter;
+  config.beams = defaults.beams;
+  config.fovDegrees = defaults.fovDegrees;
+  config.maxRange = defaults.maxRange;
+  config.stepSeconds = defaults.stepSeconds;
+  config.actionRepeat = defaults.actionRepeat;
+  config.maxSteps = defaults.maxSteps;
+  config.crashPenalty = defaults.crashPenalty;
+  config.threads = defaults.threads;
+  return config;
+}
+
+F1TenthGym *f1tenth_gym_create(int32_t envs, const F1TenthGymConfig *config) {
+  F1TenthGym *gym = nullptr;
+  Guard([&] {
+    if (!config) {
+      throw std::runtime_error("no config given");
+    }
+    LoadTrack(*config);
+    gym = new F1TenthGym{VectorEnv(envs, ToVectorEnvConfig(*config))};
+  });
+  return gym;
+}
+
+void f1tenth_gym_destroy(F1TenthGym *gym) { delete gym; }
+
+int32_t f1tenth_gym_envs(const F1TenthGym *gym) {
+  return gym->env.getEnvs();
+}
+
+int32_t f1tenth_gym_observation_size(const F1TenthGym *gym) {
+  return gym->env.getObservationSize();
+}
+
+int32_t f1tenth_gym_reset(F1TenthGym *gym, const uint8_t *mask,
+                          float *observations) {
+  return Guard([&] { gym->env.reset(mask, observations); });
+}
+
+int32_t f1tenth_gym_step(F1TenthGym *gym, const float *actions,
+                         float *observations, float *rewards,
+                         uint8_t *dones) {
+  return Guard([&] { gym->env.step(actions, observations, rewards, dones); });
+}
+
+const char *f1tenth_gym_last_error(void) { return lastError.c_str(); }
@@ -0,0 +1,97 @@
+#ifndef SIMULATION_GYM_API_H
+#define SIMULATION_GYM_API_H
+
+#pragma once
+
+#include <stdint.h>
+
+// A plain C interface to VectorEnv, for training from Python (ctypes, cffi),
+// Julia or anything else that can load libf1tenth_gym and pass it pointers.
+// Nothing is allocated per step: reset() and step() write straight into the
+// caller's arrays, which can be numpy arrays' own memory.
+//
+//   F1TenthGymConfig config = f1tenth_gym_default_config();
+//   config.trackPath = "track.obj";
+//   F1TenthGym *gym = f1tenth_gym_create(64, &config);
+//   int size = f1tenth_gym_observation_size(gym);
+//   // observations[64 * size], actions[64 * 2], rewards[64], dones[64]
+//   f1tenth_gym_reset(gym, NULL, observations);
+//   while (training) {
+//     f1tenth_gym_step(gym, actions, observations, rewards, dones);
+//     f1tenth_gym_reset(gym, dones, observations); // the ones that finished
+//   }
+//   f1tenth_gym_destroy(gym);
+//
+// See VectorEnv.h for what observations, actions, rewards and dones hold.
+// Functions that can fail return 0 (or a gym) on success, and otherwise -1
+// (or NULL) with the reason in f1tenth_gym_last_error().
+//
+// The track's BVH is built once per process, by the first gym made; every
+// gym after it has to be on the same track.
+
+#if defined(_WIN32) && defined(F1TENTH_GYM_BUILD)
+#define F1TENTH_GYM_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define F1TENTH_GYM_API __declspec(dllimport)
+#else
+#define F1TENTH_GYM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct F1TenthGym F1TenthGym;
+
+// the same fields as VectorEnvConfig
+typedef struct F1TenthGymConfig {
+  const char *trackPath; // OBJ
+  const char *bvhPath;   // where the BVH is cached, NULL for next to the OBJ
+  uint64_t seed;
+  float startX, startY;  // metres
+  float startHeading;    // radians
+  float startJitter;     // metres
+  float headingJitter;   // radians
+  int32_t beams;
+  float fovDegrees;
+  float maxRange;        // metres
+  double stepSeconds;
+  int32_t actionRepeat;
+  uint64_t maxSteps;     // 0 never
+  float crashPenalty;
+  int32_t threads;       // 0 for one per core
+} F1TenthGymConfig;
+
+// dones
+#define F1TENTH_GYM_RUNNING 0
+#define F1TENTH_GYM_CRASHED 1
+#define F1TENTH_GYM_TRUNCATED 2
+
+F1TENTH_GYM_API F1TenthGymConfig f1tenth_gym_default_config(void);
+// envs cars on config's track, NULL if the track can't be loaded or the
+// config doesn't make sense
+F1TENTH_GYM_API F1TenthGym *f1tenth_gym_create(int32_t envs,
+                                               const F1TenthGymConfig *config);
+F1TENTH_GYM_API void f1tenth_gym_destroy(F1TenthGym *gym);
+
+F1TENTH_GYM_API int32_t f1tenth_gym_envs(const F1TenthGym *gym);
+// floats in one car's observation
+F1TENTH_GYM_API int32_t f1tenth_gym_observation_size(const F1TenthGym *gym);
+
+// resets the cars whose mask is non zero, all of them if mask is NULL, and
+// writes their observations: envs * observation size floats
+F1TENTH_GYM_API int32_t f1tenth_gym_reset(F1TenthGym *gym, const uint8_t *mask,
+                                          float *observations);
+// actions is envs * 2 floats, steering then speed; rewards and dones are envs
+F1TENTH_GYM_API int32_t f1tenth_gym_step(F1TenthGym *gym, const float *actions,
+                                         float *observations, float *rewards,
+                                         uint8_t *dones);
+
+// why the last call on this thread failed
+F1TENTH_GYM_API const char *f1tenth_gym_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIMULATION_GYM_API_H
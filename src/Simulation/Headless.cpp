@@ -0,0 +1,517 @@
+#include "Headless.h"
+#include "../Infinite/backend/Model/Mesh.h"
+#include "../Infinite/backend/Software/BVH.h"
+#include "../Infinite/frontend/Camera.h"
+#include "../Profiling/Metrics.h"
+#include "../Profiling/Trace.h"
+#include "Autonomy.h"
+#include "BatchRunner.h"
+#include "Determinism.h"
+#include "Pipeline.h"
+#include "Race.h"
+#include "Replay.h"
+#include "Scenario.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+bool ParseHeadlessArgs(int argc, char **argv, HeadlessOptions &options) {
+  bool headless = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--headless") {
+      headless = true;
+      continue;
+    }
+    if (arg == "--deterministic") {
+      options.deterministic = true;
+      continue;
+    }
+    if (arg == "--compress") {
+      options.compressRecording = true;
+      continue;
+    }
+    if (arg == "--pipelined") {
+      options.pipelined = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::runtime_error("unknown argument: " + arg);
+    }
+    const char *value = argv[++i];
+    if (arg == "--seconds") {
+      options.seconds = std::atof(value);
+    } else if (arg == "--rate") {
+      options.rate = std::atof(value);
+    } else if (arg == "--track") {
+      options.trackPath = value;
+    } else if (arg == "--bvh") {
+      options.bvhPath = value;
+    } else if (arg == "--scenario") {
+      options.scenarioPath = value;
+    } else if (arg == "--episodes") {
+      options.episodes = std::atoi(value);
+    } else if (arg == "--episodes-file") {
+      options.episodesPath = value;
+    } else if (arg == "--seed") {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--jitter") {
+      options.jitter = std::atof(value);
+    } else if (arg == "--threads") {
+      options.threads = std::atoi(value);
+    } else if (arg == "--summary") {
+      options.summaryPath = value;
+    } else if (arg == "--vehicle") {
+      if (!ParseVehicleType(value, options.vehicle)) {
+        throw std::runtime_error("--vehicle is car, kinematic or dynamic");
+      }
+    } else if (arg == "--vehicle-params") {
+      options.vehicleParamsPath = value;
+    } else if (arg == "--cars") {
+      options.cars = std::atoi(value);
+    } else if (arg == "--hash-log") {
+      options.hashLogPath = value;
+      options.deterministic = true;
+    } else if (arg == "--record") {
+      options.recordPath = value;
+    } else if (arg == "--planner") {
+      options.planner = value;
+    } else if (arg == "--controller") {
+      options.controller = value;
+    } else if (arg == "--replay") {
+      options.replayPath = value;
+    } else if (arg == "--from") {
+      options.replayFrom = std::atof(value);
+    } else if (arg == "--to") {
+      options.replayTo = std::atof(value);
+    } else if (arg == "--replay-speed") {
+      options.replaySpeed = std::atof(value);
+    } else if (arg == "--compare") {
+      options.comparePlanner = value;
+    } else if (arg == "--replay-out") {
+      options.replayOutPath = value;
+    } else if (arg == "--time-scale") {
+      options.timeScale = std::atof(value);
+    } else if (arg == "--sense-rate") {
+      options.senseRate = std::atof(value);
+    } else if (arg == "--plan-rate") {
+      options.planRate = std::atof(value);
+    } else if (arg == "--control-rate") {
+      options.controlRate = std::atof(value);
+    } else if (arg == "--trace") {
+      options.tracePath = value;
+    } else if (arg == "--metrics") {
+      options.metricsName = value;
+    } else if (arg == "--bridge") {
+      options.bridgeName = value;
+    } else if (arg == "--bridge-mode") {
+      if (std::string(value) == "lockstep") {
+        options.bridgeMode = BRIDGE_LOCKSTEP;
+      } else if (std::string(value) == "free") {
+        options.bridgeMode = BRIDGE_FREE_RUNNING;
+      } else {
+        throw std::runtime_error("--bridge-mode is lockstep or free");
+      }
+    } else if (arg == "--bridge-timeout") {
+      options.bridgeTimeout = std::atof(value);
+    } else if (arg == "--telemetry") {
+      options.telemetryAddress = value;
+    } else {
+      throw std::runtime_error("unknown argument: " + arg);
+    }
+  }
+  if (options.seconds <= 0.0 || options.rate <= 0.0) {
+    throw std::runtime_error("--seconds and --rate must be positive");
+  }
+  if (options.timeScale <= 0.0 || options.senseRate <= 0.0 ||
+      options.controlRate <= 0.0 || options.planRate < 0.0) {
+    throw std::runtime_error("--time-scale, --sense-rate and --control-rate "
+                             "must be positive");
+  }
+  if ((!options.bridgeName.empty() || !options.telemetryAddress.empty()) &&
+      (options.pipelined || options.cars > 1 || options.episodes > 0 ||
+       !options.episodesPath.empty() || !options.replayPath.empty())) {
+    throw std::runtime_error("--bridge and --telemetry only work with the "
+                             "single car run");
+  }
+  for (const std::string &planner : {options.planner, options.comparePlanner}) {
+    if (!planner.empty() && !set_planner(planner)) {
+      throw std::runtime_error("unknown planner: " + planner);
+    }
+  }
+  set_planner(options.planner.empty() ? "astar" : options.planner);
+  if (!options.controller.empty() && !set_controller(options.controller)) {
+    throw std::runtime_error("unknown controller: " + options.controller);
+  }
+  return headless;
+}
+
+PipelineConfig PipelineSettings(const HeadlessOptions &options) {
+  PipelineConfig settings;
+  settings.timeScale = options.timeScale;
+  settings.senseRate = options.senseRate;
+  settings.planRate = options.planRate;
+  settings.controlRate = options.controlRate;
+  return settings;
+}
+
+namespace {
+// the scenario's start i, taking them in turn, or the default start without
+// one. Episodes check for crashes against the scenario too
+void SetStart(const Scenario *scenario, size_t i, EpisodeConfig &config) {
+  config.scenario = scenario;
+  if (scenario) {
+    const ScenarioPose &pose =
+        scenario->getStart(i % scenario->getStartCount());
+    config.start = {pose.x, pose.y};
+    config.startHeading = pose.heading;
+  }
+}
+
+// --vehicle and --vehicle-params
+void SetVehicle(const HeadlessOptions &options, EpisodeConfig &config) {
+  config.vehicle = options.vehicle;
+  if (!options.vehicleParamsPath.empty()) {
+    config.vehicleParams = LoadVehicleParams(options.vehicleParamsPath);
+  }
+}
+
+int RunEpisodes(const HeadlessOptions &options, const Scenario *scenario) {
+  EpisodeConfig defaults;
+  defaults.seconds = options.seconds;
+  defaults.startJitter = options.jitter;
+  SetStart(scenario, 0, defaults);
+  SetVehicle(options, defaults);
+
+  std::vector<EpisodeConfig> configs;
+  if (!options.episodesPath.empty()) {
+    configs = LoadEpisodeConfigs(options.episodesPath, defaults);
+  } else {
+    for (int i = 0; i < options.episodes; i++) {
+      configs.push_back(defaults);
+      configs.back().seed = options.seed + i;
+      SetStart(scenario, i, configs.back());
+    }
+  }
+
+  BatchResult result = RunBatch(configs, options.threads);
+  WriteEpisodeSummaries(options.summaryPath, result.summaries);
+
+  uint32_t collisions = 0;
+  uint32_t finished = 0;
+  for (const EpisodeSummary &summary : result.summaries) {
+    collisions += summary.collisions;
+    finished += summary.laps > 0;
+  }
+  printf("%zu episodes on %d threads, %llu steps in %.3f s: %.0f steps/s, "
+         "%u finished a lap, %u collisions\n",
+         configs.size(), result.threads, (unsigned long long)result.steps,
+         result.seconds, result.getStepsPerSecond(), finished, collisions);
+  return EXIT_SUCCESS;
+}
+
+void PrintReplay(const char *name, const ReplayResult &result) {
+  printf("%s: %zu scans in %.3f s: %.0f scans/s, %.1f us average and %.1f us "
+         "worst in update2(), %u differ from the log, %u crashes skipped\n",
+         name, result.scans.size(), result.seconds,
+         result.getScansPerSecond(),
+         result.scans.empty() ? 0.0
+                              : result.planSeconds / result.scans.size() * 1e6,
+         result.maxPlanSeconds * 1e6, result.mismatches, result.crashes);
+}
+
+int RunReplayLog(const HeadlessOptions &options) {
+  TrajectoryReader log(options.replayPath);
+  ReplayOptions replay;
+  replay.from = options.replayFrom;
+  replay.to = options.replayTo;
+  replay.speed = options.replaySpeed;
+
+  ReplayResult a = RunReplay(log, replay);
+  PrintReplay(options.planner.empty() ? "astar" : options.planner.c_str(), a);
+  if (options.comparePlanner.empty()) {
+    WriteReplay(options.replayOutPath, a);
+    return EXIT_SUCCESS;
+  }
+
+  set_planner(options.comparePlanner);
+  ReplayResult b = RunReplay(log, replay);
+  PrintReplay(options.comparePlanner.c_str(), b);
+  WriteReplay(options.replayOutPath, a, &b);
+
+  uint32_t differ = 0;
+  float steeringDifference = 0.0f;
+  for (size_t i = 0; i < std::min(a.scans.size(), b.scans.size()); i++) {
+    float difference =
+        std::abs(a.scans[i].steeringAngle - b.scans[i].steeringAngle);
+    differ += difference > 0.0f;
+    steeringDifference = std::max(steeringDifference, difference);
+  }
+  printf("steering differs on %u scans, by up to %.3f of full lock\n", differ,
+         steeringDifference);
+  return EXIT_SUCCESS;
+}
+
+void PrintStage(const char *name, const StageStats &stats, double seconds) {
+  printf("  %-5s %8llu runs, %7.1f per second, %8.1f us each, %5.1f%% busy, "
+         "%llu dropped\n",
+         name, (unsigned long long)stats.runs, stats.runs / seconds,
+         stats.getAverageSeconds() * 1e6, stats.busySeconds / seconds * 100.0,
+         (unsigned long long)stats.dropped);
+}
+
+int RunPipelined(const HeadlessOptions &options, const Scenario *scenario) {
+  EpisodeConfig config;
+  SetStart(scenario, 0, config);
+  Pipeline pipeline(config, PipelineSettings(options), sim_clock.getStep());
+  auto begin = std::chrono::steady_clock::now();
+  pipeline.start();
+  while (pipeline.getClock() < options.seconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.stop();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+
+  printf("pipelined, %llu steps in %.3f s (%.1fx real time), %.2f m driven, "
+         "%u crashes\n",
+         (unsigned long long)pipeline.getSteps(), seconds,
+         pipeline.getSteps() * sim_clock.getStep() / seconds,
+         pipeline.getDistance(), pipeline.getCrashes());
+  PrintStage("sense", pipeline.getSenseStats(), seconds);
+  PrintStage("plan", pipeline.getPlanStats(), seconds);
+  PrintStage("act", pipeline.getActStats(), seconds);
+  return EXIT_SUCCESS;
+}
+
+int RunRace(const HeadlessOptions &options, const Scenario *scenario) {
+  EpisodeConfig config;
+  config.seconds = options.seconds;
+  config.seed = options.seed;
+  SetStart(scenario, 0, config);
+  SetVehicle(options, config);
+  RaceConfig raceConfig;
+  raceConfig.cars = options.cars;
+
+  Race race(config, raceConfig, sim_clock.getStep(), autonomy_interval());
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<EpisodeSummary> summaries = race.run();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  WriteEpisodeSummaries(options.summaryPath, summaries);
+
+  uint64_t steps = summaries.empty() ? 0 : summaries[0].steps;
+  uint32_t collisions = 0;
+  for (const EpisodeSummary &summary : summaries) {
+    collisions += summary.collisions;
+  }
+  printf("%d cars, %llu steps in %.3f s: %.0f steps/s, %.1f us per TLAS "
+         "build, %u collisions\n",
+         options.cars, (unsigned long long)steps, seconds, steps / seconds,
+         race.getAverageBuildSeconds() * 1e6, collisions);
+  return EXIT_SUCCESS;
+}
+
+int RunSimulation(const HeadlessOptions &options) {
+  deterministic = options.deterministic;
+  if (!options.replayPath.empty()) {
+    // the log has everything update2() needs, so no track or BVH
+    return RunReplayLog(options);
+  }
+
+  std::unique_ptr<Scenario> scenario;
+  if (!options.scenarioPath.empty()) {
+    scenario = std::make_unique<Scenario>(options.scenarioPath);
+    scenario->useBoundingVolumeHierarchy();
+  } else {
+    Infinite::Mesh track = Infinite::LoadMesh(options.trackPath);
+    UpdateBoundingVolumeHierarchy(options.bvhPath.c_str(), track);
+  }
+
+  Infinite::cameras.setAngles(M_PI / 2.0, -M_PI / 2.0);
+  if (scenario) {
+    const ScenarioPose &pose = scenario->getStart(0);
+    place_car({pose.x, pose.y}, pose.heading);
+  }
+  sim_clock.setRate(options.rate);
+
+  if (options.pipelined) {
+    int status = RunPipelined(options, scenario.get());
+    destroyBVH();
+    return status;
+  }
+  if (options.cars > 1) {
+    int status = RunRace(options, scenario.get());
+    destroyBVH();
+    return status;
+  }
+  if (options.episodes > 0 || !options.episodesPath.empty()) {
+    int status = RunEpisodes(options, scenario.get());
+    destroyBVH();
+    return status;
+  }
+
+  // the same fixed steps as mainLoop(), just never waiting for a frame
+  const double step = sim_clock.getStep();
+  const uint64_t autonomyInterval = autonomy_interval();
+  const uint64_t steps = std::llround(options.seconds / step);
+  uint64_t crashes = 0;
+  uint64_t hash = StateHash().get();
+
+  FILE *hashLog = nullptr;
+  if (!options.hashLogPath.empty()) {
+    hashLog = fopen(options.hashLogPath.c_str(), "w");
+    if (!hashLog) {
+      throw std::runtime_error("failed to open file: " + options.hashLogPath);
+    }
+  }
+
+  std::unique_ptr<TrajectoryRecorder> recorder;
+  if (!options.recordPath.empty()) {
+    recorder = std::make_unique<TrajectoryRecorder>(
+        options.recordPath, step, options.compressRecording);
+  }
+  std::unique_ptr<Bridge> bridge;
+  bool freeRunning = false;
+  if (!options.bridgeName.empty()) {
+    bridge = std::make_unique<Bridge>(options.bridgeName, options.bridgeMode,
+                                      step, autonomyInterval * step);
+    freeRunning = options.bridgeMode == BRIDGE_FREE_RUNNING;
+    printf("the bridge client drives, at %s\n", options.bridgeName.c_str());
+    fflush(stdout);
+  }
+  std::unique_ptr<TelemetryServer> telemetry;
+  if (!options.telemetryAddress.empty()) {
+    telemetry = std::make_unique<TelemetryServer>(options.telemetryAddress);
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < steps; i++, sim_clock.tick()) {
+    bool sensed = sim_clock.getTicks() % autonomyInterval == 0;
+    bool crashed = false;
+    if (sensed) {
+      crashed = update();
+      if (crashed) {
+        crashes++;
+        reset_car();
+      } else if (bridge) {
+        bridge->publish(trajectory_step(), i, sim_clock.getTime(), crashes,
+                        LIDAR);
+        if (!freeRunning) {
+          bridge->wait(steeringAngle, speed, options.bridgeTimeout);
+        }
+      } else {
+        speed = 0.0f;
+        steeringAngle = 0.0f;
+        update2(autonomyInterval * step);
+      }
+    }
+    if (freeRunning) {
+      // the stack answers in wall clock time, so the simulation keeps to it
+      std::this_thread::sleep_until(
+          begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(i * step /
+                                                    options.timeScale)));
+      bridge->poll(steeringAngle, speed);
+    }
+    if (!crashed) {
+      physics_step(step);
+      // between scans a scenario's walls catch the car, as in Episode::step()
+      glm::vec3 camera = Infinite::cameras.getPosition();
+      if (scenario && scenario->getDistance({camera.x, camera.y}) <
+                          LIDAR_CRASH_DISTANCE) {
+        crashed = true;
+        crashes++;
+        reset_car();
+      }
+    }
+    if (telemetry) {
+      if (sensed) {
+        telemetry->publishScan(i, sim_clock.getTime(), LIDAR);
+      }
+      telemetry->publishState(trajectory_step(), i, sim_clock.getTime(),
+                              crashes);
+    }
+
+    if (deterministic) {
+      hash = hash_state(hash, sensed);
+      if (hashLog) {
+        fprintf(hashLog, "%llu %016llx\n", (unsigned long long)i,
+                (unsigned long long)hash);
+      }
+    }
+    if (recorder) {
+      recorder->record(trajectory_step(), sensed ? &LIDAR : nullptr,
+                       sensed && !crashed ? &control_path : nullptr);
+    }
+  }
+  if (recorder) {
+    recorder->close();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+
+  printf("%llu steps (%.1f s simulated) in %.3f s: %.0f steps/s, %.1fx real "
+         "time, %llu crashes\n",
+         (unsigned long long)steps, sim_clock.getTime(), seconds,
+         steps / seconds, sim_clock.getTime() / seconds,
+         (unsigned long long)crashes);
+  if (deterministic) {
+    printf("state hash %016llx\n", (unsigned long long)hash);
+  }
+  if (hashLog) {
+    fclose(hashLog);
+  }
+  if (telemetry) {
+    printf("telemetry sent %llu datagrams, subscribers missed %llu, %llu "
+           "messages dropped\n",
+           (unsigned long long)telemetry->getSent(),
+           (unsigned long long)telemetry->getMissed(),
+           (unsigned long long)telemetry->getDropped());
+  }
+  if (recorder) {
+    printf("recorded %llu steps to %s, record() waited on the writer %llu "
+           "times\n",
+           (unsigned long long)recorder->getSteps(),
+           options.recordPath.c_str(),
+           (unsigned long long)recorder->getStalls());
+  }
+
+  destroyBVH();
+  return EXIT_SUCCESS;
+}
+} // namespace
+
+int RunHeadless(const HeadlessOptions &options) {
+  if (!options.metricsName.empty()) {
+    PublishMetrics(options.metricsName);
+  }
+  if (!options.tracePath.empty()) {
+    SetTraceThreadName("main");
+    EnableTracing();
+  }
+  auto begin = std::chrono::steady_clock::now();
+  int status = RunSimulation(options);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  if (!options.tracePath.empty()) {
+    DisableTracing();
+    WriteChromeTrace(options.tracePath);
+    printf("trace written to %s\n", options.tracePath.c_str());
+  }
+  if (!options.metricsName.empty()) {
+    printf("metrics:\n");
+    PrintMetrics(*metrics, ReadMetrics(*metrics), seconds);
+    UnpublishMetrics();
+  }
+  return status;
+}
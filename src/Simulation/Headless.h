@@ -0,0 +1,110 @@
+#ifndef SIMULATION_HEADLESS_H
+#define SIMULATION_HEADLESS_H
+
+#pragma once
+
+#include "Bridge.h"
+#include "Pipeline.h"
+#include "Telemetry.h"
+#include <cstdint>
+#include <string>
+
+// Runs the simulation with no window, swapchain or Vulkan device: the track is
+// loaded on the CPU for the BVH only, and the fixed step loop runs as fast as
+// it can instead of waiting for frames.
+struct HeadlessOptions {
+  std::string trackPath = "../assets/track.obj";
+  std::string bvhPath = "../assets/bvh"; // ".bvh" is appended
+  // a bundle built by F1TenthScenario, in place of trackPath and bvhPath,
+  // see Scenario.h. Its starts are where the cars start
+  std::string scenarioPath;
+  double seconds = 60.0;                 // simulated time to run for
+  double rate = 1000.0;                  // physics steps per second
+
+  // a batch of independent episodes instead of the one global car, see
+  // BatchRunner.h. Either episodes with seeds from seed up, each starting
+  // up to jitter metres from the start, or one per line of episodesPath
+  int episodes = 0;
+  std::string episodesPath;
+  uint64_t seed = 0;
+  float jitter = 0.05f;
+  int threads = 0; // 0 for one per core
+  std::string summaryPath = "episodes.csv";
+  // what moves the episodes' and the race's cars, see EpisodeConfig. An
+  // empty vehicleParamsPath keeps the default VehicleParams
+  EpisodeConfig::VehicleType vehicle = EpisodeConfig::CAR;
+  std::string vehicleParamsPath;
+
+  // cars racing on the track at once, see Race.h. Used when it is above 1
+  int cars = 0;
+
+  // see deterministic in Autonomy.h. The single car run can also write its
+  // state hash after every step to hashLogPath, one "step hash" line each
+  bool deterministic = false;
+  std::string hashLogPath;
+
+  // records every step of the single car run to recordPath, see
+  // TrajectoryLog.h
+  std::string recordPath;
+  bool compressRecording = false;
+
+  // update2()'s planner, see set_planner(), and what steers along its path,
+  // see set_controller(). Empty keeps the default
+  std::string planner;
+  std::string controller;
+
+  // replays a recorded log through update2() instead of simulating, see
+  // Replay.h. With comparePlanner the log is replayed a second time with
+  // that planner, and the two are compared scan by scan
+  std::string replayPath;
+  double replayFrom = 0.0;
+  double replayTo = -1.0;
+  double replaySpeed = 0.0;
+  std::string comparePlanner;
+  std::string replayOutPath = "replay.csv";
+
+  // runs sense, plan and act on threads of their own, see Pipeline.h, at
+  // timeScale times real time
+  bool pipelined = false;
+  double timeScale = 1.0;
+  double senseRate = 60.0;
+  double planRate = 0.0;
+  double controlRate = 100.0;
+
+  // times the hot paths into a Chrome trace, see Trace.h
+  std::string tracePath;
+
+  // publishes counters and latency histograms to this shared memory segment
+  // for F1TenthMetrics to watch, see Metrics.h
+  std::string metricsName;
+
+  // hands the driving to a stack in another process through this shared
+  // memory segment instead of update2(), see Bridge.h. Free running runs at
+  // timeScale times real time
+  std::string bridgeName;
+  BridgeMode bridgeMode = BRIDGE_LOCKSTEP;
+  double bridgeTimeout = 10.0; // seconds to wait for a command in lockstep
+
+  // serves the car's state and scans to subscribers at this address,
+  // "udp:<ip>:<port>" or "unix:<path>", see Telemetry.h
+  std::string telemetryAddress;
+};
+
+// reads --headless, --seconds, --rate, --track, --bvh, --scenario,
+// --episodes, --episodes-file, --seed, --jitter, --threads, --summary,
+// --vehicle, --vehicle-params, --cars, --deterministic, --hash-log,
+// --record, --compress, --planner, --controller, --replay, --from, --to,
+// --replay-speed, --compare, --replay-out, --pipelined, --time-scale,
+// --sense-rate, --plan-rate, --control-rate, --trace, --metrics, --bridge,
+// --bridge-mode, --bridge-timeout and --telemetry into options.
+// Returns true if --headless was given, throws std::runtime_error on anything
+// it doesn't know
+bool ParseHeadlessArgs(int argc, char **argv, HeadlessOptions &options);
+
+// the pipeline settings out of options
+PipelineConfig PipelineSettings(const HeadlessOptions &options);
+
+// returns the process exit code
+int RunHeadless(const HeadlessOptions &options);
+
+#endif // SIMULATION_HEADLESS_H
@@ -0,0 +1,238 @@
+#include "Pipeline.h"
+#include "Autonomy.h"
+#include "Scenario.h"
+#include "../Profiling/Metrics.h"
+#include "../Profiling/Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+namespace {
+double Since(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       begin)
+      .count();
+}
+} // namespace
+
+Pipeline::Pipeline(const EpisodeConfig &config, const PipelineConfig &pipeline,
+                   double stepSeconds)
+    : config(config), settings(pipeline), stepSeconds(stepSeconds),
+      // the same car as the global one in Autonomy.cpp
+      car(0.0f, config.startHeading, 0.4f, 0.1f, 2.0f, 0.1f),
+      purePursuit(car), stanley(car), controlLoop(car, pipeline.controlRate),
+      planner(true), smoother(car) {
+  purePursuit.minLookahead = config.minLookahead;
+  purePursuit.lookaheadGain = config.lookaheadGain;
+  stanley.gain = config.stanleyGain;
+  if (config.controller == EpisodeConfig::STANLEY) {
+    controlLoop.setController(&stanley);
+  } else {
+    controlLoop.setController(&purePursuit);
+  }
+  reset();
+}
+
+Pipeline::~Pipeline() { stop(); }
+
+void Pipeline::reset() {
+  pose.position = config.start;
+  car.heading = config.startHeading;
+  car.velocity = 0;
+  car.position = 0;
+  car.angularVelocity = 0;
+  car.acceleration = 0;
+  speed = 0.0f;
+  steeringAngle = 0.0f;
+}
+
+void Pipeline::start() {
+  if (running) {
+    return;
+  }
+  begin = std::chrono::steady_clock::now();
+  running = true;
+  publishPose();
+  actThread = std::thread(&Pipeline::act, this);
+  senseThread = std::thread(&Pipeline::sense, this);
+  planThread = std::thread(&Pipeline::plan, this);
+}
+
+void Pipeline::stop() {
+  running = false;
+  for (std::thread *thread : {&senseThread, &planThread, &actThread}) {
+    if (thread->joinable()) {
+      thread->join();
+    }
+  }
+}
+
+double Pipeline::getClock() const {
+  return Since(begin) * settings.timeScale;
+}
+
+const PoseSnapshot &Pipeline::getRenderPose() {
+  renderPoses.update();
+  return renderPoses.front();
+}
+
+const CostmapSnapshot &Pipeline::getRenderCostmap() {
+  costmaps.update();
+  return costmaps.front();
+}
+
+void Pipeline::publishPose() {
+  pose.heading = car.heading;
+  pose.velocity = car.velocity;
+  sensePoses.back() = pose;
+  sensePoses.publish();
+  renderPoses.back() = pose;
+  renderPoses.publish();
+}
+
+void Pipeline::sleepUntil(double clock) const {
+  std::this_thread::sleep_until(
+      begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(clock / settings.timeScale)));
+}
+
+void Pipeline::sense() {
+  SetTraceThreadName("sense");
+  const double period = 1.0 / settings.senseRate;
+  double next = 0.0;
+  while (running) {
+    sleepUntil(next);
+    // a scan that is late is late, don't try to catch up on the ones missed
+    next = std::max(next + period, getClock());
+
+    auto workBegin = std::chrono::steady_clock::now();
+    sensePoses.update();
+    ScanSnapshot &scan = scans.back();
+    scan.pose = sensePoses.front();
+    TraceLidar(glm::vec3(scan.pose.position, 0.05f), scan.rays);
+
+    float closest = INFINITY;
+    for (const Ray &ray : scan.rays) {
+      closest = std::min(closest, ray.t);
+    }
+    if (closest < LIDAR_CRASH_DISTANCE) {
+      crashed = scan.pose.resets + 1;
+    } else {
+      senseStats.dropped += scans.publish();
+    }
+    senseStats.runs++;
+    senseStats.busySeconds += Since(workBegin);
+  }
+}
+
+void Pipeline::plan() {
+  SetTraceThreadName("plan");
+  const glm::vec2 from = {MAP_WIDTH / 2, 0};
+  const glm::vec2 to = {MAP_WIDTH / 2, MAP_HEIGHT};
+  double next = 0.0;
+  while (running) {
+    if (settings.planRate > 0.0) {
+      sleepUntil(next);
+      next = std::max(next + 1.0 / settings.planRate, getClock());
+    }
+    if (!scans.update()) {
+      // nothing new to plan on yet
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+
+    TRACE_ZONE("plan");
+    auto workBegin = std::chrono::steady_clock::now();
+    const ScanSnapshot &scan = scans.front();
+    CostmapSnapshot &costmap = costmaps.back();
+    costmap.pose = scan.pose;
+    if (costmap.grid.empty()) {
+      costmap.grid.assign(MAP_WIDTH, std::vector<int>(MAP_HEIGHT, FREE_CELL));
+    }
+    build_costmap(scan.rays, scan.pose.heading, costmap.grid);
+
+    std::vector<glm::vec2> planned;
+    {
+      LATENCY_SCOPE(PLAN_LATENCY);
+      planned = planner.search(costmap.grid, from, to);
+    }
+    CountMetric(ASTAR_EXPANSIONS, planner.getExpandedNodes());
+    const std::vector<glm::vec2> &cells =
+        smoother.smooth(costmap.grid, planned);
+    PathSnapshot &path = paths.back();
+    path.pose = scan.pose;
+    cells_to_control_path(cells, path.path);
+
+    planStats.dropped += paths.publish();
+    costmaps.publish();
+    planStats.runs++;
+    planStats.busySeconds += Since(workBegin);
+  }
+}
+
+void Pipeline::act() {
+  SetTraceThreadName("act");
+  // after a long stall, drop the steps past this rather than spiral
+  const int maxSteps = 250;
+  double time = 0.0;
+  while (running) {
+    auto workBegin = std::chrono::steady_clock::now();
+    const double target = getClock();
+    int stepped = 0;
+    for (; time + stepSeconds <= target && stepped < maxSteps; stepped++) {
+      if (crashed == pose.resets + 1) {
+        crashes++;
+        reset();
+        pose.resets++;
+      }
+
+      if (paths.update() && paths.front().pose.resets == pose.resets) {
+        // planned in the frame of the car where the scan was taken, so tell
+        // the loop where the car has got to since
+        const PathSnapshot &planned = paths.front();
+        float then = planned.pose.heading;
+        glm::vec2 forward(-std::cos(then), std::sin(then));
+        glm::vec2 left(-forward.y, forward.x);
+        glm::vec2 moved = pose.position - planned.pose.position;
+        controlLoop.setPath(planned.path,
+                            {glm::dot(moved, forward), glm::dot(moved, left)},
+                            then - car.heading);
+        speed = config.speed;
+      }
+      float steer = controlLoop.step(stepSeconds, car.velocity);
+      steeringAngle = -steer / glm::radians(Car::maxSteeringDegrees);
+
+      // the same step as Episode::step()
+      float heading = car.heading;
+      float moved;
+      {
+        LATENCY_SCOPE(PHYSICS_LATENCY);
+        moved = car.update(steeringAngle * Car::maxSteeringDegrees,
+                           drive_torque(car, speed), stepSeconds);
+      }
+      pose.position += glm::vec2(-std::cos(heading), std::sin(heading)) * moved;
+      distance += std::abs(moved);
+      time += stepSeconds;
+      steps++;
+      // between scans a scenario's walls catch the car, as in Episode::step()
+      if (config.scenario &&
+          config.scenario->getDistance(pose.position) < LIDAR_CRASH_DISTANCE) {
+        crashes++;
+        reset();
+        pose.resets++;
+      }
+    }
+    if (stepped == maxSteps) {
+      time = std::max(time, target - stepSeconds);
+    }
+
+    if (stepped > 0) {
+      pose.time = time;
+      publishPose();
+      actStats.runs++;
+      actStats.busySeconds += Since(workBegin);
+    }
+    sleepUntil(time + stepSeconds);
+  }
+}
@@ -0,0 +1,156 @@
+#ifndef SIMULATION_PIPELINE_H
+#define SIMULATION_PIPELINE_H
+
+#pragma once
+
+#include "../Control/ControlLoop.h"
+#include "../Control/PurePursuit.h"
+#include "../Control/Stanley.h"
+#include "../Infinite/backend/Software/BVH.h"
+#include "../Infinite/frontend/Car.h"
+#include "../Planning/JumpPointSearch.h"
+#include "../Planning/OccupancyGrid.h"
+#include "../Planning/PathSmoother.h"
+#include "Episode.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <thread>
+#include <vector>
+
+struct PipelineConfig {
+  double senseRate = 60.0; // LIDAR scans per simulated second
+  double planRate = 0.0;   // plans per simulated second, 0 for every new scan
+  double controlRate = 100.0; // controller ticks per simulated second
+  double timeScale = 1.0;     // simulated seconds per wall clock second
+};
+
+// where the car was at some point, each snapshot below carries one
+struct PoseSnapshot {
+  double time = 0.0; // simulated seconds
+  glm::vec2 position{0.0f};
+  float heading = 0.0f;
+  float velocity = 0.0f;
+  uint64_t resets = 0; // times the car has been put back at the start
+};
+
+struct ScanSnapshot {
+  PoseSnapshot pose; // traced from
+  std::vector<Ray> rays;
+};
+
+struct CostmapSnapshot {
+  PoseSnapshot pose; // of the scan it was built from
+  OccupancyGrid grid;
+};
+
+struct PathSnapshot {
+  PoseSnapshot pose; // of the scan it was planned on
+  std::vector<glm::vec2> path; // metres, cells_to_control_path()
+};
+
+// how one stage kept up, only read it once the pipeline has stopped
+struct StageStats {
+  uint64_t runs = 0;
+  double busySeconds = 0.0;
+  // scans or paths it published that the next stage never got to
+  uint64_t dropped = 0;
+
+  double getAverageSeconds() const { return runs ? busySeconds / runs : 0.0; }
+};
+
+// The sense, plan and act steps of an Episode, each on a thread of its own
+// and at a rate of its own, so a frame only takes as long as the slowest of
+// them rather than all of them back to back:
+//
+//   act    steps the physics at stepSeconds and the controller at
+//          controlRate, and publishes the car's pose
+//   sense  traces LIDAR from the newest pose at senseRate
+//   plan   builds the costmap and plans on the newest scan
+//   render whoever calls getRenderPose(), usually the main thread
+//
+// Stages only ever see each other's results through TripleBuffers, so none
+// of them waits on another and each works on the newest snapshot there is.
+// Scans (and so costmaps and paths) are world aligned and only centred on
+// the car, so a path planned a few steps ago carries over to where the car
+// is now by shifting it.
+//
+// All stages share one clock, wall time times timeScale. What the car does
+// depends on how the threads are scheduled, so this is not for deterministic
+// runs; Episode is.
+class Pipeline {
+public:
+  Pipeline(const EpisodeConfig &config, const PipelineConfig &pipeline,
+           double stepSeconds);
+  ~Pipeline();
+  Pipeline(const Pipeline &) = delete;
+  Pipeline &operator=(const Pipeline &) = delete;
+
+  void start();
+  void stop();
+
+  // simulated seconds since start()
+  double getClock() const;
+  // the newest pose and costmap for drawing, each only to be called from one
+  // thread
+  const PoseSnapshot &getRenderPose();
+  const CostmapSnapshot &getRenderCostmap();
+
+  const StageStats &getSenseStats() const { return senseStats; }
+  const StageStats &getPlanStats() const { return planStats; }
+  const StageStats &getActStats() const { return actStats; }
+  uint64_t getSteps() const { return steps; }
+  uint32_t getCrashes() const { return crashes; }
+  float getDistance() const { return distance; }
+
+private:
+  EpisodeConfig config;
+  PipelineConfig settings;
+  double stepSeconds;
+
+  std::atomic<bool> running{false};
+  std::chrono::steady_clock::time_point begin;
+  std::thread senseThread;
+  std::thread planThread;
+  std::thread actThread;
+
+  TripleBuffer<PoseSnapshot> sensePoses;
+  TripleBuffer<PoseSnapshot> renderPoses;
+  TripleBuffer<ScanSnapshot> scans;
+  TripleBuffer<CostmapSnapshot> costmaps;
+  TripleBuffer<PathSnapshot> paths;
+  // set by sense to the resets count + 1 of the pose it saw a crash from
+  std::atomic<uint64_t> crashed{0};
+
+  // act
+  Car car;
+  PoseSnapshot pose;
+  float speed = 0.0f;
+  float steeringAngle = 0.0f;
+  PurePursuit purePursuit;
+  Stanley stanley;
+  ControlLoop controlLoop;
+  uint64_t steps = 0;
+  uint32_t crashes = 0;
+  float distance = 0.0f;
+
+  // plan
+  JumpPointSearch planner;
+  PathSmoother smoother;
+
+  StageStats senseStats;
+  StageStats planStats;
+  StageStats actStats;
+
+  void reset();
+  void publishPose();
+  void sleepUntil(double clock) const;
+
+  void sense();
+  void plan();
+  void act();
+};
+
+#endif // SIMULATION_PIPELINE_H
@@ -0,0 +1,81 @@
+#include "Race.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+Race::Race(const EpisodeConfig &config, const RaceConfig &race,
+           double stepSeconds, uint64_t autonomyInterval)
+    : config(config), halfSize(race.carSize * 0.5f),
+      stepSeconds(stepSeconds),
+      autonomyInterval(std::max<uint64_t>(1, autonomyInterval)) {
+  glm::vec2 forward(-std::cos(config.startHeading),
+                    std::sin(config.startHeading));
+  glm::vec2 left(-forward.y, forward.x);
+  for (int i = 0; i < race.cars; i++) {
+    EpisodeConfig car = config;
+    car.seed = config.seed + i;
+    car.start = config.start - forward * (race.gridSpacing * i) +
+                left * (i % 2 == 0 ? race.gridOffset : -race.gridOffset);
+    cars.emplace_back(new Episode(car, stepSeconds, autonomyInterval));
+  }
+  instances.resize(cars.size());
+}
+
+void Race::step() {
+  // the cars only look on the same steps as Episode::step() does
+  if (ticks++ % autonomyInterval == 0) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < cars.size(); i++) {
+      instances[i].position = cars[i]->getPosition();
+      instances[i].heading = cars[i]->getHeading();
+      instances[i].halfSize = halfSize;
+    }
+    tlas.build(instances);
+    buildSeconds += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - begin)
+                        .count();
+    builds++;
+  }
+
+  // everything but Car::update(), which the cars that drive with it do
+  // together in batch
+  moving.assign(cars.size(), 0);
+#pragma omp parallel for
+  for (int i = 0; i < (int)cars.size(); i++) {
+    if (!cars[i]->beginStep(&tlas, i)) {
+      continue;
+    }
+    if (cars[i]->usesCar()) {
+      moving[i] = 1;
+    } else {
+      cars[i]->endStep(cars[i]->move());
+    }
+  }
+
+  batch.clear();
+  for (size_t i = 0; i < cars.size(); i++) {
+    if (moving[i]) {
+      cars[i]->loadCar(batch);
+    }
+  }
+  batch.update(stepSeconds);
+  size_t index = 0;
+  for (size_t i = 0; i < cars.size(); i++) {
+    if (moving[i]) {
+      cars[i]->endStep(cars[i]->storeCar(batch, index++));
+    }
+  }
+}
+
+std::vector<EpisodeSummary> Race::run() {
+  const uint64_t steps = std::llround(config.seconds / stepSeconds);
+  for (uint64_t i = 0; i < steps; i++) {
+    step();
+  }
+
+  std::vector<EpisodeSummary> summaries;
+  for (const auto &car : cars) {
+    summaries.push_back(car->getSummary());
+  }
+  return summaries;
+}
@@ -0,0 +1,58 @@
+#ifndef SIMULATION_RACE_H
+#define SIMULATION_RACE_H
+
+#pragma once
+
+#include "../Infinite/backend/Software/CarTLAS.h"
+#include "Episode.h"
+#include <memory>
+#include <vector>
+
+struct RaceConfig {
+  int cars = 2;
+  float gridSpacing = 0.8f; // metres between one car and the next behind it
+  float gridOffset = 0.15f; // metres either side of the start line, F1 style
+  glm::vec3 carSize{0.5f, 0.3f, 0.15f}; // metres, length, width and height
+};
+
+// Several cars on the same track at once, each an Episode with its own
+// sensor, planner and controller. Whenever the LIDAR is due the cars' boxes
+// go into a fresh CarTLAS, and all of them sense and drive from that same
+// snapshot, so the order they are stepped in doesn't matter and they step
+// in parallel. The physics of the cars Car::update() drives then steps in
+// one CarBatch.
+class Race {
+public:
+  // car i starts i grid slots behind config.start, with seed config.seed + i
+  Race(const EpisodeConfig &config, const RaceConfig &race,
+       double stepSeconds, uint64_t autonomyInterval);
+
+  void step();
+  // runs every car for config.seconds, summaries are in car order
+  std::vector<EpisodeSummary> run();
+
+  size_t size() const { return cars.size(); }
+  const Episode &getCar(size_t i) const { return *cars[i]; }
+  const CarTLAS &getTLAS() const { return tlas; }
+  // wall clock per TLAS build
+  double getAverageBuildSeconds() const {
+    return builds ? buildSeconds / builds : 0.0;
+  }
+
+private:
+  EpisodeConfig config;
+  glm::vec3 halfSize;
+  double stepSeconds;
+  uint64_t autonomyInterval;
+  uint64_t ticks = 0;
+  // Episodes hold pointers into themselves, so they don't move
+  std::vector<std::unique_ptr<Episode>> cars;
+  std::vector<CarInstance> instances;
+  CarTLAS tlas;
+  CarBatch batch;
+  std::vector<uint8_t> moving; // cars with their step still to finish in batch
+  uint64_t builds = 0;
+  double buildSeconds = 0.0;
+};
+
+#endif // SIMULATION_RACE_H
@@ -0,0 +1,156 @@
+#include "Replay.h"
+#include "Autonomy.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <glm/geometric.hpp>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+void SetCar(const TrajectoryStep &step) {
+  car.heading = step.heading;
+  car.velocity = step.velocity;
+  car.acceleration = step.acceleration;
+  car.angularVelocity = step.angularVelocity;
+}
+} // namespace
+
+ReplayResult RunReplay(TrajectoryReader &log, const ReplayOptions &options) {
+  ReplayResult result;
+  if (log.getChunkCount() == 0) {
+    return result;
+  }
+
+  const double step = log.getStepSeconds();
+  const uint64_t autonomyInterval =
+      std::max<uint64_t>(1, std::llround(deltaTime / step));
+  const uint64_t first = std::llround(std::max(0.0, options.from) / step);
+  const uint64_t last =
+      options.to < 0.0
+          ? log.getSteps()
+          : std::min<uint64_t>(log.getSteps(), std::llround(options.to / step));
+
+  // the car going into a scan's step is the one logged the step before
+  TrajectoryStep previous = {};
+  size_t chunkIndex = log.findChunk(first);
+  if (chunkIndex > 0) {
+    const TrajectoryChunk &before = log.readChunk(chunkIndex - 1);
+    previous = before.getStep(before.steps - 1);
+  }
+
+  // update2() reads a whole scan, cast the way TraceLidar() casts them
+  if (log.getRays() != LIDAR_RAYS) {
+    throw std::runtime_error("the log has " + std::to_string(log.getRays()) +
+                             " rays a scan, not " +
+                             std::to_string(LIDAR_RAYS));
+  }
+  LIDAR.resize(log.getRays());
+  std::vector<glm::vec2> loggedPath;
+  auto begin = std::chrono::steady_clock::now();
+  for (; chunkIndex < log.getChunkCount(); chunkIndex++) {
+    const TrajectoryChunk &chunk = log.readChunk(chunkIndex);
+    if (chunk.firstStep >= last) {
+      break;
+    }
+
+    for (uint32_t scan = 0; scan < chunk.scans; scan++) {
+      uint32_t local = chunk.getScanStep(scan);
+      uint64_t scanStep = chunk.firstStep + local;
+      if (scanStep < first || scanStep >= last) {
+        continue;
+      }
+
+      const float *ranges = chunk.getRanges(scan);
+      float closest = *std::min_element(ranges, ranges + chunk.rays);
+      if (closest < LIDAR_CRASH_DISTANCE) {
+        // the recorded run put the car back instead of planning
+        result.crashes++;
+        continue;
+      }
+
+      if (options.speed > 0.0) {
+        std::this_thread::sleep_until(
+            begin + std::chrono::duration_cast<
+                        std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(
+                            (scanStep - first) * step / options.speed)));
+      }
+
+      SetCar(local > 0 ? chunk.getStep(local - 1) : previous);
+      for (uint32_t i = 0; i < chunk.rays; i++) {
+        LIDAR[i].t = ranges[i];
+      }
+      speed = 0.0f;
+      steeringAngle = 0.0f;
+      auto planBegin = std::chrono::steady_clock::now();
+      update2(autonomyInterval * step);
+      double planSeconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - planBegin)
+                               .count();
+
+      ReplayScan replayed;
+      replayed.step = scanStep;
+      replayed.seconds = planSeconds;
+      replayed.speed = speed;
+      replayed.steeringAngle = steeringAngle;
+      replayed.pathPoints = (uint32_t)control_path.size();
+      TrajectoryStep logged = chunk.getStep(local);
+      replayed.loggedSpeed = logged.speed;
+      replayed.loggedSteeringAngle = logged.steeringAngle;
+      chunk.getPath(scan, loggedPath);
+      replayed.loggedPathPoints = (uint32_t)loggedPath.size();
+      size_t shared = std::min(loggedPath.size(), control_path.size());
+      for (size_t i = 0; i < shared; i++) {
+        replayed.pathDeviation =
+            std::max(replayed.pathDeviation,
+                     glm::distance(loggedPath[i], control_path[i]));
+      }
+
+      if (replayed.speed != replayed.loggedSpeed ||
+          replayed.steeringAngle != replayed.loggedSteeringAngle ||
+          replayed.pathPoints != replayed.loggedPathPoints ||
+          replayed.pathDeviation != 0.0f) {
+        result.mismatches++;
+      }
+      result.planSeconds += planSeconds;
+      result.maxPlanSeconds = std::max(result.maxPlanSeconds, planSeconds);
+      result.scans.push_back(replayed);
+    }
+    previous = chunk.getStep(chunk.steps - 1);
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  return result;
+}
+
+void WriteReplay(const std::string &filename, const ReplayResult &a,
+                 const ReplayResult *b) {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  file << "step,logged_speed,logged_steering,logged_path_points,seconds,speed,"
+          "steering,path_points,path_deviation";
+  if (b) {
+    file << ",b_seconds,b_speed,b_steering,b_path_points,b_path_deviation";
+  }
+  file << '\n';
+  for (size_t i = 0; i < a.scans.size(); i++) {
+    const ReplayScan &s = a.scans[i];
+    file << s.step << ',' << s.loggedSpeed << ',' << s.loggedSteeringAngle
+         << ',' << s.loggedPathPoints << ',' << s.seconds << ',' << s.speed
+         << ',' << s.steeringAngle << ',' << s.pathPoints << ','
+         << s.pathDeviation;
+    // both replays skip the same crashed scans, so they line up
+    if (b && i < b->scans.size()) {
+      const ReplayScan &t = b->scans[i];
+      file << ',' << t.seconds << ',' << t.speed << ',' << t.steeringAngle
+           << ',' << t.pathPoints << ',' << t.pathDeviation;
+    }
+    file << '\n';
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef SIMULATION_REPLAY_H
+#define SIMULATION_REPLAY_H
+
+#pragma once
+
+#include "TrajectoryLog.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ReplayOptions {
+  double from = 0.0; // seconds into the log to start at
+  double to = -1.0;  // seconds into the log to stop at, -1 for the end
+  // times real time to pace the scans at, 0 for as fast as they go
+  double speed = 0.0;
+};
+
+// what update2() made of one logged scan
+struct ReplayScan {
+  uint64_t step = 0;
+  double seconds = 0.0; // wall clock in update2()
+  float speed = 0.0f;
+  float steeringAngle = 0.0f;
+  uint32_t pathPoints = 0;
+  // what the run that was recorded did with the same scan
+  float loggedSpeed = 0.0f;
+  float loggedSteeringAngle = 0.0f;
+  uint32_t loggedPathPoints = 0;
+  // furthest apart the two paths get, metres, over the points both have
+  float pathDeviation = 0.0f;
+};
+
+struct ReplayResult {
+  std::vector<ReplayScan> scans;
+  uint32_t crashes = 0;     // scans the car crashed on, which aren't replayed
+  uint32_t mismatches = 0;  // scans that didn't come out exactly as logged
+  double seconds = 0.0;     // wall clock for the whole replay
+  double planSeconds = 0.0; // of which in update2()
+  double maxPlanSeconds = 0.0;
+
+  double getScansPerSecond() const {
+    return seconds > 0.0 ? scans.size() / seconds : 0.0;
+  }
+};
+
+// Drives update2() from a recorded log instead of the BVH: each scan the log
+// has goes straight into LIDAR, with the car as it was going into that step,
+// and whatever update2() comes up with is put next to what was logged. No
+// track, LIDAR tracing or physics is involved, so it runs as fast as the
+// planners and controllers do, or paced at options.speed times real time.
+//
+// With deterministic set on both the recording and the replay, the same build
+// replays every scan exactly as logged; a different build, or a different
+// planner picked with set_planner(), shows where and by how much it differs.
+// Throws std::runtime_error if the log's scans aren't LIDAR_RAYS rays each
+ReplayResult RunReplay(TrajectoryReader &log, const ReplayOptions &options);
+
+// one CSV row per scan of a, and of b next to it if it isn't null (a replay of
+// the same log with something changed)
+void WriteReplay(const std::string &filename, const ReplayResult &a,
+                 const ReplayResult *b = nullptr);
+
+#endif // SIMULATION_REPLAY_H
@@ -0,0 +1,60 @@
+#ifndef SIMULATION_RING_BUFFER_H
+#define SIMULATION_RING_BUFFER_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A bounded queue from one producer thread to one consumer thread without
+// locks. Unlike TripleBuffer every T pushed is kept until it's popped, but
+// once Capacity of them are waiting the producer's claim() fails instead of
+// waiting, so it is for producers that would rather drop something than
+// stall.
+//
+// The slots are reused in place: claim() a slot, fill it, push() it; peek()
+// at the oldest, read it, pop() it.
+template <typename T, size_t Capacity> class RingBuffer {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity has to be a power of two");
+
+public:
+  // producer side, nullptr if the ring is full
+  T *claim() {
+    if (head - cachedTail == Capacity) {
+      cachedTail = tail.load(std::memory_order_acquire);
+      if (head - cachedTail == Capacity) {
+        return nullptr;
+      }
+    }
+    return &slots[head & (Capacity - 1)];
+  }
+  void push() { publishedHead.store(++head, std::memory_order_release); }
+
+  // consumer side, nullptr if the ring is empty
+  const T *peek() {
+    if (consumerTail == cachedHead) {
+      cachedHead = publishedHead.load(std::memory_order_acquire);
+      if (consumerTail == cachedHead) {
+        return nullptr;
+      }
+    }
+    return &slots[consumerTail & (Capacity - 1)];
+  }
+  void pop() { tail.store(++consumerTail, std::memory_order_release); }
+
+private:
+  T slots[Capacity];
+
+  // the producer's, with the tail as it last saw it
+  alignas(64) uint64_t head = 0;
+  uint64_t cachedTail = 0;
+  alignas(64) std::atomic<uint64_t> publishedHead{0};
+  // the consumer's, with the head as it last saw it
+  alignas(64) uint64_t consumerTail = 0;
+  uint64_t cachedHead = 0;
+  alignas(64) std::atomic<uint64_t> tail{0};
+};
+
+#endif // SIMULATION_RING_BUFFER_H
@@ -0,0 +1,537 @@
+#include "Scenario.h"
+#include "../Planning/OccupancyGrid.h"
+#include "Autonomy.h"
+#include "Determinism.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <sstream>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const float LIDAR_HEIGHT = 0.05f;  // the z TraceLidar() is called at
+const float GRID_MARGIN = 0.5f;    // metres of grid past the outermost walls
+const uint32_t MAX_GRID_CELLS = 8192; // along a side, 160 m at 2 cm a cell
+
+size_t AlignSection(size_t bytes) {
+  return (bytes + SCENARIO_ALIGNMENT - 1) & ~(SCENARIO_ALIGNMENT - 1);
+}
+
+std::vector<uint8_t> ReadFile(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  std::vector<uint8_t> bytes((size_t)file.tellg());
+  file.seekg(0);
+  file.read((char *)bytes.data(), bytes.size());
+  return bytes;
+}
+
+uint64_t HashFile(const std::string &filename) {
+  std::vector<uint8_t> bytes = ReadFile(filename);
+  return StateHash().add(bytes.data(), bytes.size()).get();
+}
+
+struct Manifest {
+  std::string meshPath; // as the manifest has them
+  std::string texturePath;
+  std::vector<ScenarioPose> starts;
+  std::vector<ScenarioWaypoint> raceline;
+};
+
+Manifest LoadManifest(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  Manifest manifest;
+  std::string line;
+  for (int number = 1; std::getline(file, line); number++) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::string name;
+    if (!(words >> name)) {
+      continue;
+    }
+    bool read = true;
+    if (name == "mesh") {
+      read = (bool)(words >> manifest.meshPath);
+    } else if (name == "texture") {
+      read = (bool)(words >> manifest.texturePath);
+    } else if (name == "start") {
+      ScenarioPose pose;
+      read = (bool)(words >> pose.x >> pose.y >> pose.heading);
+      manifest.starts.push_back(pose);
+    } else if (name == "waypoint") {
+      ScenarioWaypoint waypoint{0.0f, 0.0f, 0.0f};
+      read = (bool)(words >> waypoint.x >> waypoint.y);
+      words >> waypoint.speed;
+      manifest.raceline.push_back(waypoint);
+    } else {
+      read = false;
+    }
+    if (!read) {
+      throw std::runtime_error(filename + ":" + std::to_string(number) +
+                               ": can't read \"" + line + "\"");
+    }
+  }
+  if (manifest.meshPath.empty() || manifest.starts.empty()) {
+    throw std::runtime_error(filename + " needs a mesh and at least one start");
+  }
+  return manifest;
+}
+
+// path as written next to from, as seen from the directory to
+std::string Rebase(const std::string &path, const std::string &from,
+                   const std::string &to) {
+  namespace fs = std::filesystem;
+  fs::path absolute =
+      (fs::absolute(from).parent_path() / path).lexically_normal();
+  fs::path relative = absolute.lexically_relative(
+      fs::absolute(to).parent_path().lexically_normal());
+  return relative.empty() ? absolute.string() : relative.string();
+}
+
+// every triangle that crosses z = height, cut into the segment it crosses in
+std::vector<ScenarioWall> CutWalls(const Infinite::Mesh &mesh, float height) {
+  std::vector<ScenarioWall> walls;
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    glm::vec3 corners[3] = {mesh.positions[mesh.indices[i]],
+                            mesh.positions[mesh.indices[i + 1]],
+                            mesh.positions[mesh.indices[i + 2]]};
+    glm::vec2 crossings[3];
+    int count = 0;
+    for (int j = 0; j < 3; j++) {
+      const glm::vec3 &a = corners[j];
+      const glm::vec3 &b = corners[(j + 1) % 3];
+      if ((a.z < height) != (b.z < height)) {
+        float t = (height - a.z) / (b.z - a.z);
+        crossings[count++] = glm::vec2(a.x + (b.x - a.x) * t,
+                                       a.y + (b.y - a.y) * t);
+      }
+    }
+    if (count == 2 && crossings[0] != crossings[1]) {
+      walls.push_back({crossings[0], crossings[1]});
+    }
+  }
+  return walls;
+}
+
+// Felzenszwalb and Huttenlocher's squared distance transform of one line of
+// the grid, in place: f is 0 on walls and FAR everywhere else, and becomes
+// the squared distance in cells to the nearest one
+const float FAR = 1e20f;
+
+void DistanceTransform(float *f, int n, int stride, std::vector<float> &d,
+                       std::vector<int> &v, std::vector<float> &z) {
+  d.resize(n);
+  v.resize(n);
+  z.resize(n + 1);
+  // the lower envelope of the parabolas rooted at every cell
+  int k = 0;
+  v[0] = 0;
+  z[0] = -INFINITY;
+  z[1] = INFINITY;
+  for (int q = 1; q < n; q++) {
+    float s;
+    for (;;) {
+      int p = v[k];
+      s = ((f[q * stride] + (float)q * q) - (f[p * stride] + (float)p * p)) /
+          (2.0f * (q - p));
+      if (s > z[k]) {
+        break;
+      }
+      k--;
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = INFINITY;
+  }
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    d[q] = (float)(q - v[k]) * (q - v[k]) + f[v[k] * stride];
+  }
+  for (int q = 0; q < n; q++) {
+    f[q * stride] = d[q];
+  }
+}
+
+struct Section {
+  ScenarioSectionType type;
+  std::vector<uint8_t> bytes;
+};
+
+template <typename T>
+Section MakeSection(ScenarioSectionType type, const T *values, size_t count) {
+  const uint8_t *bytes = (const uint8_t *)values;
+  return {type, std::vector<uint8_t>(bytes, bytes + count * sizeof(T))};
+}
+} // namespace
+
+void BuildScenario(const std::string &manifestPath,
+                   const std::string &bundlePath) {
+  Manifest manifest = LoadManifest(manifestPath);
+  std::string meshFile =
+      (std::filesystem::path(manifestPath).parent_path() / manifest.meshPath)
+          .string();
+  std::string textureFile;
+  if (!manifest.texturePath.empty()) {
+    textureFile = (std::filesystem::path(manifestPath).parent_path() /
+                   manifest.texturePath)
+                      .string();
+  }
+
+  ScenarioHeader header = {};
+  memcpy(header.magic, SCENARIO_MAGIC, sizeof(header.magic));
+  header.version = SCENARIO_VERSION;
+  header.meshHash = HashFile(meshFile);
+  header.textureHash = textureFile.empty() ? 0 : HashFile(textureFile);
+  header.wallHeight = LIDAR_HEIGHT;
+
+  Infinite::Mesh mesh = Infinite::LoadMesh(meshFile);
+  BuildBoundingVolumeHierarchy(mesh);
+  const CacheFriendlyBVHNode *nodes;
+  const int *triangleIndices;
+  unsigned nodeCount, triangleIndexCount;
+  GetBoundingVolumeHierarchy(nodes, nodeCount, triangleIndices,
+                             triangleIndexCount);
+
+  std::vector<ScenarioWall> walls = CutWalls(mesh, header.wallHeight);
+  glm::vec2 low(INFINITY), high(-INFINITY);
+  for (const ScenarioWall &wall : walls) {
+    low = glm::min(low, glm::min(wall.a, wall.b));
+    high = glm::max(high, glm::max(wall.a, wall.b));
+  }
+  if (walls.empty()) {
+    low = high = glm::vec2(0.0f);
+  }
+  // the same cells as the LIDAR costmap, so its buffers mean the same
+  header.cellsPerMetre = CELLS_PER_METER;
+  header.gridOriginX = low.x - GRID_MARGIN;
+  header.gridOriginY = low.y - GRID_MARGIN;
+  glm::vec2 extent = (high - low + 2.0f * GRID_MARGIN) * CELLS_PER_METER;
+  if (extent.x >= MAX_GRID_CELLS || extent.y >= MAX_GRID_CELLS) {
+    throw std::runtime_error(meshFile + " is too big a track for the grid");
+  }
+  header.gridWidth = (uint32_t)std::ceil(extent.x) + 1;
+  header.gridHeight = (uint32_t)std::ceil(extent.y) + 1;
+  const int width = header.gridWidth;
+  const int height = header.gridHeight;
+
+  // every cell a wall passes through, sampled twice a cell
+  std::vector<std::vector<int>> grid(width, std::vector<int>(height, FREE_CELL));
+  glm::vec2 origin(header.gridOriginX, header.gridOriginY);
+  for (const ScenarioWall &wall : walls) {
+    int samples =
+        (int)std::ceil(glm::length(wall.b - wall.a) * CELLS_PER_METER * 2.0f);
+    for (int i = 0; i <= samples; i++) {
+      glm::vec2 cell =
+          (glm::mix(wall.a, wall.b, (float)i / std::max(1, samples)) - origin) *
+          CELLS_PER_METER;
+      grid[(int)cell.x][(int)cell.y] = BLOCKED_CELL;
+    }
+  }
+
+  std::vector<float> distance((size_t)width * height);
+  for (int x = 0; x < width; x++) {
+    for (int y = 0; y < height; y++) {
+      distance[(size_t)x * height + y] =
+          grid[x][y] == BLOCKED_CELL ? 0.0f : FAR;
+    }
+  }
+#pragma omp parallel
+  {
+    std::vector<float> d, z;
+    std::vector<int> v;
+#pragma omp for
+    for (int x = 0; x < width; x++) {
+      DistanceTransform(&distance[(size_t)x * height], height, 1, d, v, z);
+    }
+#pragma omp for
+    for (int y = 0; y < height; y++) {
+      DistanceTransform(&distance[y], width, height, d, v, z);
+    }
+  }
+  for (float &cell : distance) {
+    cell = cell >= FAR ? INFINITY : std::sqrt(cell) / CELLS_PER_METER;
+  }
+
+  add_concentric_plus_buffers(grid, COSTMAP_HARD_BUFFER, COSTMAP_SOFT_BUFFER);
+  std::vector<uint8_t> costmap((size_t)width * height);
+  for (int x = 0; x < width; x++) {
+    for (int y = 0; y < height; y++) {
+      costmap[(size_t)x * height + y] = (uint8_t)grid[x][y];
+    }
+  }
+
+  std::string paths = Rebase(manifest.meshPath, manifestPath, bundlePath);
+  paths.push_back('\0');
+  if (!manifest.texturePath.empty()) {
+    paths += Rebase(manifest.texturePath, manifestPath, bundlePath);
+  }
+  paths.push_back('\0');
+
+  std::vector<Section> sections;
+  sections.push_back(MakeSection(SCENARIO_PATHS, paths.data(), paths.size()));
+  sections.push_back(MakeSection(SCENARIO_STARTS, manifest.starts.data(),
+                                 manifest.starts.size()));
+  sections.push_back(MakeSection(SCENARIO_RACELINE, manifest.raceline.data(),
+                                 manifest.raceline.size()));
+  sections.push_back(MakeSection(SCENARIO_POSITIONS, mesh.positions.data(),
+                                 mesh.positions.size()));
+  sections.push_back(MakeSection(SCENARIO_INDICES, mesh.indices.data(),
+                                 mesh.indices.size()));
+  sections.push_back(MakeSection(SCENARIO_BVH_NODES, nodes, nodeCount));
+  sections.push_back(
+      MakeSection(SCENARIO_BVH_TRIANGLES, triangleIndices, triangleIndexCount));
+  sections.push_back(MakeSection(SCENARIO_WALLS, walls.data(), walls.size()));
+  sections.push_back(
+      MakeSection(SCENARIO_DISTANCE, distance.data(), distance.size()));
+  sections.push_back(
+      MakeSection(SCENARIO_COSTMAP, costmap.data(), costmap.size()));
+
+  header.sections = (uint32_t)sections.size();
+  std::vector<ScenarioSection> table(sections.size());
+  uint64_t offset =
+      AlignSection(sizeof(header) + table.size() * sizeof(ScenarioSection));
+  for (size_t i = 0; i < sections.size(); i++) {
+    table[i] = {};
+    table[i].type = sections[i].type;
+    table[i].offset = offset;
+    table[i].size = sections[i].bytes.size();
+    table[i].hash =
+        StateHash().add(sections[i].bytes.data(), sections[i].bytes.size()).get();
+    offset = AlignSection(offset + table[i].size);
+  }
+  header.hash =
+      StateHash().add(table.data(), table.size() * sizeof(table[0])).get();
+
+  FILE *file = fopen(bundlePath.c_str(), "wb");
+  if (!file) {
+    throw std::runtime_error("failed to open file: " + bundlePath);
+  }
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(table.data(), sizeof(ScenarioSection), table.size(),
+                        file) == table.size();
+  const char zeros[SCENARIO_ALIGNMENT] = {};
+  for (size_t i = 0; written && i < sections.size(); i++) {
+    long padding = (long)table[i].offset - ftell(file);
+    written = fwrite(zeros, 1, padding, file) == (size_t)padding &&
+              fwrite(sections[i].bytes.data(), 1, sections[i].bytes.size(),
+                     file) == sections[i].bytes.size();
+  }
+  if (fclose(file) != 0 || !written) {
+    throw std::runtime_error("failed to write file: " + bundlePath);
+  }
+}
+
+Scenario::Scenario(const std::string &filename) : filename(filename) {
+#ifdef _WIN32
+  fallback = ReadFile(filename);
+  data = fallback.data();
+  size = fallback.size();
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  size = (size_t)info.st_size;
+  if (size > 0) {
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("failed to open file: " + filename);
+    }
+    data = (const uint8_t *)mapped;
+  }
+  ::close(fd);
+#endif
+
+  if (size < sizeof(header) ||
+      memcmp(data, SCENARIO_MAGIC, sizeof(SCENARIO_MAGIC)) != 0) {
+    unmap();
+    throw std::runtime_error("not a scenario bundle: " + filename);
+  }
+  memcpy(&header, data, sizeof(header));
+  if (header.version != SCENARIO_VERSION ||
+      sizeof(header) + (uint64_t)header.sections * sizeof(ScenarioSection) >
+          size) {
+    unmap();
+    throw std::runtime_error("the scenario bundle " + filename +
+                             " is from an incompatible build");
+  }
+  sections = (const ScenarioSection *)(data + sizeof(header));
+
+  try {
+    size_t count;
+    const char *paths = find<char>(SCENARIO_PATHS, count);
+    const char *end = paths + count;
+    const char *texture = std::find(paths, end, '\0');
+    if (texture == end || std::find(texture + 1, end, '\0') == end) {
+      throw std::runtime_error("bad paths in scenario bundle " + filename);
+    }
+    std::filesystem::path directory =
+        std::filesystem::path(filename).parent_path();
+    meshPath = (directory / paths).lexically_normal().string();
+    if (texture[1] != '\0') {
+      texturePath = (directory / (texture + 1)).lexically_normal().string();
+    }
+
+    starts = find<ScenarioPose>(SCENARIO_STARTS, startCount);
+    raceline = find<ScenarioWaypoint>(SCENARIO_RACELINE, racelineCount);
+    walls = find<ScenarioWall>(SCENARIO_WALLS, wallCount);
+    size_t cells = (size_t)header.gridWidth * header.gridHeight;
+    distance = find<float>(SCENARIO_DISTANCE, count);
+    if (count != cells) {
+      throw std::runtime_error("the distance field in " + filename +
+                               " isn't the size of its grid");
+    }
+    costmap = find<uint8_t>(SCENARIO_COSTMAP, count);
+    if (count != cells) {
+      throw std::runtime_error("the costmap in " + filename +
+                               " isn't the size of its grid");
+    }
+    if (startCount == 0) {
+      throw std::runtime_error("the scenario bundle " + filename +
+                               " has no starts");
+    }
+  } catch (...) {
+    unmap();
+    throw;
+  }
+}
+
+Scenario::~Scenario() { unmap(); }
+
+void Scenario::unmap() {
+#ifndef _WIN32
+  if (data) {
+    munmap((void *)data, size);
+    data = nullptr;
+  }
+#endif
+}
+
+const ScenarioSection *Scenario::getSection(ScenarioSectionType type) const {
+  for (uint32_t i = 0; i < header.sections; i++) {
+    if (sections[i].type == type) {
+      return &sections[i];
+    }
+  }
+  return nullptr;
+}
+
+template <typename T>
+const T *Scenario::find(ScenarioSectionType type, size_t &count,
+                        bool required) const {
+  count = 0;
+  const ScenarioSection *section = getSection(type);
+  if (!section) {
+    if (required) {
+      throw std::runtime_error("the scenario bundle " + filename +
+                               " is missing section " + std::to_string(type));
+    }
+    return nullptr;
+  }
+  if (section->offset > size || section->size > size - section->offset ||
+      section->offset % SCENARIO_ALIGNMENT != 0 ||
+      section->size % sizeof(T) != 0) {
+    throw std::runtime_error("section " + std::to_string(type) +
+                             " of the scenario bundle " + filename +
+                             " is cut short");
+  }
+  count = section->size / sizeof(T);
+  return (const T *)(data + section->offset);
+}
+
+bool Scenario::cell(glm::vec2 position, size_t &index) const {
+  glm::vec2 cell =
+      (position - glm::vec2(header.gridOriginX, header.gridOriginY)) *
+      header.cellsPerMetre;
+  if (!(cell.x >= 0.0f && cell.y >= 0.0f && cell.x < header.gridWidth &&
+        cell.y < header.gridHeight)) {
+    return false;
+  }
+  index = (size_t)cell.x * header.gridHeight + (size_t)cell.y;
+  return true;
+}
+
+float Scenario::getDistance(glm::vec2 position) const {
+  size_t index;
+  return cell(position, index) ? distance[index] : 0.0f;
+}
+
+int Scenario::getCost(glm::vec2 position) const {
+  size_t index;
+  return cell(position, index) ? costmap[index] : BLOCKED_CELL;
+}
+
+Infinite::Mesh Scenario::getMesh() const {
+  size_t positions, indices;
+  const glm::vec3 *position = find<glm::vec3>(SCENARIO_POSITIONS, positions);
+  const uint32_t *index = find<uint32_t>(SCENARIO_INDICES, indices);
+  Infinite::Mesh mesh;
+  mesh.positions.assign(position, position + positions);
+  mesh.texCoords.assign(positions, glm::vec2(0.0f));
+  mesh.indices.assign(index, index + indices);
+  return mesh;
+}
+
+void Scenario::useBoundingVolumeHierarchy() const {
+  size_t nodes, triangleIndices, positions, indices;
+  const CacheFriendlyBVHNode *node =
+      find<CacheFriendlyBVHNode>(SCENARIO_BVH_NODES, nodes);
+  const int *triangleIndex = find<int>(SCENARIO_BVH_TRIANGLES, triangleIndices);
+  const glm::vec3 *position = find<glm::vec3>(SCENARIO_POSITIONS, positions);
+  const uint32_t *index = find<uint32_t>(SCENARIO_INDICES, indices);
+  UseBoundingVolumeHierarchy(node, (unsigned)nodes, triangleIndex,
+                             (unsigned)triangleIndices, position, positions,
+                             index, indices);
+}
+
+void Scenario::verify() const {
+  StateHash table;
+  table.add(sections, header.sections * sizeof(ScenarioSection));
+  if (table.get() != header.hash) {
+    throw std::runtime_error("the section table of " + filename +
+                             " doesn't match its hash");
+  }
+  for (uint32_t i = 0; i < header.sections; i++) {
+    size_t count;
+    const uint8_t *bytes =
+        find<uint8_t>((ScenarioSectionType)sections[i].type, count);
+    if (StateHash().add(bytes, count).get() != sections[i].hash) {
+      throw std::runtime_error("section " + std::to_string(sections[i].type) +
+                               " of " + filename +
+                               " doesn't match its hash");
+    }
+  }
+}
+
+bool Scenario::isMeshChanged() const {
+  try {
+    return HashFile(meshPath) != header.meshHash;
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+}
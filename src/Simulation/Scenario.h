@@ -0,0 +1,186 @@
+#ifndef SIMULATION_SCENARIO_H
+#define SIMULATION_SCENARIO_H
+
+#pragma once
+
+#include "../Infinite/backend/Model/Mesh.h"
+#include "../Infinite/backend/Software/BVH.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <string>
+#include <vector>
+
+// Scenario bundles: a track with everything that is otherwise worked out
+// from its OBJ on every start, worked out once. A bundle names the OBJ and
+// texture the window draws, and holds the start poses and raceline from its
+// manifest, plus
+//   the mesh's triangles and the BVH over them, ready to trace against
+//   the walls, the mesh cut at LIDAR height into 2D segments
+//   a distance field, metres from every cell of a grid over the track to
+//     the nearest wall
+//   a costmap over the same grid, with the same FREE, INFLATED and BLOCKED
+//     cells around the walls as build_costmap() makes
+//
+// The simulation reads the starts, the BVH and, for Episode's crash check,
+// the distance field. The raceline, walls and costmap are stored for later
+// use only: nothing but F1TenthScenario check reads them yet.
+//
+// The file is a ScenarioHeader, a table of sections, then the sections, each
+// on a 64 byte boundary and with a hash of its bytes. It is loaded with one
+// mmap() and read in place, so switching tracks costs about as much as
+// copying the triangles into the BVH's arrays.
+//
+// A bundle is built from a manifest by F1TenthScenario, one setting a line
+// and # starting a comment:
+//   mesh track.obj              the OBJ, relative to the manifest
+//   texture track.png           optional, likewise
+//   start -1 0.9 0              x y heading, episodes take them in turn
+//   waypoint 1.5 0.9 0.2        x y speed, the raceline in order
+// At least one start is needed.
+
+const char SCENARIO_MAGIC[8] = "F1TSCEN";
+const uint32_t SCENARIO_VERSION = 1;
+const size_t SCENARIO_ALIGNMENT = 64;
+
+enum ScenarioSectionType : uint32_t {
+  SCENARIO_PATHS = 1,     // mesh then texture path, NUL terminated, relative
+                          // to the bundle
+  SCENARIO_STARTS,        // ScenarioPose[]
+  SCENARIO_RACELINE,      // ScenarioWaypoint[]
+  SCENARIO_POSITIONS,     // glm::vec3[], the mesh's vertices
+  SCENARIO_INDICES,       // uint32_t[], three per triangle
+  SCENARIO_BVH_NODES,     // CacheFriendlyBVHNode[]
+  SCENARIO_BVH_TRIANGLES, // int[], what the BVH's leaves index
+  SCENARIO_WALLS,         // ScenarioWall[]
+  SCENARIO_DISTANCE,      // float[gridWidth * gridHeight]
+  SCENARIO_COSTMAP,       // uint8_t[gridWidth * gridHeight]
+  SCENARIO_SECTION_COUNT
+};
+
+// where a car starts, in the same terms as EpisodeConfig's start
+struct ScenarioPose {
+  float x, y;    // metres
+  float heading; // radians, Car::heading
+};
+
+struct ScenarioWaypoint {
+  float x, y;  // metres
+  float speed; // drive command, 0 if the manifest didn't say
+};
+
+struct ScenarioWall {
+  glm::vec2 a, b; // metres
+};
+
+struct ScenarioHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t sections;
+  uint64_t meshHash;    // of the OBJ's bytes when the bundle was built
+  uint64_t textureHash; // 0 with no texture
+  uint64_t hash;        // of the section table, so of every section
+
+  // the grid the distance field and costmap are on. Cell (x, y) covers
+  // gridOrigin + (x, y) / cellsPerMetre and is at x * gridHeight + y
+  float gridOriginX, gridOriginY; // metres
+  float cellsPerMetre;
+  uint32_t gridWidth, gridHeight;
+  float wallHeight; // the z the walls were cut at
+};
+
+struct ScenarioSection {
+  uint32_t type; // a ScenarioSectionType
+  uint32_t reserved;
+  uint64_t offset; // from the start of the file
+  uint64_t size;   // bytes
+  uint64_t hash;   // StateHash of the bytes
+};
+
+static_assert(sizeof(ScenarioHeader) == 64 && sizeof(ScenarioSection) == 32 &&
+                  sizeof(CacheFriendlyBVHNode) == 32,
+              "the bundle's layout must not depend on the compiler");
+
+// builds the bundle manifestPath describes into bundlePath. Throws
+// std::runtime_error if the manifest or its mesh can't be read
+void BuildScenario(const std::string &manifestPath,
+                   const std::string &bundlePath);
+
+// A bundle, mapped. Everything it hands out points into the mapping and is
+// valid for as long as it is
+class Scenario {
+public:
+  // throws std::runtime_error if filename can't be opened, isn't a bundle or
+  // is from an incompatible build. The section hashes aren't checked, see
+  // verify()
+  explicit Scenario(const std::string &filename);
+  ~Scenario();
+  Scenario(const Scenario &) = delete;
+  Scenario &operator=(const Scenario &) = delete;
+
+  const ScenarioHeader &getHeader() const { return header; }
+  uint64_t getHash() const { return header.hash; }
+  const ScenarioSection *getSection(ScenarioSectionType type) const;
+
+  // resolved against the bundle's directory. The texture is empty if the
+  // manifest had none
+  const std::string &getMeshPath() const { return meshPath; }
+  const std::string &getTexturePath() const { return texturePath; }
+
+  size_t getStartCount() const { return startCount; }
+  const ScenarioPose &getStart(size_t i) const { return starts[i]; }
+  size_t getRacelineCount() const { return racelineCount; }
+  const ScenarioWaypoint *getRaceline() const { return raceline; }
+  size_t getWallCount() const { return wallCount; }
+  const ScenarioWall *getWalls() const { return walls; }
+
+  // metres from position to the nearest wall, 0 off the grid
+  float getDistance(glm::vec2 position) const;
+  // the static costmap's cell at position, BLOCKED_CELL off the grid
+  int getCost(glm::vec2 position) const;
+  const float *getDistanceField() const { return distance; }
+  const uint8_t *getCostmap() const { return costmap; }
+
+  // the mesh as LoadMesh() would give it, without texture coordinates
+  Infinite::Mesh getMesh() const;
+  // makes the bundle's BVH the one TraceLidar() traces, in place of any
+  // other. This bundle has to outlive it
+  void useBoundingVolumeHierarchy() const;
+
+  // throws std::runtime_error naming the first section whose bytes don't
+  // match their hash. Reads the whole bundle
+  void verify() const;
+  // true if the OBJ isn't what the bundle was built from any more
+  bool isMeshChanged() const;
+
+private:
+  std::string filename;
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  std::vector<uint8_t> fallback; // the file, where there is no mmap()
+
+  ScenarioHeader header;
+  const ScenarioSection *sections = nullptr;
+  std::string meshPath;
+  std::string texturePath;
+
+  const ScenarioPose *starts = nullptr;
+  size_t startCount = 0;
+  const ScenarioWaypoint *raceline = nullptr;
+  size_t racelineCount = 0;
+  const ScenarioWall *walls = nullptr;
+  size_t wallCount = 0;
+  const float *distance = nullptr;
+  const uint8_t *costmap = nullptr;
+
+  // the section's bytes, checked to hold count whole T. Throws if it's
+  // missing when required
+  template <typename T>
+  const T *find(ScenarioSectionType type, size_t &count,
+                bool required = true) const;
+  // the grid cell position is in, false off the grid
+  bool cell(glm::vec2 position, size_t &index) const;
+  void unmap();
+};
+
+#endif // SIMULATION_SCENARIO_H
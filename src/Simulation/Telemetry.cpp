@@ -0,0 +1,281 @@
+#include "Telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+double Now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+#ifdef __linux__
+struct TelemetryServer::Subscriber {
+  sockaddr_storage address;
+  socklen_t length;
+  double lastSeen;
+};
+
+TelemetryServer::TelemetryServer(const std::string &address) {
+  sockaddr_storage bound = {};
+  socklen_t length = 0;
+  if (address.rfind("unix:", 0) == 0) {
+    unixPath = address.substr(5);
+    sockaddr_un &local = (sockaddr_un &)bound;
+    if (unixPath.empty() || unixPath.size() >= sizeof(local.sun_path)) {
+      throw std::runtime_error("bad telemetry socket path: " + unixPath);
+    }
+    local.sun_family = AF_UNIX;
+    memcpy(local.sun_path, unixPath.c_str(), unixPath.size() + 1);
+    length = sizeof(sockaddr_un);
+    // left behind by a run that didn't get to clean up
+    unlink(unixPath.c_str());
+  } else if (address.rfind("udp:", 0) == 0) {
+    size_t colon = address.rfind(':');
+    std::string host = address.substr(4, colon - 4);
+    sockaddr_in &local = (sockaddr_in &)bound;
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)std::atoi(address.c_str() + colon + 1));
+    if (colon <= 4 || inet_pton(AF_INET, host.c_str(), &local.sin_addr) != 1) {
+      throw std::runtime_error("bad telemetry address: " + address);
+    }
+    length = sizeof(sockaddr_in);
+  } else {
+    throw std::runtime_error("telemetry address is udp:<ip>:<port> or "
+                             "unix:<path>: " +
+                             address);
+  }
+
+  socketFd = socket(bound.ss_family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (socketFd < 0 || bind(socketFd, (sockaddr *)&bound, length) != 0) {
+    int error = errno;
+    if (socketFd >= 0) {
+      close(socketFd);
+    }
+    throw std::runtime_error("failed to bind " + address + ": " +
+                             strerror(error));
+  }
+  epollFd = epoll_create1(0);
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = socketFd;
+  if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, socketFd, &event) != 0) {
+    close(socketFd);
+    if (epollFd >= 0) {
+      close(epollFd);
+    }
+    throw std::runtime_error("failed to set up epoll for " + address);
+  }
+
+  datagram.reserve(TELEMETRY_MAX_DATAGRAM);
+  running = true;
+  thread = std::thread(&TelemetryServer::serve, this);
+}
+
+TelemetryServer::~TelemetryServer() {
+  running = false;
+  if (thread.joinable()) {
+    thread.join();
+  }
+  close(epollFd);
+  close(socketFd);
+  if (!unixPath.empty()) {
+    unlink(unixPath.c_str());
+  }
+}
+
+void TelemetryServer::serve() {
+  epoll_event event;
+  while (running) {
+    // subscribing is the only thing that comes in, so the wait also paces
+    // how often the queue is drained: at most a millisecond behind
+    if (epoll_wait(epollFd, &event, 1, 1) > 0) {
+      receive();
+    }
+
+    double now = Now();
+    subscribers.erase(
+        std::remove_if(subscribers.begin(), subscribers.end(),
+                       [&](const Subscriber &subscriber) {
+                         return now - subscriber.lastSeen >
+                                TELEMETRY_SUBSCRIBER_TIMEOUT;
+                       }),
+        subscribers.end());
+
+    while (const Queued *message = queue.peek()) {
+      if (!subscribers.empty()) {
+        append(*message);
+      }
+      queue.pop();
+    }
+    flush();
+  }
+}
+
+void TelemetryServer::receive() {
+  uint8_t buffer[64];
+  for (;;) {
+    Subscriber from;
+    from.length = sizeof(from.address);
+    ssize_t size = recvfrom(socketFd, buffer, sizeof(buffer), 0,
+                            (sockaddr *)&from.address, &from.length);
+    if (size < 0) {
+      return; // EAGAIN, nothing more to read
+    }
+    TelemetryDatagram header;
+    TelemetryMessage message;
+    if ((size_t)size < sizeof(header) + sizeof(message)) {
+      continue;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    memcpy(&message, buffer + sizeof(header), sizeof(message));
+    if (header.magic != TELEMETRY_MAGIC ||
+        header.version != TELEMETRY_VERSION) {
+      continue;
+    }
+
+    auto known = std::find_if(
+        subscribers.begin(), subscribers.end(), [&](const Subscriber &s) {
+          return s.length == from.length &&
+                 memcmp(&s.address, &from.address, from.length) == 0;
+        });
+    if (message.type == TELEMETRY_UNSUBSCRIBE) {
+      if (known != subscribers.end()) {
+        subscribers.erase(known);
+      }
+    } else if (message.type == TELEMETRY_SUBSCRIBE) {
+      from.lastSeen = Now();
+      if (known != subscribers.end()) {
+        *known = from;
+      } else {
+        subscribers.push_back(from);
+      }
+    }
+  }
+}
+
+void TelemetryServer::append(const Queued &message) {
+  const void *payload = &message.state;
+  size_t payloadSize = sizeof(TelemetryState);
+  size_t rangesSize = 0;
+  if (message.type == TELEMETRY_SCAN) {
+    payload = &message.scan;
+    payloadSize = sizeof(TelemetryScan);
+    rangesSize = message.scan.rays * sizeof(float);
+  }
+  size_t size = sizeof(TelemetryMessage) + payloadSize + rangesSize;
+  if (datagram.size() + size > TELEMETRY_MAX_DATAGRAM) {
+    flush();
+  }
+  if (datagram.empty()) {
+    datagram.resize(sizeof(TelemetryDatagram));
+  }
+
+  TelemetryMessage header = {};
+  header.type = message.type;
+  header.size = (uint32_t)(payloadSize + rangesSize);
+  const uint8_t *bytes = (const uint8_t *)&header;
+  datagram.insert(datagram.end(), bytes, bytes + sizeof(header));
+  bytes = (const uint8_t *)payload;
+  datagram.insert(datagram.end(), bytes, bytes + payloadSize);
+  bytes = (const uint8_t *)message.ranges;
+  datagram.insert(datagram.end(), bytes, bytes + rangesSize);
+  datagramCount++;
+}
+
+void TelemetryServer::flush() {
+  if (datagramCount == 0) {
+    return;
+  }
+  TelemetryDatagram header;
+  header.magic = TELEMETRY_MAGIC;
+  header.version = TELEMETRY_VERSION;
+  header.count = datagramCount;
+  header.sequence = sent;
+  memcpy(datagram.data(), &header, sizeof(header));
+
+  for (const Subscriber &subscriber : subscribers) {
+    // a subscriber that isn't keeping up misses this one, nobody waits
+    if (sendto(socketFd, datagram.data(), datagram.size(), MSG_DONTWAIT,
+               (const sockaddr *)&subscriber.address,
+               subscriber.length) < 0) {
+      missed++;
+    }
+  }
+  sent++;
+  datagram.clear();
+  datagramCount = 0;
+}
+#else
+struct TelemetryServer::Subscriber {};
+
+TelemetryServer::TelemetryServer(const std::string &address) {
+  throw std::runtime_error("the telemetry server needs epoll: " + address);
+}
+
+TelemetryServer::~TelemetryServer() {}
+#endif
+
+bool TelemetryServer::publishState(const TrajectoryStep &state, uint64_t step,
+                                   double time, uint64_t resets) {
+  Queued *message = queue.claim();
+  if (!message) {
+    dropped++;
+    return false;
+  }
+  message->type = TELEMETRY_STATE;
+  TelemetryState &out = message->state;
+  out.step = step;
+  out.time = time;
+  out.resets = resets;
+  out.x = state.position.x;
+  out.y = state.position.y;
+  out.z = state.position.z;
+  out.heading = state.heading;
+  out.velocity = state.velocity;
+  out.acceleration = state.acceleration;
+  out.angularVelocity = state.angularVelocity;
+  out.speed = state.speed;
+  out.steeringAngle = state.steeringAngle;
+  out.reserved = 0;
+  queue.push();
+  return true;
+}
+
+bool TelemetryServer::publishScan(uint64_t step, double time,
+                                  const std::vector<Ray> &scan) {
+  Queued *message = queue.claim();
+  if (!message) {
+    dropped++;
+    return false;
+  }
+  message->type = TELEMETRY_SCAN;
+  TelemetryScan &out = message->scan;
+  out.step = step;
+  out.time = time;
+  // generateRaysAroundPoint()'s rays
+  out.angleMin = 0.0f;
+  out.angleIncrement = 0.5f * (float)M_PI / 180.0f;
+  out.rays = (uint32_t)std::min<size_t>(scan.size(), TELEMETRY_MAX_RAYS);
+  out.reserved = 0;
+  for (uint32_t i = 0; i < out.rays; i++) {
+    message->ranges[i] = scan[i].t;
+  }
+  queue.push();
+  return true;
+}
@@ -0,0 +1,143 @@
+#ifndef SIMULATION_TELEMETRY_H
+#define SIMULATION_TELEMETRY_H
+
+#pragma once
+
+#include "../Infinite/backend/Software/BVH.h"
+#include "RingBuffer.h"
+#include "TrajectoryLog.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves the car's state and LIDAR scans to whoever subscribes, over loopback
+// UDP ("udp:127.0.0.1:7600") or a Unix datagram socket ("unix:/tmp/f1.sock"),
+// for visualisers and loggers to attach to a running simulator.
+//
+// The simulation loop only ever copies a message into a RingBuffer; the
+// server's own thread batches them into datagrams and sends those to every
+// subscriber with non-blocking sends, waiting on the socket with epoll.
+// Nothing on the loop's side waits for anything: if the ring is full the
+// message is dropped, and if a subscriber's socket is full that subscriber
+// misses the datagram.
+//
+// The protocol is fixed layout, little endian, and versioned:
+//   client -> server  a TelemetryDatagram with one TELEMETRY_SUBSCRIBE
+//                     message, at least every TELEMETRY_SUBSCRIBER_TIMEOUT
+//                     seconds to stay subscribed, or TELEMETRY_UNSUBSCRIBE
+//   server -> client  TelemetryDatagrams of up to TELEMETRY_MAX_DATAGRAM
+//                     bytes, each a header and then count messages back to
+//                     back, every one a TelemetryMessage and its payload
+// Datagrams are numbered, so a client can tell how many it missed.
+
+const uint32_t TELEMETRY_MAGIC = 0x54543146; // "F1TT"
+const uint16_t TELEMETRY_VERSION = 1;
+const size_t TELEMETRY_MAX_DATAGRAM = 16384;
+const double TELEMETRY_SUBSCRIBER_TIMEOUT = 5.0;
+const int TELEMETRY_MAX_RAYS = 720;
+
+enum TelemetryType : uint16_t {
+  TELEMETRY_SUBSCRIBE = 1,
+  TELEMETRY_UNSUBSCRIBE = 2,
+  TELEMETRY_STATE = 3, // a TelemetryState
+  TELEMETRY_SCAN = 4,  // a TelemetryScan with rays ranges after it
+};
+
+struct TelemetryDatagram {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;    // messages that follow
+  uint64_t sequence; // datagrams sent before this one
+};
+
+struct TelemetryMessage {
+  uint16_t type;
+  uint16_t reserved;
+  uint32_t size; // of the payload that follows
+};
+
+// the car after a physics step: ground truth, odometry and commands
+struct TelemetryState {
+  uint64_t step;
+  double time; // simulated seconds
+  uint64_t resets;
+  float x, y, z;
+  float heading;
+  float velocity;
+  float acceleration;
+  float angularVelocity;
+  float speed;         // commanded
+  float steeringAngle; // commanded, fraction of full lock
+  uint32_t reserved;
+};
+
+// a LIDAR scan; ray i points at world angle angleMin + i * angleIncrement
+struct TelemetryScan {
+  uint64_t step;
+  double time;
+  float angleMin;
+  float angleIncrement;
+  uint32_t rays;
+  uint32_t reserved;
+  // followed by rays floats, metres
+};
+
+static_assert(sizeof(TelemetryDatagram) == 16 && sizeof(TelemetryMessage) == 8 &&
+                  sizeof(TelemetryState) == 64 && sizeof(TelemetryScan) == 32,
+              "the protocol's layout must not depend on the compiler");
+
+class TelemetryServer {
+public:
+  // binds address, "udp:<ip>:<port>" or "unix:<path>", and starts serving.
+  // Throws std::runtime_error if it can't
+  explicit TelemetryServer(const std::string &address);
+  ~TelemetryServer();
+  TelemetryServer(const TelemetryServer &) = delete;
+  TelemetryServer &operator=(const TelemetryServer &) = delete;
+
+  // never block; false if the message was dropped because the server is
+  // behind
+  bool publishState(const TrajectoryStep &state, uint64_t step, double time,
+                    uint64_t resets);
+  bool publishScan(uint64_t step, double time, const std::vector<Ray> &scan);
+
+  // messages dropped because the ring was full
+  uint64_t getDropped() const { return dropped; }
+  // datagrams sent, and ones a subscriber missed because it wasn't reading
+  uint64_t getSent() const { return sent; }
+  uint64_t getMissed() const { return missed; }
+
+private:
+  struct Subscriber;
+  // a state or a scan, whichever type says
+  struct Queued {
+    uint16_t type;
+    TelemetryState state;
+    TelemetryScan scan;
+    float ranges[TELEMETRY_MAX_RAYS];
+  };
+
+  std::string unixPath;
+  int socketFd = -1;
+  int epollFd = -1;
+  std::thread thread;
+  std::atomic<bool> running{false};
+  RingBuffer<Queued, 256> queue;
+  uint64_t dropped = 0;
+
+  // the server thread's
+  std::vector<Subscriber> subscribers;
+  std::vector<uint8_t> datagram;
+  uint16_t datagramCount = 0;
+  std::atomic<uint64_t> sent{0};
+  std::atomic<uint64_t> missed{0};
+
+  void serve();
+  void receive();
+  void append(const Queued &message);
+  void flush();
+};
+
+#endif // SIMULATION_TELEMETRY_H
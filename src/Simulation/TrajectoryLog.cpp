@@ -0,0 +1,492 @@
+#include "TrajectoryLog.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+static_assert(sizeof(TrajectoryHeader) % 8 == 0, "columns must stay aligned");
+static_assert(sizeof(TrajectoryChunkHeader) % 8 == 0,
+              "columns must stay aligned");
+
+const char HEADER_MAGIC[8] = "F1TTRAJ";
+const char TRAILER_MAGIC[8] = "F1TINDX";
+
+size_t Align8(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+// words per scan or point in the columns that have more than one
+size_t Stride(int column, uint32_t rays) {
+  return column == COLUMN_RANGES ? rays : column == COLUMN_PATH ? 2 : 1;
+}
+
+size_t ColumnWords(int column, uint32_t steps, uint32_t scans,
+                   uint32_t pathPoints, uint32_t rays) {
+  if (column < COLUMN_SCAN_STEP) {
+    return steps;
+  }
+  if (column == COLUMN_RANGES) {
+    return (size_t)scans * rays;
+  }
+  if (column == COLUMN_PATH) {
+    return (size_t)pathPoints * 2;
+  }
+  return scans;
+}
+
+// words XORed with the word stride back, then written as bytes: a control
+// byte under 128 is followed by that many + 1 bytes as they are, 128 and up
+// stands for control - 127 zero bytes
+void Pack(const uint32_t *words, size_t count, size_t stride,
+          std::vector<uint8_t> &out) {
+  size_t literal = SIZE_MAX; // control byte of the run of bytes being copied
+  uint32_t zeros = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t word = words[i] ^ (i >= stride ? words[i - stride] : 0);
+    for (int b = 0; b < 4; b++) {
+      uint8_t byte = (word >> (8 * b)) & 0xFF;
+      if (byte == 0) {
+        literal = SIZE_MAX;
+        if (++zeros == 128) {
+          out.push_back(127 + zeros);
+          zeros = 0;
+        }
+        continue;
+      }
+      if (zeros > 0) {
+        out.push_back(127 + zeros);
+        zeros = 0;
+      }
+      if (literal == SIZE_MAX || out[literal] == 127) {
+        literal = out.size();
+        out.push_back(0);
+      } else {
+        out[literal]++;
+      }
+      out.push_back(byte);
+    }
+  }
+  if (zeros > 0) {
+    out.push_back(127 + zeros);
+  }
+}
+
+// false if in doesn't hold exactly count words
+bool Unpack(const uint8_t *in, size_t size, size_t count, size_t stride,
+            uint32_t *words) {
+  const size_t bytes = count * 4;
+  size_t at = 0;
+  std::fill(words, words + count, 0);
+  for (size_t i = 0; i < size;) {
+    uint8_t control = in[i++];
+    if (control >= 128) {
+      at += control - 127;
+      continue;
+    }
+    size_t run = control + 1;
+    if (i + run > size || at + run > bytes) {
+      return false;
+    }
+    for (size_t k = 0; k < run; k++, at++) {
+      words[at / 4] |= (uint32_t)in[i++] << (8 * (at % 4));
+    }
+  }
+  if (at != bytes) {
+    return false;
+  }
+  for (size_t i = stride; i < count; i++) {
+    words[i] ^= words[i - stride];
+  }
+  return true;
+}
+
+void Put(std::vector<uint32_t> &column, float value) {
+  uint32_t word;
+  std::memcpy(&word, &value, 4);
+  column.push_back(word);
+}
+} // namespace
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string &filename,
+                                       double stepSeconds, bool compress,
+                                       uint32_t chunkSteps, uint32_t chunkScans,
+                                       uint32_t rays)
+    : filename(filename), compress(compress),
+      chunkSteps(std::max<uint32_t>(1, chunkSteps)),
+      chunkScans(std::max<uint32_t>(1, chunkScans)), rays(rays) {
+  file = fopen(filename.c_str(), "wb");
+  if (!file) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  TrajectoryHeader header{};
+  std::memcpy(header.magic, HEADER_MAGIC, 8);
+  header.version = TRAJECTORY_VERSION;
+  header.rays = rays;
+  header.stepSeconds = stepSeconds;
+  failed = fwrite(&header, sizeof(header), 1, file) != 1;
+  offset = sizeof(header);
+
+  // everything record() touches is allocated up front, the path is the one
+  // column that can still grow
+  for (Chunk &chunk : buffers) {
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+      chunk.columns[c].reserve(
+          ColumnWords(c, this->chunkSteps, this->chunkScans, 256, rays));
+    }
+  }
+  filling = &buffers[0];
+  writer = std::thread(&TrajectoryRecorder::run, this);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+  try {
+    close();
+  } catch (const std::exception &) {
+    // nowhere to report it from a destructor, call close() to find out
+  }
+}
+
+void TrajectoryRecorder::record(const TrajectoryStep &step,
+                                const std::vector<Ray> *scan,
+                                const std::vector<glm::vec2> *path) {
+  Chunk &chunk = *filling;
+  Put(chunk.columns[COLUMN_X], step.position.x);
+  Put(chunk.columns[COLUMN_Y], step.position.y);
+  Put(chunk.columns[COLUMN_Z], step.position.z);
+  Put(chunk.columns[COLUMN_HEADING], step.heading);
+  Put(chunk.columns[COLUMN_VELOCITY], step.velocity);
+  Put(chunk.columns[COLUMN_ACCELERATION], step.acceleration);
+  Put(chunk.columns[COLUMN_ANGULAR_VELOCITY], step.angularVelocity);
+  Put(chunk.columns[COLUMN_SPEED], step.speed);
+  Put(chunk.columns[COLUMN_STEERING], step.steeringAngle);
+
+  if (scan) {
+    chunk.columns[COLUMN_SCAN_STEP].push_back(chunk.steps);
+    for (uint32_t i = 0; i < rays; i++) {
+      Put(chunk.columns[COLUMN_RANGES],
+          i < scan->size() ? (*scan)[i].t : INFINITY);
+    }
+    uint32_t length = path ? (uint32_t)path->size() : 0;
+    chunk.columns[COLUMN_PATH_LENGTH].push_back(length);
+    for (uint32_t i = 0; i < length; i++) {
+      Put(chunk.columns[COLUMN_PATH], (*path)[i].x);
+      Put(chunk.columns[COLUMN_PATH], (*path)[i].y);
+    }
+    chunk.scans++;
+  }
+
+  chunk.steps++;
+  steps++;
+  if (chunk.steps == chunkSteps || chunk.scans == chunkScans) {
+    submit();
+  }
+}
+
+void TrajectoryRecorder::submit() {
+  if (filling->steps == 0) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending) {
+      stalls++;
+      wake.wait(lock, [this] { return pending == nullptr; });
+    }
+    pending = filling;
+  }
+  wake.notify_all();
+
+  filling = filling == &buffers[0] ? &buffers[1] : &buffers[0];
+  for (std::vector<uint32_t> &column : filling->columns) {
+    column.clear();
+  }
+  filling->firstStep = steps;
+  filling->steps = 0;
+  filling->scans = 0;
+}
+
+void TrajectoryRecorder::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return pending != nullptr || stopping; });
+    if (!pending) {
+      return;
+    }
+    const Chunk *chunk = pending;
+    lock.unlock();
+    write(*chunk);
+    lock.lock();
+    pending = nullptr;
+    wake.notify_all();
+  }
+}
+
+void TrajectoryRecorder::write(const Chunk &chunk) {
+  TrajectoryChunkHeader header{};
+  header.magic = TRAJECTORY_CHUNK_MAGIC;
+  header.compressed = compress;
+  header.firstStep = chunk.firstStep;
+  header.steps = chunk.steps;
+  header.scans = chunk.scans;
+  header.pathPoints = (uint32_t)chunk.columns[COLUMN_PATH].size() / 2;
+
+  packed.resize(sizeof(header));
+  for (int c = 0; c < COLUMN_COUNT; c++) {
+    const std::vector<uint32_t> &column = chunk.columns[c];
+    size_t begin = packed.size();
+    if (compress) {
+      Pack(column.data(), column.size(), Stride(c, rays), packed);
+    } else {
+      packed.resize(begin + column.size() * 4);
+      std::memcpy(packed.data() + begin, column.data(), column.size() * 4);
+    }
+    header.sizes[c] = (uint32_t)(packed.size() - begin);
+    packed.resize(Align8(packed.size()), 0);
+  }
+  header.bytes = (uint32_t)packed.size();
+  std::memcpy(packed.data(), &header, sizeof(header));
+
+  index.push_back({offset, chunk.firstStep});
+  offset += packed.size();
+  if (fwrite(packed.data(), packed.size(), 1, file) != 1) {
+    failed = true;
+  }
+}
+
+void TrajectoryRecorder::close() {
+  if (closed) {
+    return;
+  }
+  closed = true;
+  submit();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  writer.join();
+
+  TrajectoryTrailer trailer{};
+  trailer.indexOffset = offset;
+  trailer.chunks = index.size();
+  std::memcpy(trailer.magic, TRAILER_MAGIC, 8);
+  if (!index.empty() && fwrite(index.data(), sizeof(TrajectoryIndexEntry),
+                               index.size(), file) != index.size()) {
+    failed = true;
+  }
+  if (fwrite(&trailer, sizeof(trailer), 1, file) != 1) {
+    failed = true;
+  }
+  if (fclose(file) != 0 || failed) {
+    throw std::runtime_error("failed to write file: " + filename);
+  }
+}
+
+float TrajectoryChunk::get(TrajectoryColumn column, uint32_t i) const {
+  float value;
+  std::memcpy(&value, &columns[column][i], 4);
+  return value;
+}
+
+TrajectoryStep TrajectoryChunk::getStep(uint32_t i) const {
+  TrajectoryStep step;
+  step.position = glm::vec3(get(COLUMN_X, i), get(COLUMN_Y, i),
+                            get(COLUMN_Z, i));
+  step.heading = get(COLUMN_HEADING, i);
+  step.velocity = get(COLUMN_VELOCITY, i);
+  step.acceleration = get(COLUMN_ACCELERATION, i);
+  step.angularVelocity = get(COLUMN_ANGULAR_VELOCITY, i);
+  step.speed = get(COLUMN_SPEED, i);
+  step.steeringAngle = get(COLUMN_STEERING, i);
+  return step;
+}
+
+void TrajectoryChunk::getPath(uint32_t scan,
+                              std::vector<glm::vec2> &path) const {
+  path.clear();
+  uint32_t first = pathOffsets[scan];
+  for (uint32_t i = 0; i < columns[COLUMN_PATH_LENGTH][scan]; i++) {
+    path.push_back(glm::vec2(get(COLUMN_PATH, 2 * (first + i)),
+                             get(COLUMN_PATH, 2 * (first + i) + 1)));
+  }
+}
+
+TrajectoryReader::TrajectoryReader(const std::string &filename)
+    : filename(filename) {
+#ifdef _WIN32
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  fallback.resize((size_t)file.tellg());
+  file.seekg(0);
+  file.read((char *)fallback.data(), fallback.size());
+  data = fallback.data();
+  size = fallback.size();
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  size = (size_t)info.st_size;
+  if (size > 0) {
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("failed to open file: " + filename);
+    }
+    data = (const uint8_t *)mapped;
+  }
+  ::close(fd);
+#endif
+
+  if (size < sizeof(header) ||
+      std::memcmp(data, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0) {
+    unmap();
+    throw std::runtime_error("not a trajectory log: " + filename);
+  }
+  std::memcpy(&header, data, sizeof(header));
+
+  TrajectoryTrailer trailer{};
+  if (size >= sizeof(header) + sizeof(trailer)) {
+    std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+  }
+  if (std::memcmp(trailer.magic, TRAILER_MAGIC, 8) == 0) {
+    // sizes from the file are checked by what is left of it, so nothing
+    // multiplied out of them can overflow
+    const uint64_t indexEnd = size - sizeof(trailer);
+    if (trailer.indexOffset < sizeof(header) ||
+        trailer.indexOffset > indexEnd ||
+        trailer.chunks > (indexEnd - trailer.indexOffset) /
+                             sizeof(TrajectoryIndexEntry)) {
+      unmap();
+      throw std::runtime_error("corrupt trajectory log index: " + filename);
+    }
+    chunks.resize(trailer.chunks);
+    std::memcpy(chunks.data(), data + trailer.indexOffset,
+                chunks.size() * sizeof(TrajectoryIndexEntry));
+    for (const TrajectoryIndexEntry &entry : chunks) {
+      TrajectoryChunkHeader chunkHeader;
+      if (entry.offset < sizeof(header) || entry.offset > trailer.indexOffset ||
+          trailer.indexOffset - entry.offset < sizeof(chunkHeader)) {
+        unmap();
+        throw std::runtime_error("corrupt trajectory log index: " + filename);
+      }
+      std::memcpy(&chunkHeader, data + entry.offset, sizeof(chunkHeader));
+      if (chunkHeader.magic != TRAJECTORY_CHUNK_MAGIC ||
+          chunkHeader.bytes < sizeof(chunkHeader) ||
+          chunkHeader.bytes > trailer.indexOffset - entry.offset) {
+        unmap();
+        throw std::runtime_error("corrupt trajectory log index: " + filename);
+      }
+    }
+  } else {
+    // no index, the recorder never got to close(): keep every whole chunk
+    uint64_t offset = sizeof(header);
+    TrajectoryChunkHeader chunkHeader;
+    while (offset + sizeof(chunkHeader) <= size) {
+      std::memcpy(&chunkHeader, data + offset, sizeof(chunkHeader));
+      if (chunkHeader.magic != TRAJECTORY_CHUNK_MAGIC ||
+          chunkHeader.bytes < sizeof(chunkHeader) ||
+          offset + chunkHeader.bytes > size) {
+        break;
+      }
+      chunks.push_back({offset, chunkHeader.firstStep});
+      offset += chunkHeader.bytes;
+    }
+  }
+
+  if (!chunks.empty()) {
+    TrajectoryChunkHeader last;
+    std::memcpy(&last, data + chunks.back().offset, sizeof(last));
+    steps = last.firstStep + last.steps;
+  }
+}
+
+TrajectoryReader::~TrajectoryReader() { unmap(); }
+
+void TrajectoryReader::unmap() {
+#ifndef _WIN32
+  if (data) {
+    munmap((void *)data, size);
+    data = nullptr;
+  }
+#endif
+}
+
+size_t TrajectoryReader::findChunk(uint64_t step) const {
+  auto after = std::upper_bound(
+      chunks.begin(), chunks.end(), step,
+      [](uint64_t step, const TrajectoryIndexEntry &entry) {
+        return step < entry.firstStep;
+      });
+  return after == chunks.begin() ? 0 : after - chunks.begin() - 1;
+}
+
+const TrajectoryChunk &TrajectoryReader::readChunk(size_t index) {
+  if (index == loaded) {
+    return chunk;
+  }
+
+  const uint64_t offset = chunks[index].offset;
+  TrajectoryChunkHeader chunkHeader;
+  std::memcpy(&chunkHeader, data + offset, sizeof(chunkHeader));
+  chunk.firstStep = chunkHeader.firstStep;
+  chunk.steps = chunkHeader.steps;
+  chunk.scans = chunkHeader.scans;
+  chunk.rays = header.rays;
+
+  // the constructor checked the chunk fits in the file, the columns are
+  // checked against the chunk as they go
+  size_t column = offset + sizeof(chunkHeader);
+  const size_t end = offset + chunkHeader.bytes;
+  for (int c = 0; c < COLUMN_COUNT; c++) {
+    size_t words = ColumnWords(c, chunkHeader.steps, chunkHeader.scans,
+                               chunkHeader.pathPoints, header.rays);
+    size_t stored = chunkHeader.sizes[c];
+    bool valid = column <= end && stored <= end - column;
+    if (valid && chunkHeader.compressed) {
+      // a control byte stands for at most 127 zero bytes, so a column can't
+      // unpack to more than that. Checked before allocating for it
+      valid = words <= stored * 127 / 4;
+    }
+    if (valid && chunkHeader.compressed) {
+      unpacked[c].resize(words);
+      valid = Unpack(data + column, stored, words, Stride(c, header.rays),
+                     unpacked[c].data());
+      chunk.columns[c] = unpacked[c].data();
+    } else {
+      valid = valid && stored % 4 == 0 && stored / 4 == words;
+      chunk.columns[c] = (const uint32_t *)(data + column);
+    }
+    if (!valid) {
+      loaded = SIZE_MAX;
+      throw std::runtime_error("corrupt trajectory log: " + filename);
+    }
+    column += Align8(stored);
+  }
+
+  chunk.pathOffsets.resize(chunk.scans);
+  uint64_t points = 0;
+  for (uint32_t i = 0; i < chunk.scans; i++) {
+    chunk.pathOffsets[i] = (uint32_t)points;
+    points += chunk.columns[COLUMN_PATH_LENGTH][i];
+    if (chunk.columns[COLUMN_SCAN_STEP][i] >= chunk.steps ||
+        points > chunkHeader.pathPoints) {
+      loaded = SIZE_MAX;
+      throw std::runtime_error("corrupt trajectory log: " + filename);
+    }
+  }
+  loaded = index;
+  return chunk;
+}
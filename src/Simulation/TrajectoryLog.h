@@ -0,0 +1,218 @@
+#ifndef SIMULATION_TRAJECTORY_LOG_H
+#define SIMULATION_TRAJECTORY_LOG_H
+
+#pragma once
+
+#include "../Infinite/backend/Software/BVH.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Trajectory logs: every physics step of a run, plus the LIDAR scan and the
+// planned path on the steps that sensed.
+//
+// The file is a header, then chunks of consecutive steps, then an index of
+// the chunks. Inside a chunk every value is a column of 4 byte words (all the
+// headings together, then all the velocities, ...), each column starting on
+// an 8 byte boundary, so an uncompressed log can be mapped and read in place.
+// Compressed columns are XORed with the value one stride back (the previous
+// step, or the same ray in the previous scan) and the zero bytes that leaves
+// squeezed out, which is cheap and does well on values that change slowly.
+// A log cut short by a crash has no index, and is read by walking the chunks.
+
+// the state after one physics step
+struct TrajectoryStep {
+  glm::vec3 position;    // camera, metres
+  float heading;         // Car::heading
+  float velocity;        // m/s
+  float acceleration;    // m/s^2
+  float angularVelocity; // rad/s
+  float speed;           // drive command
+  float steeringAngle;   // steering command, fraction of full lock
+};
+
+enum TrajectoryColumn {
+  // one word per step
+  COLUMN_X,
+  COLUMN_Y,
+  COLUMN_Z,
+  COLUMN_HEADING,
+  COLUMN_VELOCITY,
+  COLUMN_ACCELERATION,
+  COLUMN_ANGULAR_VELOCITY,
+  COLUMN_SPEED,
+  COLUMN_STEERING,
+  // one word per scan: the step in the chunk it was taken on, and how many
+  // points of the planned path go with it
+  COLUMN_SCAN_STEP,
+  COLUMN_PATH_LENGTH,
+  // rays words per scan
+  COLUMN_RANGES,
+  // x, y per path point, metres in the car's frame like control_path
+  COLUMN_PATH,
+  COLUMN_COUNT
+};
+
+const uint32_t TRAJECTORY_VERSION = 1;
+
+struct TrajectoryHeader {
+  char magic[8]; // "F1TTRAJ"
+  uint32_t version;
+  uint32_t rays; // per scan
+  double stepSeconds;
+};
+
+struct TrajectoryChunkHeader {
+  uint32_t magic; // TRAJECTORY_CHUNK_MAGIC
+  uint32_t compressed;
+  uint64_t firstStep;
+  uint32_t steps;
+  uint32_t scans;
+  uint32_t pathPoints;
+  uint32_t bytes;                // the whole chunk, header included
+  uint32_t sizes[COLUMN_COUNT]; // bytes of each column as stored
+  uint32_t reserved;            // keeps the columns after it 8 byte aligned
+};
+
+struct TrajectoryIndexEntry {
+  uint64_t offset;
+  uint64_t firstStep;
+};
+
+struct TrajectoryTrailer {
+  uint64_t indexOffset;
+  uint64_t chunks;
+  char magic[8]; // "F1TINDX"
+};
+
+const uint32_t TRAJECTORY_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+
+// Writes a log while the simulation runs. record() only copies the step into
+// one of two preallocated chunk buffers; when that fills up it is handed to a
+// writer thread, which compresses and writes it while the other one fills.
+// record() only ever waits if the disk can't keep up with a whole chunk.
+class TrajectoryRecorder {
+public:
+  // throws std::runtime_error if filename can't be opened
+  TrajectoryRecorder(const std::string &filename, double stepSeconds,
+                     bool compress = false, uint32_t chunkSteps = 4096,
+                     uint32_t chunkScans = 256, uint32_t rays = 720);
+  ~TrajectoryRecorder();
+
+  // the next step. scan and path are the LIDAR and planned path if the step
+  // sensed, path is only kept along with a scan
+  void record(const TrajectoryStep &step,
+              const std::vector<Ray> *scan = nullptr,
+              const std::vector<glm::vec2> *path = nullptr);
+  // writes what is left and the index. Throws std::runtime_error if any of
+  // the log couldn't be written
+  void close();
+
+  uint64_t getSteps() const { return steps; }
+  // times record() had to wait for the writer
+  uint64_t getStalls() const { return stalls; }
+
+private:
+  struct Chunk {
+    uint64_t firstStep = 0;
+    uint32_t steps = 0;
+    uint32_t scans = 0;
+    std::vector<uint32_t> columns[COLUMN_COUNT];
+  };
+
+  FILE *file;
+  std::string filename;
+  bool compress;
+  uint32_t chunkSteps;
+  uint32_t chunkScans;
+  uint32_t rays;
+  uint64_t steps = 0;
+  uint64_t stalls = 0;
+  bool closed = false;
+
+  Chunk buffers[2];
+  Chunk *filling;
+  // owned by the writer thread
+  uint64_t offset = 0;
+  std::vector<TrajectoryIndexEntry> index;
+  std::vector<uint8_t> packed;
+  bool failed = false;
+
+  std::thread writer;
+  std::mutex mutex;
+  std::condition_variable wake;
+  Chunk *pending = nullptr;
+  bool stopping = false;
+
+  void submit();
+  void write(const Chunk &chunk);
+  void run();
+};
+
+// one chunk of a log, read back
+struct TrajectoryChunk {
+  uint64_t firstStep = 0;
+  uint32_t steps = 0;
+  uint32_t scans = 0;
+  uint32_t rays = 0;
+  const uint32_t *columns[COLUMN_COUNT] = {};
+  std::vector<uint32_t> pathOffsets; // first point of each scan's path
+
+  float get(TrajectoryColumn column, uint32_t i) const;
+  // i is the step in this chunk
+  TrajectoryStep getStep(uint32_t i) const;
+  const float *getRanges(uint32_t scan) const {
+    return (const float *)columns[COLUMN_RANGES] + scan * rays;
+  }
+  uint32_t getScanStep(uint32_t scan) const {
+    return columns[COLUMN_SCAN_STEP][scan];
+  }
+  void getPath(uint32_t scan, std::vector<glm::vec2> &path) const;
+};
+
+// Maps a log and hands out its chunks. Uncompressed columns are read straight
+// out of the mapping, compressed ones are unpacked into a buffer that is
+// reused for every chunk.
+class TrajectoryReader {
+public:
+  // throws std::runtime_error if filename can't be opened, isn't a log or
+  // its index points outside of it
+  explicit TrajectoryReader(const std::string &filename);
+  ~TrajectoryReader();
+  TrajectoryReader(const TrajectoryReader &) = delete;
+  TrajectoryReader &operator=(const TrajectoryReader &) = delete;
+
+  double getStepSeconds() const { return header.stepSeconds; }
+  uint32_t getRays() const { return header.rays; }
+  uint64_t getSteps() const { return steps; }
+  size_t getChunkCount() const { return chunks.size(); }
+
+  // the chunk that step is in, steps past the end are in the last one
+  size_t findChunk(uint64_t step) const;
+  // valid until the next call. Throws std::runtime_error if the chunk's
+  // columns don't fit in it or don't add up
+  const TrajectoryChunk &readChunk(size_t chunk);
+
+private:
+  std::string filename;
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  std::vector<uint8_t> fallback; // the file, where it can't be mapped
+  TrajectoryHeader header;
+  uint64_t steps = 0;
+  std::vector<TrajectoryIndexEntry> chunks;
+
+  size_t loaded = SIZE_MAX;
+  TrajectoryChunk chunk;
+  std::vector<uint32_t> unpacked[COLUMN_COUNT];
+
+  void unmap();
+};
+
+#endif // SIMULATION_TRAJECTORY_LOG_H
@@ -0,0 +1,55 @@
+#ifndef SIMULATION_TRIPLE_BUFFER_H
+#define SIMULATION_TRIPLE_BUFFER_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest T from one producer thread to one consumer thread without
+// locks, and without either of them ever waiting on the other. The producer
+// fills back() and publish()es it, which swaps it with the middle slot; the
+// consumer's update() swaps the middle slot for front() if anything was
+// published since. A T the consumer never got to is simply overwritten, so a
+// slow consumer always works on the newest one there is.
+//
+// The slots are reused, so a T holding vectors only allocates until they
+// have grown to size.
+template <typename T> class TripleBuffer {
+public:
+  // producer side
+  T &back() { return slots[backIndex].value; }
+  // true if it overwrote one the consumer never saw
+  bool publish() {
+    uint8_t old =
+        middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+    backIndex = old & INDEX;
+    return (old & FRESH) != 0;
+  }
+
+  // consumer side, true if front() changed
+  bool update() {
+    if ((middle.load(std::memory_order_acquire) & FRESH) == 0) {
+      return false;
+    }
+    frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+  const T &front() const { return slots[frontIndex].value; }
+
+private:
+  static const uint8_t INDEX = 3;
+  static const uint8_t FRESH = 4;
+
+  // on cache lines of their own, so the two threads don't share one
+  struct alignas(64) Slot {
+    T value;
+  };
+
+  Slot slots[3];
+  alignas(64) uint8_t backIndex = 0;
+  alignas(64) std::atomic<uint8_t> middle{1};
+  alignas(64) uint8_t frontIndex = 2;
+};
+
+#endif // SIMULATION_TRIPLE_BUFFER_H
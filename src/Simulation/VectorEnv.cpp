@@ -0,0 +1,183 @@
+#include "VectorEnv.h"
+#include "Autonomy.h"
+#include "Determinism.h"
+#include "../Profiling/Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+int ThreadCount(int configured) {
+#ifdef _OPENMP
+  return configured > 0 ? configured : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+} // namespace
+
+VectorEnv::Env::Env(const VectorEnvConfig &config, uint64_t seed)
+    // the same car as the global one in Autonomy.cpp
+    : car(0.0f, config.startHeading, 0.4f, 0.1f, 2.0f, 0.1f),
+      position(config.start), random(RandomStream(seed, START_POSE_STREAM)),
+      rays(config.beams) {}
+
+VectorEnv::VectorEnv(int count, const VectorEnvConfig &config)
+    : config(config) {
+  if (count <= 0) {
+    throw std::runtime_error("a vector env needs at least one env, not " +
+                             std::to_string(count));
+  }
+  if (config.beams <= 0 || config.fovDegrees <= 0.0f ||
+      config.fovDegrees > 360.0f) {
+    throw std::runtime_error("bad LIDAR beams: " +
+                             std::to_string(config.beams) + " over " +
+                             std::to_string(config.fovDegrees) + " degrees");
+  }
+  if (config.actionRepeat <= 0 || config.stepSeconds <= 0.0) {
+    throw std::runtime_error("bad step: " +
+                             std::to_string(config.actionRepeat) + " * " +
+                             std::to_string(config.stepSeconds) + " s");
+  }
+
+  // evenly from edge to edge, except all the way round where the edges meet
+  float fov = config.fovDegrees * (float)M_PI / 180.0f;
+  int gaps = config.fovDegrees < 360.0f ? std::max(1, config.beams - 1)
+                                        : config.beams;
+  beamAngles.resize(config.beams);
+  for (int i = 0; i < config.beams; i++) {
+    beamAngles[i] = config.beams == 1 ? 0.0f : -fov / 2.0f + fov * i / gaps;
+  }
+
+  envs.reserve(count);
+  for (int i = 0; i < count; i++) {
+    envs.emplace_back(config, config.seed + i);
+  }
+}
+
+void VectorEnv::reset(const uint8_t *mask, float *observations) {
+  TRACE_ZONE("VectorEnv::reset");
+  const int size = getObservationSize();
+#pragma omp parallel for num_threads(ThreadCount(config.threads))
+  for (int i = 0; i < (int)envs.size(); i++) {
+    if (!mask || mask[i]) {
+      resetEnv(envs[i]);
+      observe(envs[i], observations + (size_t)i * size);
+    }
+  }
+}
+
+void VectorEnv::step(const float *actions, float *observations,
+                     float *rewards, uint8_t *dones) {
+  TRACE_ZONE("VectorEnv::step");
+  moveCars(actions, rewards);
+  const int size = getObservationSize();
+#pragma omp parallel for num_threads(ThreadCount(config.threads))
+  for (int i = 0; i < (int)envs.size(); i++) {
+    stepEnv(envs[i], observations + (size_t)i * size, rewards[i], dones[i]);
+  }
+}
+
+void VectorEnv::moveCars(const float *actions, float *rewards) {
+  batch.clear();
+  running.clear();
+  for (int i = 0; i < (int)envs.size(); i++) {
+    rewards[i] = 0.0f;
+    Env &env = envs[i];
+    if (env.done != VECTOR_ENV_RUNNING) {
+      continue;
+    }
+    env.steeringAngle = std::clamp(actions[(size_t)i * 2], -1.0f, 1.0f);
+    env.speed = std::clamp(actions[(size_t)i * 2 + 1], -1.0f, 1.0f);
+    size_t car = batch.add(env.car);
+    batch.setSteering(car, env.steeringAngle * Car::maxSteeringDegrees);
+    running.push_back(i);
+  }
+
+  for (int r = 0; r < config.actionRepeat; r++) {
+    for (size_t car = 0; car < running.size(); car++) {
+      batch.torque[car] =
+          drive_torque(batch.velocity[car], envs[running[car]].speed);
+    }
+    // the same way physics_step() moves the camera: along the heading from
+    // before this step
+    headings = batch.heading;
+    batch.update(config.stepSeconds);
+    for (size_t car = 0; car < running.size(); car++) {
+      float moved = batch.position[car];
+      envs[running[car]].position +=
+          glm::vec2(-std::cos(headings[car]), std::sin(headings[car])) *
+          moved;
+      rewards[running[car]] += moved;
+    }
+  }
+
+  for (size_t car = 0; car < running.size(); car++) {
+    batch.store(car, envs[running[car]].car);
+  }
+}
+
+void VectorEnv::resetEnv(Env &env) {
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  env.position = config.start +
+                 glm::vec2(unit(env.random), unit(env.random)) *
+                     config.startJitter;
+  env.car.heading =
+      config.startHeading + unit(env.random) * config.headingJitter;
+  env.car.velocity = 0;
+  env.car.position = 0;
+  env.car.angularVelocity = 0;
+  env.car.acceleration = 0;
+  env.steeringAngle = 0.0f;
+  env.speed = 0.0f;
+  env.steps = 0;
+  env.done = VECTOR_ENV_RUNNING;
+}
+
+float VectorEnv::observe(Env &env, float *observation) const {
+  // the car faces along world angle pi - heading, see physics_step()
+  glm::vec3 origin(env.position, 0.05f);
+  float facing = (float)M_PI - env.car.heading;
+  for (int i = 0; i < config.beams; i++) {
+    float angle = facing + beamAngles[i];
+    glm::vec3 direction(std::cos(angle), std::sin(angle), 0.0f);
+    env.rays[i] = {origin, direction, INFINITY, 1.0f / direction};
+  }
+  TraceRays(env.rays);
+
+  float closest = INFINITY;
+  for (int i = 0; i < config.beams; i++) {
+    closest = std::min(closest, env.rays[i].t);
+    observation[i] = std::min(env.rays[i].t, config.maxRange);
+  }
+  float *state = observation + config.beams;
+  state[0] = env.car.velocity;
+  state[1] = env.car.angularVelocity;
+  state[2] = env.car.acceleration;
+  state[3] = env.steeringAngle;
+  return closest;
+}
+
+void VectorEnv::stepEnv(Env &env, float *observation, float &reward,
+                        uint8_t &done) const {
+  done = env.done;
+  if (env.done != VECTOR_ENV_RUNNING) {
+    // it hasn't moved, so this is the observation it ended with
+    observe(env, observation);
+    return;
+  }
+
+  env.steps++;
+
+  if (observe(env, observation) < LIDAR_CRASH_DISTANCE) {
+    reward -= config.crashPenalty;
+    env.done = VECTOR_ENV_CRASHED;
+  } else if (config.maxSteps > 0 && env.steps >= config.maxSteps) {
+    env.done = VECTOR_ENV_TRUNCATED;
+  }
+  done = env.done;
+}
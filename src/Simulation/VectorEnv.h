@@ -0,0 +1,115 @@
+#ifndef SIMULATION_VECTOR_ENV_H
+#define SIMULATION_VECTOR_ENV_H
+
+#pragma once
+
+#include "../Infinite/backend/Software/BVH.h"
+#include "../Infinite/frontend/Car.h"
+#include "CarBatch.h"
+#include <cstdint>
+#include <glm/ext/vector_float2.hpp>
+#include <random>
+#include <vector>
+
+// how every environment of a VectorEnv starts, senses and ends
+struct VectorEnvConfig {
+  uint64_t seed = 0;
+  glm::vec2 start{-1.0f, 0.9f}; // metres, where the camera starts
+  float startHeading = 0.0f;    // radians, Car::heading
+  float startJitter = 0.0f;     // metres, each reset moves the start this much
+  float headingJitter = 0.0f;   // radians, and turns it this much
+
+  int beams = 540;            // LIDAR ranges in an observation
+  float fovDegrees = 270.0f;  // they cover, centred on where the car faces
+  float maxRange = 10.0f;     // metres, longer ranges and misses read this
+
+  double stepSeconds = 0.001; // one physics step, sim_clock's default
+  int actionRepeat = 17;      // physics steps per step(), about deltaTime
+  uint64_t maxSteps = 0;      // step()s before an episode is cut off, 0 never
+  float crashPenalty = 1.0f;  // taken off the reward of the step that crashed
+
+  int threads = 0; // stepping the environments, 0 for OpenMP's default
+};
+
+// how an environment's episode ended, if it has
+enum VectorEnvDone : uint8_t {
+  VECTOR_ENV_RUNNING = 0,
+  VECTOR_ENV_CRASHED = 1,   // a beam came within LIDAR_CRASH_DISTANCE
+  VECTOR_ENV_TRUNCATED = 2, // maxSteps ran out
+};
+
+// Many independent cars on the one track, stepped together for training a
+// policy: each step() takes an action per car, runs actionRepeat physics
+// steps of it, traces the car's LIDAR beams and writes every car's
+// observation, reward and done flag straight into the caller's arrays.
+//
+// The cars' physics steps run together in a CarBatch. They don't see each
+// other, so their LIDAR is traced in parallel with one OpenMP thread per car
+// at a time; the BVH is only read. It has to be built
+// (UpdateBoundingVolumeHierarchy) before the VectorEnv is made.
+//
+// An observation is getObservationSize() floats: beams ranges in metres, from
+// the right edge of the fov to the left, then the car's velocity (m/s),
+// angular velocity (rad/s), acceleration (m/s^2) and the steering it is
+// executing. An action is two floats, steering as a fraction of full lock,
+// positive to the right, and speed in update2()'s units, both clamped to
+// [-1, 1]. The reward is the distance driven along the heading, less
+// crashPenalty on a crash. Only the beams can see a crash, so a fov short of
+// 360 degrees can back into things unseen.
+//
+// A car that is done stays where it is, with a zero reward and the same
+// observation, until it is reset. Everything random comes from its own stream
+// of seed + the car's index, so the same resets and actions give the same
+// observations every time, on any number of threads.
+class VectorEnv {
+public:
+  static const int STATE_SIZE = 4;
+
+  VectorEnv(int envs, const VectorEnvConfig &config);
+
+  int getEnvs() const { return (int)envs.size(); }
+  int getObservationSize() const { return config.beams + STATE_SIZE; }
+  const VectorEnvConfig &getConfig() const { return config; }
+
+  // Resets the cars whose mask is non zero, every car if mask is null, and
+  // writes their observations. The other cars' observations are left alone
+  void reset(const uint8_t *mask, float *observations);
+  // actions is getEnvs() * 2 floats, observations getEnvs() *
+  // getObservationSize(), rewards and dones getEnvs() each
+  void step(const float *actions, float *observations, float *rewards,
+            uint8_t *dones);
+
+private:
+  struct Env {
+    Car car;
+    glm::vec2 position;
+    float steeringAngle = 0.0f;
+    float speed = 0.0f;
+    uint64_t steps = 0;
+    uint8_t done = VECTOR_ENV_RUNNING;
+    std::mt19937_64 random; // START_POSE_STREAM
+    std::vector<Ray> rays;
+
+    Env(const VectorEnvConfig &config, uint64_t seed);
+  };
+
+  VectorEnvConfig config;
+  std::vector<Env> envs;
+  std::vector<float> beamAngles; // radians, from where the car faces
+  CarBatch batch;                // the running envs' cars, during step()
+  std::vector<int> running;      // the env of each car in batch
+  std::vector<float> headings;   // batch's, before its last update()
+
+  void resetEnv(Env &env);
+  // takes the running envs' actions and drives their cars actionRepeat
+  // physics steps, adding up how far they went in rewards
+  void moveCars(const float *actions, float *rewards);
+  // traces env's beams, writes its observation and returns the closest range
+  float observe(Env &env, float *observation) const;
+  // after moveCars(): traces env's beams and ends its episode if it crashed
+  // or ran out of steps
+  void stepEnv(Env &env, float *observation, float &reward,
+               uint8_t &done) const;
+};
+
+#endif // SIMULATION_VECTOR_ENV_H
@@ -0,0 +1,80 @@
+#include "Infinite/frontend/Car.h"
+#include "Simulation/Bridge.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// F1TenthBridgeClient, an autonomy stack in a process of its own that drives
+// the car through a simulator started with --bridge <name> (see Bridge.h).
+// It only follows the gap: it steers at the longest range within
+// lookaheadDegrees of straight ahead. It is there as an example and to
+// exercise the bridge, not to race.
+//
+//   F1TenthBridgeClient [name] [--speed speed]
+int main(int argc, char **argv) {
+  std::string name = "/f1tenth-bridge";
+  float speed = 0.1f;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--speed" && i + 1 < argc) {
+      speed = std::atof(argv[++i]);
+    } else if (arg[0] != '-') {
+      name = arg;
+    } else {
+      std::cerr << "unknown argument: " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const float lookaheadDegrees = 60.0f;
+  const float gain = 1.5f;
+  try {
+    BridgeClient client(name);
+    const BridgeSegment &segment = client.getSegment();
+    uint64_t answered = 0;
+    uint64_t torn = 0;
+    while (client.isRunning()) {
+      const BridgeScan *scan = client.next(1.0);
+      if (!scan) {
+        continue;
+      }
+
+      // the scan is world aligned, so measure every ray from the heading
+      float forward = (float)M_PI - scan->heading;
+      float bestRange = -1.0f;
+      float bestAngle = 0.0f;
+      for (uint32_t i = 0; i < scan->rays; i++) {
+        float angle = segment.angleMin + i * segment.angleIncrement - forward;
+        angle = std::remainder(angle, 2.0f * (float)M_PI);
+        if (std::abs(angle) > lookaheadDegrees * (float)M_PI / 180.0f) {
+          continue;
+        }
+        float range = std::min(scan->ranges[i], 100.0f);
+        if (range > bestRange) {
+          bestRange = range;
+          bestAngle = angle;
+        }
+      }
+      if (!client.isValid()) {
+        // overwritten while it was being read, wait for the next one
+        torn++;
+        continue;
+      }
+
+      float steer =
+          -gain * bestAngle / (Car::maxSteeringDegrees * (float)M_PI / 180.0f);
+      client.send(std::max(-1.0f, std::min(1.0f, steer)), speed);
+      answered++;
+    }
+    printf("answered %llu scans, %llu overwritten while being read\n",
+           (unsigned long long)answered, (unsigned long long)torn);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#include "Simulation/Headless.h"
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+// the F1TenthSimHeadless entry point, which is always headless and never
+// links Vulkan or GLFW
+int main(int argc, char **argv) {
+  try {
+    HeadlessOptions options;
+    ParseHeadlessArgs(argc, argv, options);
+    return RunHeadless(options);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,64 @@
+#include "Profiling/Metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// F1TenthMetrics, which watches the metrics a running simulator publishes
+// with --metrics <name> (see Metrics.h) without stopping it:
+//
+//   F1TenthMetrics [name] [--interval seconds] [--once]
+//
+// Every interval it prints the counters with their rates and the latency
+// percentiles of just that interval; --once prints everything since the
+// simulator started and exits.
+int main(int argc, char **argv) {
+  std::string name = "/f1tenth-sim";
+  double interval = 1.0;
+  bool once = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--once") {
+      once = true;
+    } else if (arg == "--interval" && i + 1 < argc) {
+      interval = std::atof(argv[++i]);
+    } else if (arg[0] != '-') {
+      name = arg;
+    } else {
+      std::cerr << "unknown argument: " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  try {
+    MetricsReader reader(name);
+    const MetricsBlock &block = reader.getBlock();
+    if (once) {
+      PrintMetrics(block, ReadMetrics(block), 0.0);
+      return EXIT_SUCCESS;
+    }
+
+    MetricsSnapshot before = ReadMetrics(block);
+    auto beforeTime = std::chrono::steady_clock::now();
+    while (reader.isRunning()) {
+      std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+      MetricsSnapshot now = ReadMetrics(block);
+      auto nowTime = std::chrono::steady_clock::now();
+      double seconds =
+          std::chrono::duration<double>(nowTime - beforeTime).count();
+      printf("pid %u, last %.1f s:\n", block.pid, seconds);
+      PrintMetrics(block, now.since(before), seconds);
+      fflush(stdout);
+      before = now;
+      beforeTime = nowTime;
+    }
+    printf("pid %u stopped\n", block.pid);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include "Simulation/Scenario.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// F1TenthScenario, which builds scenario bundles (see Scenario.h) and checks
+// them:
+//
+//   F1TenthScenario build <manifest> <bundle>
+//   F1TenthScenario check <bundle>
+//
+// check maps the bundle, verifies every section against its hash and says
+// whether the OBJ has changed since it was built.
+int main(int argc, char **argv) {
+  std::string command = argc > 1 ? argv[1] : "";
+  if (!((command == "build" && argc == 4) || (command == "check" && argc == 3))) {
+    std::cerr << "usage: F1TenthScenario build <manifest> <bundle>\n"
+                 "       F1TenthScenario check <bundle>"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::string bundlePath = argv[argc - 1];
+    if (command == "build") {
+      BuildScenario(argv[2], bundlePath);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    Scenario scenario(bundlePath);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+    const ScenarioHeader &header = scenario.getHeader();
+    printf("%s, hash %016llx, mapped in %.3f ms\n", bundlePath.c_str(),
+           (unsigned long long)scenario.getHash(), seconds * 1e3);
+    printf("  mesh %s%s\n", scenario.getMeshPath().c_str(),
+           scenario.isMeshChanged() ? " (changed since)" : "");
+    if (!scenario.getTexturePath().empty()) {
+      printf("  texture %s\n", scenario.getTexturePath().c_str());
+    }
+    printf("  %zu starts, %zu raceline waypoints, %zu walls\n",
+           scenario.getStartCount(), scenario.getRacelineCount(),
+           scenario.getWallCount());
+    printf("  %ux%u grid at %.0f cells per metre from (%.2f, %.2f)\n",
+           header.gridWidth, header.gridHeight, header.cellsPerMetre,
+           header.gridOriginX, header.gridOriginY);
+    for (uint32_t type = SCENARIO_PATHS; type < SCENARIO_SECTION_COUNT;
+         type++) {
+      const ScenarioSection *section =
+          scenario.getSection((ScenarioSectionType)type);
+      if (section) {
+        printf("  section %2u %10llu bytes, hash %016llx\n", type,
+               (unsigned long long)section->size,
+               (unsigned long long)section->hash);
+      }
+    }
+
+    if (command == "check") {
+      scenario.verify();
+      printf("every section matches its hash\n");
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+#include "Simulation/Telemetry.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// F1TenthTelemetry, which subscribes to a simulator's --telemetry (see
+// Telemetry.h) and prints what arrives once a second: how many states and
+// scans, how many datagrams were missed, and where the car is.
+//
+//   F1TenthTelemetry <udp:ip:port | unix:path> [--seconds seconds]
+int main(int argc, char **argv) {
+#ifdef __linux__
+  if (argc < 2) {
+    std::cerr << "usage: F1TenthTelemetry <udp:ip:port | unix:path> "
+                 "[--seconds seconds]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string address = argv[1];
+  double seconds = 0.0; // 0 for until interrupted
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (std::string(argv[i]) == "--seconds") {
+      seconds = std::atof(argv[i + 1]);
+    }
+  }
+
+  sockaddr_storage server = {};
+  socklen_t length;
+  if (address.rfind("unix:", 0) == 0) {
+    sockaddr_un &remote = (sockaddr_un &)server;
+    remote.sun_family = AF_UNIX;
+    snprintf(remote.sun_path, sizeof(remote.sun_path), "%s",
+             address.c_str() + 5);
+    length = sizeof(sockaddr_un);
+  } else {
+    size_t colon = address.rfind(':');
+    sockaddr_in &remote = (sockaddr_in &)server;
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons((uint16_t)std::atoi(address.c_str() + colon + 1));
+    inet_pton(AF_INET, address.substr(4, colon - 4).c_str(), &remote.sin_addr);
+    length = sizeof(sockaddr_in);
+  }
+  int fd = socket(server.ss_family, SOCK_DGRAM, 0);
+  if (server.ss_family == AF_UNIX) {
+    // an abstract address of our own, for the server to send to
+    sa_family_t family = AF_UNIX;
+    bind(fd, (sockaddr *)&family, sizeof(family));
+  }
+  timeval timeout = {0, 100000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  auto request = [&](TelemetryType type) {
+    uint8_t buffer[sizeof(TelemetryDatagram) + sizeof(TelemetryMessage)];
+    TelemetryDatagram header = {TELEMETRY_MAGIC, TELEMETRY_VERSION, 1, 0};
+    TelemetryMessage message = {(uint16_t)type, 0, 0};
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), &message, sizeof(message));
+    sendto(fd, buffer, sizeof(buffer), 0, (sockaddr *)&server, length);
+  };
+
+  std::vector<uint8_t> buffer(TELEMETRY_MAX_DATAGRAM);
+  uint64_t states = 0, scans = 0, datagrams = 0, missed = 0;
+  uint64_t nextSequence = UINT64_MAX;
+  TelemetryState last = {};
+  auto begin = std::chrono::steady_clock::now();
+  auto report = begin;
+  request(TELEMETRY_SUBSCRIBE);
+  for (;;) {
+    auto now = std::chrono::steady_clock::now();
+    if (seconds > 0.0 &&
+        std::chrono::duration<double>(now - begin).count() > seconds) {
+      break;
+    }
+    if (now - report >= std::chrono::seconds(1)) {
+      printf("%llu states, %llu scans in %llu datagrams, %llu missed; step "
+             "%llu at (%.2f, %.2f) heading %.2f\n",
+             (unsigned long long)states, (unsigned long long)scans,
+             (unsigned long long)datagrams, (unsigned long long)missed,
+             (unsigned long long)last.step, last.x, last.y, last.heading);
+      fflush(stdout);
+      states = scans = datagrams = missed = 0;
+      report = now;
+      // stays subscribed for TELEMETRY_SUBSCRIBER_TIMEOUT after each
+      request(TELEMETRY_SUBSCRIBE);
+    }
+
+    ssize_t size = recv(fd, buffer.data(), buffer.size(), 0);
+    TelemetryDatagram header;
+    if (size < (ssize_t)sizeof(header)) {
+      continue;
+    }
+    memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic != TELEMETRY_MAGIC ||
+        header.version != TELEMETRY_VERSION) {
+      continue;
+    }
+    if (nextSequence != UINT64_MAX && header.sequence > nextSequence) {
+      missed += header.sequence - nextSequence;
+    }
+    nextSequence = header.sequence + 1;
+    datagrams++;
+
+    size_t offset = sizeof(header);
+    for (int i = 0; i < header.count; i++) {
+      TelemetryMessage message;
+      if (offset + sizeof(message) > (size_t)size) {
+        break;
+      }
+      memcpy(&message, buffer.data() + offset, sizeof(message));
+      offset += sizeof(message);
+      if (offset + message.size > (size_t)size) {
+        break;
+      }
+      if (message.type == TELEMETRY_STATE &&
+          message.size >= sizeof(TelemetryState)) {
+        memcpy(&last, buffer.data() + offset, sizeof(last));
+        states++;
+      } else if (message.type == TELEMETRY_SCAN) {
+        scans++;
+      }
+      offset += message.size;
+    }
+  }
+  request(TELEMETRY_UNSUBSCRIBE);
+  close(fd);
+  return EXIT_SUCCESS;
+#else
+  std::cerr << "F1TenthTelemetry needs Linux" << std::endl;
+  return EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,75 @@
+#include "../src/Simulation/CarBatch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Times stepping cars one Car::update() at a time against one
+// CarBatch::update() for all of them, with the command changing every 17
+// physics steps the way VectorEnv's actions do.
+//
+//   CarBatchBench [cars] [commands]
+
+namespace {
+double Seconds(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       begin)
+      .count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const int cars = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const int commands = argc > 2 ? std::atoi(argv[2]) : 2000;
+  const int STEPS = 17;
+  const float DT = 0.001f;
+
+  std::vector<float> steering(cars), torque(cars);
+  for (int i = 0; i < cars; i++) {
+    steering[i] = (i % 41 - 20) * 1.0f;
+    torque[i] = (i % 11 - 5) * 0.02f;
+  }
+
+  std::vector<Car> one(cars, Car(0.0f, 0.0f, 0.4f, 0.1f, 2.0f, 0.1f));
+  auto begin = std::chrono::steady_clock::now();
+  for (int c = 0; c < commands; c++) {
+    for (int s = 0; s < STEPS; s++) {
+      for (int i = 0; i < cars; i++) {
+        one[i].update(steering[i], torque[i], DT);
+      }
+    }
+  }
+  double carSeconds = Seconds(begin);
+
+  CarBatch batch;
+  for (int i = 0; i < cars; i++) {
+    batch.add(Car(0.0f, 0.0f, 0.4f, 0.1f, 2.0f, 0.1f));
+    batch.torque[i] = torque[i];
+  }
+  begin = std::chrono::steady_clock::now();
+  for (int c = 0; c < commands; c++) {
+    for (int i = 0; i < cars; i++) {
+      batch.setSteering(i, steering[i]);
+    }
+    for (int s = 0; s < STEPS; s++) {
+      batch.update(DT);
+    }
+  }
+  double batchSeconds = Seconds(begin);
+
+  // keeps the work from being optimised away, and they agree
+  float headings[2] = {};
+  for (int i = 0; i < cars; i++) {
+    headings[0] += one[i].heading;
+    headings[1] += batch.heading[i];
+  }
+
+  double updates = (double)cars * commands * STEPS;
+  std::printf("%d cars, %d physics steps\n", cars, commands * STEPS);
+  std::printf("Car::update()      %6.2f ns per car step\n",
+              carSeconds * 1e9 / updates);
+  std::printf("CarBatch::update() %6.2f ns per car step, %.1fx\n",
+              batchSeconds * 1e9 / updates, carSeconds / batchSeconds);
+  std::printf("headings %s\n", headings[0] == headings[1] ? "agree" : "differ");
+  return EXIT_SUCCESS;
+}
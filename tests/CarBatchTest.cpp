@@ -0,0 +1,96 @@
+#include "../src/Simulation/CarBatch.h"
+#include "Test.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+// CarBatch::update() has to leave every car bit for bit where
+// Car::update() would, through the velocity clamp, the stop it snaps to and
+// steering past full lock.
+
+namespace {
+bool Same(float a, float b) { return std::memcmp(&a, &b, 4) == 0; }
+
+bool SameCar(const Car &a, const Car &b) {
+  return Same(a.position, b.position) && Same(a.heading, b.heading) &&
+         Same(a.velocity, b.velocity) &&
+         Same(a.acceleration, b.acceleration) &&
+         Same(a.angularVelocity, b.angularVelocity);
+}
+} // namespace
+
+int main() {
+  const int CARS = 67; // not a multiple of any SIMD width
+  const int COMMANDS = 200;
+  const int STEPS = 17; // physics steps per command, like VectorEnv
+  const float DT = 0.001f;
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::vector<Car> cars;
+  CarBatch batch;
+  for (int i = 0; i < CARS; i++) {
+    // mostly the simulator's car, some with other wheelbases and masses
+    Car car(0.0f, unit(random) * 3.0f, i % 3 ? 0.4f : 0.33f + 0.1f * unit(random),
+            0.1f, i % 5 ? 2.0f : 3.0f + unit(random), 0.1f);
+    car.velocity = i % 4 ? 0.6f * unit(random) : 0.0f;
+    cars.push_back(car);
+    CHECK(batch.add(car) == (size_t)i);
+  }
+
+  int mismatches = 0;
+  for (int c = 0; c < COMMANDS; c++) {
+    std::vector<float> steering(CARS), torque(CARS);
+    for (int i = 0; i < CARS; i++) {
+      // past full lock now and then, and every so often straight ahead
+      steering[i] = c % 7 == 0 ? 0.0f : unit(random) * 30.0f;
+      // some cars floor it into the clamp, some brake, some do anything
+      torque[i] = i % 4 == 1 ? 0.5f : unit(random) * 0.5f;
+      batch.setSteering(i, steering[i]);
+    }
+    for (int s = 0; s < STEPS; s++) {
+      for (int i = 0; i < CARS; i++) {
+        // braking like drive_torque(), which slows the car into the stop
+        batch.torque[i] =
+            i % 4 == 0 ? -20.0f * cars[i].velocity : torque[i];
+        cars[i].update(steering[i], batch.torque[i], DT);
+      }
+      batch.update(DT);
+      for (int i = 0; i < CARS; i++) {
+        Car stored = cars[i];
+        batch.store(i, stored);
+        if (!SameCar(stored, cars[i])) {
+          mismatches++;
+        }
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+
+  // the cars did get to the clamp, stop and turn
+  int clamped = 0, stopped = 0, turned = 0;
+  for (const Car &car : cars) {
+    clamped += std::abs(car.velocity) == 0.6f;
+    stopped += car.velocity == 0.0f;
+    turned += car.heading != 0.0f;
+  }
+  CHECK(clamped > 0);
+  CHECK(stopped > 0);
+  CHECK(turned > 0);
+  std::printf("%d mismatches, %d cars at the clamp, %d stopped\n", mismatches,
+              clamped, stopped);
+
+  // set() and store() copy a car in and out unchanged
+  Car car(0.0f, 1.5f, 0.4f, 0.1f, 2.0f, 0.1f);
+  car.velocity = 0.25f;
+  car.acceleration = -0.5f;
+  car.angularVelocity = 0.125f;
+  batch.set(3, car);
+  Car out = cars[3];
+  batch.store(3, out);
+  CHECK(SameCar(out, car));
+
+  batch.clear();
+  CHECK(batch.size() == 0);
+  return TEST_RESULT();
+}
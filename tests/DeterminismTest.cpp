@@ -0,0 +1,77 @@
+#include "../src/Simulation/Autonomy.h"
+#include "../src/Simulation/BatchRunner.h"
+#include "Test.h"
+#include <string>
+#include <vector>
+
+// With deterministic set, every episode's state hash depends only on its
+// config: running the same batch on one thread or several, or again, gives
+// the same hashes.
+
+namespace {
+// a corridor along x through the default start, closed at both ends
+Infinite::Mesh Corridor() {
+  Infinite::Mesh mesh;
+  auto wall = [&mesh](glm::vec2 a, glm::vec2 b) {
+    uint32_t first = (uint32_t)mesh.positions.size();
+    mesh.positions.push_back({a.x, a.y, 0.0f});
+    mesh.positions.push_back({b.x, b.y, 0.0f});
+    mesh.positions.push_back({b.x, b.y, 0.3f});
+    mesh.positions.push_back({a.x, a.y, 0.3f});
+    mesh.texCoords.resize(mesh.positions.size(), glm::vec2(0.0f));
+    for (uint32_t i : {0u, 1u, 2u, 0u, 2u, 3u}) {
+      mesh.indices.push_back(first + i);
+    }
+  };
+  wall({-4.0f, 0.3f}, {2.0f, 0.3f});
+  wall({-4.0f, 1.5f}, {2.0f, 1.5f});
+  wall({-4.0f, 0.3f}, {-4.0f, 1.5f});
+  wall({2.0f, 0.3f}, {2.0f, 1.5f});
+  return mesh;
+}
+
+std::vector<uint64_t> Hashes(const std::vector<EpisodeConfig> &configs,
+                             int threads) {
+  BatchResult result = RunBatch(configs, threads);
+  CHECK(result.threads == threads);
+  std::vector<uint64_t> hashes;
+  for (const EpisodeSummary &summary : result.summaries) {
+    hashes.push_back(summary.hash);
+  }
+  return hashes;
+}
+} // namespace
+
+int main() {
+  deterministic = true;
+  BuildBoundingVolumeHierarchy(Corridor());
+
+  // every source of randomness and every way of moving the car
+  std::vector<EpisodeConfig> configs;
+  for (int i = 0; i < 6; i++) {
+    EpisodeConfig config;
+    config.seed = 100 + i;
+    config.seconds = 0.5;
+    config.speed = 0.5f;
+    config.startJitter = 0.1f;
+    config.headingJitter = 0.1f;
+    config.lidarNoise = 0.01f;
+    config.controller =
+        i % 2 ? EpisodeConfig::STANLEY : EpisodeConfig::PURE_PURSUIT;
+    config.vehicle = (EpisodeConfig::VehicleType)(i % 3);
+    configs.push_back(config);
+  }
+
+  std::vector<uint64_t> one = Hashes(configs, 1);
+  CHECK(Hashes(configs, 1) == one);
+  CHECK(Hashes(configs, 3) == one);
+  CHECK(Hashes(configs, 6) == one);
+
+  // and the hash does see the differences between episodes
+  for (size_t i = 1; i < one.size(); i++) {
+    CHECK(one[i] != one[0]);
+  }
+
+  destroyBVH();
+  return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+#include "../src/Infinite/backend/Model/Mesh.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+// Times loading an OBJ with tinyobj alone, with the parallel parser, and
+// from LoadMesh()'s cache. Without an OBJ it writes a grid of quads, about
+// 110 MB at the default 1000 vertices a side.
+//
+//   MeshBench [track.obj | vertices a side]
+
+using namespace Infinite;
+
+namespace {
+double Seconds(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       begin)
+      .count();
+}
+
+void WriteGrid(const std::string &filename, int size) {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  char line[128];
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n",
+                    x * 0.05f, y * 0.05f, (float)((x * 7 + y * 13) % 17) * 0.01f,
+                    x / (float)size, y / (float)size);
+      file << line;
+    }
+  }
+  for (int y = 0; y + 1 < size; y++) {
+    for (int x = 0; x + 1 < size; x++) {
+      int a = y * size + x + 1, b = a + 1, c = b + size, d = a + size;
+      std::snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n", a, a, b,
+                    b, c, c, d, d);
+      file << line;
+    }
+  }
+}
+
+template <typename Load>
+double Time(const char *what, const std::string &filename, Load load) {
+  auto begin = std::chrono::steady_clock::now();
+  Mesh mesh = load(filename);
+  double seconds = Seconds(begin);
+  std::printf("%-24s %7.3f s, %zu triangles\n", what, seconds,
+              mesh.triangleCount());
+  return seconds;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string filename = "MeshBench.obj";
+  bool generated = argc < 2 || std::atoi(argv[1]) > 0;
+  if (generated) {
+    WriteGrid(filename, argc > 1 ? std::atoi(argv[1]) : 1000);
+  } else {
+    filename = argv[1];
+  }
+  std::ifstream obj(filename, std::ios::binary | std::ios::ate);
+  std::printf("%s, %.1f MB\n", filename.c_str(), obj.tellg() / 1e6);
+
+  std::string cache = filename + ".mesh";
+  std::remove(cache.c_str());
+  double tinyobj = Time("tinyobj", filename, LoadMeshWithTinyObj);
+  double parsed = Time("parallel parser", filename, ParseMesh);
+  Time("LoadMesh, writing cache", filename, LoadMesh);
+  Time("LoadMesh, from cache", filename, LoadMesh);
+  std::printf("parallel parser %.1fx tinyobj\n", tinyobj / parsed);
+
+  std::remove(cache.c_str());
+  if (generated) {
+    std::remove(filename.c_str());
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#include "../src/Infinite/backend/Model/Mesh.h"
+#include "Test.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// The parallel OBJ parser has to come out exactly as tinyobj would, vertex
+// order and all, whichever of the face forms the OBJ uses and wherever the
+// file is split between threads. LoadMesh()'s cache has to give back the
+// same mesh again.
+
+using namespace Infinite;
+
+namespace {
+const char *OBJ = "MeshTest.obj";
+
+void Write(const std::string &text) {
+  std::ofstream file(OBJ, std::ios::binary | std::ios::trunc);
+  file << text;
+}
+
+bool SameMesh(const Mesh &a, const Mesh &b) {
+  return a.positions == b.positions && a.texCoords == b.texCoords &&
+         a.indices == b.indices;
+}
+
+void CheckParsesLikeTinyObj(const char *what) {
+  Mesh parsed = ParseMesh(OBJ);
+  Mesh reference = LoadMeshWithTinyObj(OBJ);
+  if (!SameMesh(parsed, reference)) {
+    std::fprintf(stderr, "%s: %zu positions, %zu triangles parsed, tinyobj "
+                 "%zu and %zu\n", what, parsed.positions.size(),
+                 parsed.triangleCount(), reference.positions.size(),
+                 reference.triangleCount());
+  }
+  CHECK(SameMesh(parsed, reference));
+  CHECK(reference.triangleCount() > 0);
+}
+
+// triangles and quads, with v, v/t, v//n and v/t/n corners, negative
+// indices, comments and groups, and a last line with no newline
+const char *SMALL =
+    "# a few faces of every kind\n"
+    "o small\n"
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "v 0 0 1\n"
+    "v 1 0 1.5\n"
+    "vt 0 0\n"
+    "vt 1 0\n"
+    "vt 1 1\n"
+    "vt 0 1\n"
+    "vn 0 0 1\n"
+    "vn 0 1 0\n"
+    "f 1 2 3\n"
+    "f 1/1 2/2 3/3 4/4\n"
+    "g sides\n"
+    "f 1//1 2//1 6//2\n"
+    "f 5/4/2 6/3/2 3/2/1 4/1/1\n"
+    "f -6/-4 -5/-3 -1/-2\n"
+    "f -2//-1 -1//-1 -3//-2 -4//-2\n"
+    "s off\n"
+    "f -6/-4/-2 -4/-2/-1 -3/-1/-1";
+
+// rows of vertices, each followed by the faces back to the row before, in
+// every form, so the parser's chunks split it at faces whose negative indices
+// reach back past the split
+std::string MakeLargeObj(int size) {
+  std::string obj;
+  char line[160];
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.5f %.5f\n",
+                    x * 0.1f, y * 0.1f, (float)((x * 7 + y * 13) % 17) * 0.01f,
+                    x / (float)size, y / (float)size);
+      obj += line;
+    }
+    obj += "vn 0 0 1\n";
+    for (int x = 0; y > 0 && x + 1 < size; x++) {
+      int a = (y - 1) * size + x + 1, b = a + 1, c = b + size, d = a + size;
+      int count = (y + 1) * size; // vertices so far
+      switch ((x + y) % 4) {
+      case 0:
+        std::snprintf(line, sizeof(line), "f %d %d %d %d\n", a, b, c, d);
+        break;
+      case 1:
+        std::snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\nf %d/%d %d/%d %d/%d\n",
+                      a, a, b, b, c, c, a, a, c, c, d, d);
+        break;
+      case 2:
+        std::snprintf(line, sizeof(line), "f %d//1 %d//1 %d//1 %d//-1\n",
+                      a - count - 1, b - count - 1, c - count - 1,
+                      d - count - 1);
+        break;
+      default:
+        std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                      a, a, y, b, b, y, c, c, y);
+      }
+      obj += line;
+    }
+  }
+  return obj;
+}
+} // namespace
+
+int main() {
+  Write(SMALL);
+  CheckParsesLikeTinyObj("small");
+
+  // past the parser's 4 MB chunks
+  std::string large = MakeLargeObj(320);
+  CHECK(large.size() > (8u << 20));
+  Write(large);
+  CheckParsesLikeTinyObj("large");
+
+  // what only tinyobj reads: a pentagon sends the file through it
+  Write(std::string(SMALL) + "\nf 1 2 6 3 4\n");
+  CheckParsesLikeTinyObj("pentagon");
+
+  // the first load writes the cache, the second reads it back
+  Write(large);
+  std::string cache = std::string(OBJ) + ".mesh";
+  std::remove(cache.c_str());
+  Mesh parsed = ParseMesh(OBJ);
+  Mesh first = LoadMesh(OBJ);
+  CHECK(std::ifstream(cache).good());
+  Mesh cached = LoadMesh(OBJ);
+  CHECK(SameMesh(first, parsed));
+  CHECK(SameMesh(cached, parsed));
+
+  CHECK_THROWS(ParseMesh("MeshTest.missing.obj"), std::runtime_error);
+
+  std::remove(cache.c_str());
+  std::remove(OBJ);
+  return TEST_RESULT();
+}
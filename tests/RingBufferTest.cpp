@@ -0,0 +1,122 @@
+#include "../src/Simulation/RingBuffer.h"
+#include "Test.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// RingBuffer on one thread, then with a producer and a consumer thread: in
+// order, nothing lost or repeated while the producer waits for room, and
+// only what claim() turned away missing when it drops instead.
+
+namespace {
+struct Value {
+  uint64_t sequence = 0;
+  uint64_t copies[7] = {};
+
+  void set(uint64_t s) {
+    sequence = s;
+    for (uint64_t &copy : copies) {
+      copy = ~s;
+    }
+  }
+  bool whole() const {
+    for (uint64_t copy : copies) {
+      if (copy != ~sequence) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+void CheckOneThread() {
+  RingBuffer<int, 4> ring;
+  CHECK(ring.peek() == nullptr);
+
+  // round the ring a few times, filling it each time
+  int next = 0, expected = 0;
+  for (int lap = 0; lap < 3; lap++) {
+    for (int i = 0; i < 4; i++) {
+      int *slot = ring.claim();
+      CHECK(slot != nullptr);
+      if (slot) {
+        *slot = next++;
+        ring.push();
+      }
+    }
+    CHECK(ring.claim() == nullptr);
+    for (int i = 0; i < 4; i++) {
+      const int *value = ring.peek();
+      CHECK(value != nullptr && *value == expected);
+      expected++;
+      ring.pop();
+    }
+    CHECK(ring.peek() == nullptr);
+  }
+
+  // a claim() that isn't pushed doesn't show up
+  CHECK(ring.claim() != nullptr);
+  CHECK(ring.peek() == nullptr);
+}
+
+// the producer waits for room if wait, else drops what doesn't fit
+void CheckTwoThreads(bool wait) {
+  const uint64_t COUNT = 200000;
+  RingBuffer<Value, 64> ring;
+  uint64_t dropped = 0;
+  std::atomic<bool> finished{false};
+  std::thread producer([&] {
+    for (uint64_t s = 1; s <= COUNT; s++) {
+      Value *slot;
+      while (!(slot = ring.claim()) && wait) {
+        std::this_thread::yield();
+      }
+      if (slot) {
+        slot->set(s);
+        ring.push();
+      } else {
+        dropped++;
+      }
+      // lets the consumer in now and then on a single core too, less often
+      // than it takes to fill the ring when the producer drops
+      if (s % (wait ? 16 : 256) == 0) {
+        std::this_thread::yield();
+      }
+    }
+    finished.store(true, std::memory_order_release);
+  });
+
+  uint64_t last = 0, received = 0, torn = 0, outOfOrder = 0;
+  while (true) {
+    const Value *value = ring.peek();
+    if (!value) {
+      // everything pushed before finished is there to peek() at by now
+      if (finished.load(std::memory_order_acquire) && !ring.peek()) {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    torn += !value->whole();
+    outOfOrder += wait ? value->sequence != last + 1 : value->sequence <= last;
+    last = value->sequence;
+    received++;
+    ring.pop();
+  }
+  producer.join();
+
+  CHECK(torn == 0);
+  CHECK(outOfOrder == 0);
+  CHECK(received + dropped == COUNT);
+  if (wait) {
+    CHECK(dropped == 0);
+  }
+}
+} // namespace
+
+int main() {
+  CheckOneThread();
+  CheckTwoThreads(true);
+  CheckTwoThreads(false);
+  return TEST_RESULT();
+}
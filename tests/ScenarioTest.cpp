@@ -0,0 +1,153 @@
+#include "../src/Simulation/Scenario.h"
+#include "../src/Planning/OccupancyGrid.h"
+#include "Test.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Builds a bundle of a square room from a manifest, maps it back and checks
+// it holds what the manifest and the OBJ said, that the walls, distance
+// field and costmap agree with the room, and that a bundle that is corrupt
+// or out of date is caught.
+
+namespace {
+const char *OBJ = "ScenarioTest.obj";
+const char *MANIFEST = "ScenarioTest.txt";
+const char *BUNDLE = "ScenarioTest.scn";
+const float HALF = 2.0f; // metres from the room's middle to its walls
+
+void Write(const char *filename, const std::string &text) {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file << text;
+}
+
+// four walls 0.3 m high, as quads
+std::string RoomObj(float half) {
+  std::string obj;
+  char line[256];
+  const float corners[4][2] = {
+      {-half, -half}, {half, -half}, {half, half}, {-half, half}};
+  for (int i = 0; i < 4; i++) {
+    const float *a = corners[i], *b = corners[(i + 1) % 4];
+    std::snprintf(line, sizeof(line),
+                  "v %g %g 0\nv %g %g 0\nv %g %g 0.3\nv %g %g 0.3\n", a[0],
+                  a[1], b[0], b[1], b[0], b[1], a[0], a[1]);
+    obj += line;
+  }
+  for (int i = 0; i < 4; i++) {
+    std::snprintf(line, sizeof(line), "f %d %d %d %d\n", 4 * i + 1, 4 * i + 2,
+                  4 * i + 3, 4 * i + 4);
+    obj += line;
+  }
+  return obj;
+}
+
+bool OnWall(glm::vec2 point, float tolerance) {
+  return std::abs(std::abs(point.x) - HALF) < tolerance ||
+         std::abs(std::abs(point.y) - HALF) < tolerance;
+}
+
+std::vector<uint8_t> ReadBundle() {
+  std::ifstream file(BUNDLE, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteBundle(const std::vector<uint8_t> &bytes) {
+  std::ofstream file(BUNDLE, std::ios::binary | std::ios::trunc);
+  file.write((const char *)bytes.data(), bytes.size());
+}
+} // namespace
+
+int main() {
+  Write(OBJ, RoomObj(HALF));
+  Write(MANIFEST, "# a square room\n"
+                  "mesh ScenarioTest.obj\n"
+                  "start -1 0.5 0\n"
+                  "start 1 -0.5 3.14159\n"
+                  "waypoint -1 0 0.2\n"
+                  "waypoint 0 1 0.3\n"
+                  "waypoint 1 0\n");
+  BuildScenario(MANIFEST, BUNDLE);
+
+  {
+    Scenario scenario(BUNDLE);
+    scenario.verify();
+    CHECK(!scenario.isMeshChanged());
+    CHECK(scenario.getTexturePath().empty());
+
+    CHECK(scenario.getStartCount() == 2);
+    const ScenarioPose &second = scenario.getStart(1);
+    CHECK(second.x == 1.0f && second.y == -0.5f && second.heading == 3.14159f);
+    CHECK(scenario.getRacelineCount() == 3);
+    const ScenarioWaypoint *raceline = scenario.getRaceline();
+    CHECK(raceline[1].x == 0.0f && raceline[1].y == 1.0f &&
+          raceline[1].speed == 0.3f);
+    CHECK(raceline[2].speed == 0.0f);
+
+    // the same triangles LoadMesh() reads
+    Infinite::Mesh bundled = scenario.getMesh();
+    Infinite::Mesh loaded = Infinite::LoadMesh(OBJ);
+    CHECK(bundled.positions == loaded.positions);
+    CHECK(bundled.indices == loaded.indices);
+
+    // the walls are the room's sides, all the way round
+    float cell = 1.0f / scenario.getHeader().cellsPerMetre;
+    float length = 0.0f;
+    for (size_t i = 0; i < scenario.getWallCount(); i++) {
+      const ScenarioWall &wall = scenario.getWalls()[i];
+      CHECK(OnWall(wall.a, 1e-4f) && OnWall(wall.b, 1e-4f));
+      length += glm::distance(wall.a, wall.b);
+    }
+    CHECK(std::abs(length - 8.0f * HALF) < 1e-3f);
+
+    // metres to the nearest wall, to within the grid
+    CHECK(std::abs(scenario.getDistance({0.0f, 0.0f}) - HALF) < 2.0f * cell);
+    CHECK(std::abs(scenario.getDistance({1.5f, 0.2f}) - 0.5f) < 2.0f * cell);
+    CHECK(std::abs(scenario.getDistance({-1.9f, -1.8f}) - 0.1f) < 2.0f * cell);
+    CHECK(scenario.getDistance({HALF + 10.0f, 0.0f}) == 0.0f);
+    CHECK(scenario.getCost({0.0f, 0.0f}) == FREE_CELL);
+    CHECK(scenario.getCost({HALF, 0.0f}) == BLOCKED_CELL);
+    CHECK(scenario.getCost({HALF + 10.0f, 0.0f}) == BLOCKED_CELL);
+  }
+
+  // a flipped byte in a section fails verify(), not the load
+  const std::vector<uint8_t> good = ReadBundle();
+  std::vector<uint8_t> bytes = good;
+  {
+    Scenario scenario(BUNDLE);
+    const ScenarioSection *section = scenario.getSection(SCENARIO_DISTANCE);
+    CHECK(section != nullptr);
+    bytes[section->offset + section->size / 2] ^= 0x40;
+  }
+  WriteBundle(bytes);
+  {
+    Scenario scenario(BUNDLE);
+    CHECK_THROWS(scenario.verify(), std::runtime_error);
+  }
+
+  // not a bundle at all
+  bytes = good;
+  bytes[0] = 'X';
+  WriteBundle(bytes);
+  CHECK_THROWS(Scenario scenario(BUNDLE), std::runtime_error);
+
+  // the OBJ changing is noticed
+  WriteBundle(good);
+  Write(OBJ, RoomObj(HALF + 1.0f));
+  {
+    Scenario scenario(BUNDLE);
+    CHECK(scenario.isMeshChanged());
+  }
+
+  // a manifest with no start can't be built
+  Write(MANIFEST, "mesh ScenarioTest.obj\n");
+  CHECK_THROWS(BuildScenario(MANIFEST, BUNDLE), std::runtime_error);
+
+  std::remove(BUNDLE);
+  std::remove(MANIFEST);
+  std::remove(OBJ);
+  std::remove((std::string(OBJ) + ".mesh").c_str());
+  return TEST_RESULT();
+}
@@ -0,0 +1,45 @@
+#ifndef TESTS_TEST_H
+#define TESTS_TEST_H
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Just enough for the tests in this directory, each its own executable that
+// ctest runs. CHECK() reports a failed condition and carries on, so one run
+// shows every failure, and main() returns TEST_RESULT().
+
+inline int &TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      TestFailures()++;                                                        \
+    }                                                                          \
+  } while (0)
+
+// expression has to throw exception
+#define CHECK_THROWS(expression, exception)                                    \
+  do {                                                                         \
+    bool thrown = false;                                                       \
+    try {                                                                      \
+      expression;                                                              \
+    } catch (const exception &) {                                              \
+      thrown = true;                                                           \
+    }                                                                          \
+    if (!thrown) {                                                             \
+      std::fprintf(stderr, "%s:%d: %s didn't throw %s\n", __FILE__, __LINE__,  \
+                   #expression, #exception);                                   \
+      TestFailures()++;                                                        \
+    }                                                                          \
+  } while (0)
+
+#define TEST_RESULT() (TestFailures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // TESTS_TEST_H
@@ -0,0 +1,257 @@
+#include "../src/Simulation/TrajectoryLog.h"
+#include "Test.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Writes logs with TrajectoryRecorder and reads them back, then checks the
+// reader turns away logs that are cut short or corrupt instead of reading
+// past the end of them.
+
+namespace {
+const char *LOG = "TrajectoryLogTest.log";
+const uint32_t RAYS = 16;
+const uint32_t STEPS = 500;
+const uint32_t SCAN_EVERY = 5;
+
+TrajectoryStep MakeStep(uint32_t i) {
+  TrajectoryStep step;
+  step.position = glm::vec3(std::sin(i * 0.01f), i * 0.001f, 0.05f);
+  step.heading = i * 0.002f;
+  step.velocity = 0.1f + (i % 7) * 0.01f;
+  step.acceleration = (i % 3) - 1.0f;
+  step.angularVelocity = std::cos(i * 0.1f);
+  step.speed = 0.1f;
+  step.steeringAngle = (i % 11) / 10.0f - 0.5f;
+  return step;
+}
+
+void MakeScan(uint32_t i, std::vector<Ray> &scan,
+              std::vector<glm::vec2> &path) {
+  scan.assign(RAYS, Ray());
+  for (uint32_t r = 0; r < RAYS; r++) {
+    scan[r].t = r == i % RAYS ? INFINITY : 1.0f + r * 0.1f + i * 0.0001f;
+  }
+  path.clear();
+  for (uint32_t p = 0; p < i % 8; p++) {
+    path.push_back(glm::vec2(p * 0.02f, i * 0.001f - p * 0.01f));
+  }
+}
+
+void Record(bool compress) {
+  TrajectoryRecorder recorder(LOG, 0.001, compress, 64, 8, RAYS);
+  std::vector<Ray> scan;
+  std::vector<glm::vec2> path;
+  for (uint32_t i = 0; i < STEPS; i++) {
+    if (i % SCAN_EVERY == 0) {
+      MakeScan(i, scan, path);
+      recorder.record(MakeStep(i), &scan, &path);
+    } else {
+      recorder.record(MakeStep(i));
+    }
+  }
+  recorder.close();
+}
+
+bool Same(float a, float b) { return std::memcmp(&a, &b, 4) == 0; }
+
+bool SameStep(const TrajectoryStep &a, const TrajectoryStep &b) {
+  return Same(a.position.x, b.position.x) && Same(a.position.y, b.position.y) &&
+         Same(a.position.z, b.position.z) && Same(a.heading, b.heading) &&
+         Same(a.velocity, b.velocity) && Same(a.acceleration, b.acceleration) &&
+         Same(a.angularVelocity, b.angularVelocity) &&
+         Same(a.speed, b.speed) && Same(a.steeringAngle, b.steeringAngle);
+}
+
+// every step, scan and path comes back bit for bit
+void CheckRoundTrip(bool compress) {
+  Record(compress);
+  TrajectoryReader reader(LOG);
+  CHECK(reader.getRays() == RAYS);
+  CHECK(reader.getSteps() == STEPS);
+  CHECK(reader.getStepSeconds() == 0.001);
+  CHECK(reader.getChunkCount() > 1);
+
+  uint32_t steps = 0;
+  uint32_t scans = 0;
+  std::vector<Ray> scan;
+  std::vector<glm::vec2> path, readPath;
+  for (size_t c = 0; c < reader.getChunkCount(); c++) {
+    const TrajectoryChunk &chunk = reader.readChunk(c);
+    CHECK(chunk.firstStep == steps);
+    CHECK(reader.findChunk(chunk.firstStep) == c);
+    for (uint32_t i = 0; i < chunk.steps; i++) {
+      CHECK(SameStep(chunk.getStep(i), MakeStep(steps + i)));
+    }
+    for (uint32_t s = 0; s < chunk.scans; s++, scans++) {
+      uint32_t step = (uint32_t)chunk.firstStep + chunk.getScanStep(s);
+      CHECK(step == scans * SCAN_EVERY);
+      MakeScan(step, scan, path);
+      const float *ranges = chunk.getRanges(s);
+      for (uint32_t r = 0; r < RAYS; r++) {
+        CHECK(Same(ranges[r], scan[r].t));
+      }
+      chunk.getPath(s, readPath);
+      CHECK(readPath.size() == path.size());
+      for (size_t p = 0; p < path.size() && p < readPath.size(); p++) {
+        CHECK(Same(readPath[p].x, path[p].x) && Same(readPath[p].y, path[p].y));
+      }
+    }
+    steps += chunk.steps;
+  }
+  CHECK(steps == STEPS);
+  CHECK(scans == (STEPS + SCAN_EVERY - 1) / SCAN_EVERY);
+}
+
+std::vector<uint8_t> ReadFile() {
+  std::ifstream file(LOG, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteFile(const std::vector<uint8_t> &bytes) {
+  std::ofstream file(LOG, std::ios::binary | std::ios::trunc);
+  file.write((const char *)bytes.data(), bytes.size());
+}
+
+// reads every chunk the reader says there is
+void ReadAll() {
+  TrajectoryReader reader(LOG);
+  for (size_t c = 0; c < reader.getChunkCount(); c++) {
+    reader.readChunk(c);
+  }
+}
+
+TrajectoryChunkHeader FirstChunk(const std::vector<uint8_t> &bytes) {
+  TrajectoryChunkHeader header;
+  std::memcpy(&header, bytes.data() + sizeof(TrajectoryHeader), sizeof(header));
+  return header;
+}
+
+void SetFirstChunk(std::vector<uint8_t> &bytes,
+                   const TrajectoryChunkHeader &header) {
+  std::memcpy(bytes.data() + sizeof(TrajectoryHeader), &header, sizeof(header));
+}
+
+void CheckCutShort() {
+  Record(false);
+  std::vector<uint8_t> bytes = ReadFile();
+  TrajectoryChunkHeader first = FirstChunk(bytes);
+
+  // a recorder that never got to close(): no index, half a second chunk
+  bytes.resize(sizeof(TrajectoryHeader) + first.bytes + first.bytes / 2);
+  WriteFile(bytes);
+  TrajectoryReader reader(LOG);
+  CHECK(reader.getChunkCount() == 1);
+  CHECK(reader.getSteps() == first.steps);
+  const TrajectoryChunk &chunk = reader.readChunk(0);
+  CHECK(SameStep(chunk.getStep(chunk.steps - 1), MakeStep(chunk.steps - 1)));
+
+  // not even a header
+  bytes.resize(sizeof(TrajectoryHeader) - 1);
+  WriteFile(bytes);
+  CHECK_THROWS(TrajectoryReader reader(LOG), std::runtime_error);
+}
+
+void CheckCorruptIndex() {
+  Record(false);
+  const std::vector<uint8_t> good = ReadFile();
+  TrajectoryTrailer trailer;
+  std::memcpy(&trailer, good.data() + good.size() - sizeof(trailer),
+              sizeof(trailer));
+
+  // an index past the end of the file
+  std::vector<uint8_t> bytes = good;
+  TrajectoryTrailer bad = trailer;
+  bad.indexOffset = good.size() * 2;
+  std::memcpy(bytes.data() + bytes.size() - sizeof(bad), &bad, sizeof(bad));
+  WriteFile(bytes);
+  CHECK_THROWS(TrajectoryReader reader(LOG), std::runtime_error);
+
+  // more chunks than fit, enough for the index's size to overflow
+  bad = trailer;
+  bad.chunks = UINT64_MAX / sizeof(TrajectoryIndexEntry) + 2;
+  std::memcpy(bytes.data() + bytes.size() - sizeof(bad), &bad, sizeof(bad));
+  WriteFile(bytes);
+  CHECK_THROWS(TrajectoryReader reader(LOG), std::runtime_error);
+
+  // a chunk past the end of the file
+  bytes = good;
+  TrajectoryIndexEntry entry;
+  std::memcpy(&entry, good.data() + trailer.indexOffset, sizeof(entry));
+  entry.offset = good.size() + 64;
+  std::memcpy(bytes.data() + trailer.indexOffset, &entry, sizeof(entry));
+  WriteFile(bytes);
+  CHECK_THROWS(TrajectoryReader reader(LOG), std::runtime_error);
+
+  // a chunk that says it runs into the index
+  bytes = good;
+  TrajectoryChunkHeader first = FirstChunk(bytes);
+  first.bytes = (uint32_t)good.size();
+  SetFirstChunk(bytes, first);
+  WriteFile(bytes);
+  CHECK_THROWS(TrajectoryReader reader(LOG), std::runtime_error);
+}
+
+void CheckCorruptChunk(bool compress) {
+  Record(compress);
+  const std::vector<uint8_t> good = ReadFile();
+
+  // a column bigger than its chunk
+  std::vector<uint8_t> bytes = good;
+  TrajectoryChunkHeader first = FirstChunk(bytes);
+  first.sizes[COLUMN_RANGES] = UINT32_MAX;
+  SetFirstChunk(bytes, first);
+  WriteFile(bytes);
+  CHECK_THROWS(ReadAll(), std::runtime_error);
+
+  // far more steps than the columns can hold
+  bytes = good;
+  first = FirstChunk(bytes);
+  first.steps = UINT32_MAX;
+  first.scans = UINT32_MAX;
+  SetFirstChunk(bytes, first);
+  WriteFile(bytes);
+  CHECK_THROWS(ReadAll(), std::runtime_error);
+
+  if (compress) {
+    return;
+  }
+  // a scan claiming more path points than the chunk stored
+  bytes = good;
+  first = FirstChunk(bytes);
+  size_t column = sizeof(TrajectoryHeader) + sizeof(first);
+  for (int c = 0; c < COLUMN_PATH_LENGTH; c++) {
+    column += (first.sizes[c] + 7) & ~size_t(7);
+  }
+  uint32_t length = first.pathPoints + 1;
+  std::memcpy(bytes.data() + column, &length, sizeof(length));
+  WriteFile(bytes);
+  CHECK_THROWS(ReadAll(), std::runtime_error);
+
+  // a scan taken on a step the chunk doesn't have
+  bytes = good;
+  column = sizeof(TrajectoryHeader) + sizeof(first);
+  for (int c = 0; c < COLUMN_SCAN_STEP; c++) {
+    column += (first.sizes[c] + 7) & ~size_t(7);
+  }
+  uint32_t step = first.steps;
+  std::memcpy(bytes.data() + column, &step, sizeof(step));
+  WriteFile(bytes);
+  CHECK_THROWS(ReadAll(), std::runtime_error);
+}
+} // namespace
+
+int main() {
+  CheckRoundTrip(false);
+  CheckRoundTrip(true);
+  CheckCutShort();
+  CheckCorruptIndex();
+  CheckCorruptChunk(false);
+  CheckCorruptChunk(true);
+  std::remove(LOG);
+  return TEST_RESULT();
+}
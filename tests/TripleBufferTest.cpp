@@ -0,0 +1,94 @@
+#include "../src/Simulation/TripleBuffer.h"
+#include "Test.h"
+#include <cstdint>
+#include <thread>
+
+// TripleBuffer on one thread, then with a producer and a consumer thread:
+// the consumer must only ever see whole values, newer each time it gets
+// one, and end up with the last one published.
+
+namespace {
+// big enough that a torn read would show up as fields that disagree
+struct Value {
+  uint64_t sequence = 0;
+  uint64_t copies[15] = {};
+
+  void set(uint64_t s) {
+    sequence = s;
+    for (uint64_t &copy : copies) {
+      copy = s * 2654435761u;
+    }
+  }
+  bool whole() const {
+    for (uint64_t copy : copies) {
+      if (copy != sequence * 2654435761u) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+void CheckOneThread() {
+  TripleBuffer<int> buffer;
+  CHECK(!buffer.update());
+
+  buffer.back() = 1;
+  CHECK(!buffer.publish());
+  CHECK(buffer.update());
+  CHECK(buffer.front() == 1);
+  CHECK(!buffer.update());
+  CHECK(buffer.front() == 1);
+
+  // the consumer only gets the newest, and the producer hears it overwrote
+  buffer.back() = 2;
+  CHECK(!buffer.publish());
+  buffer.back() = 3;
+  CHECK(buffer.publish());
+  CHECK(buffer.update());
+  CHECK(buffer.front() == 3);
+  CHECK(!buffer.update());
+}
+
+void CheckTwoThreads() {
+  const uint64_t COUNT = 200000;
+  TripleBuffer<Value> buffer;
+  uint64_t overwritten = 0;
+  std::thread producer([&] {
+    for (uint64_t s = 1; s <= COUNT; s++) {
+      buffer.back().set(s);
+      overwritten += buffer.publish();
+      // lets the consumer in now and then on a single core too
+      if (s % 64 == 0) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint64_t last = 0, received = 0, torn = 0, backwards = 0;
+  while (last < COUNT) {
+    if (!buffer.update()) {
+      std::this_thread::yield();
+      continue;
+    }
+    const Value &value = buffer.front();
+    torn += !value.whole();
+    backwards += value.sequence <= last;
+    last = value.sequence;
+    received++;
+  }
+  producer.join();
+
+  CHECK(torn == 0);
+  CHECK(backwards == 0);
+  CHECK(last == COUNT);
+  // every value was either received or overwritten, never both
+  CHECK(received + overwritten == COUNT);
+}
+} // namespace
+
+int main() {
+  CheckOneThread();
+  CheckTwoThreads();
+  return TEST_RESULT();
+}